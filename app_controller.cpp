@@ -26,11 +26,15 @@ using mono::ui::View;
 #define MONO_OPENWEATHERMAP_APPID "241d52af482f9f7ff00b0cc909229d92"
 
 #define FORECASTS_TO_KEEP 5
+#define SNAPSHOT_BYTES_TO_KEEP (SNAPSHOT_HEADER_BYTES + SNAPSHOT_MAX_CITY + FORECASTS_TO_KEEP * SNAPSHOT_ENTRY_BYTES + SNAPSHOT_CHECKSUM_BYTES)
 
 #define MONO_WEATHER_CITY (uint8_t const *)(CONF_KEY_ROOT "/weather/city.txt")
 #define MONO_WEATHER_COUNTRYCODE (uint8_t const *)(CONF_KEY_ROOT "/weather/countrycode.txt")
 #define MONO_WEATHER_TIMEZONE (uint8_t const *)(CONF_KEY_ROOT "/weather/timezone.txt")
 #define MONO_WEATHER_FORECAST (uint8_t const *)(CONF_KEY_ROOT "/weather/forecast.json")
+#define MONO_WEATHER_SNAPSHOT (uint8_t const *)(CONF_KEY_ROOT "/weather/forecast.bin")
+#define MONO_WEATHER_HISTORY (uint8_t const *)(CONF_KEY_ROOT "/weather/history")
+#define HISTORY_SECONDS_TO_KEEP (28 * 24 * 3600)
 #define MONO_WEATHER_UNIT (uint8_t const *)(CONF_KEY_ROOT "/weather/unit.txt")
 #define MONO_WEATHER_METRIC "metric"
 
@@ -42,6 +46,43 @@ namespace
     {
         return (uint8_t *) contents;
     }
+
+    /**
+     * Image of each weather::Condition, the last one for Unknown.
+     */
+    char const * const conditionAssets[] =
+    {
+        "/sd/mono/weather/Day_ClearSky.bmp",
+        "/sd/mono/weather/Day_FewClouds.bmp",
+        "/sd/mono/weather/Day_ScatteredClouds.bmp",
+        "/sd/mono/weather/Day_Overcast.bmp",
+        "/sd/mono/weather/Day_Rain.bmp",
+        "/sd/mono/weather/Day_ShowerRain.bmp",
+        "/sd/mono/weather/Day_Thunder.bmp",
+        "/sd/mono/weather/Day_Snow.bmp",
+        "/sd/mono/weather/Day_Mist.bmp",
+        "/sd/mono/weather/Night_ClearSky.bmp",
+        "/sd/mono/weather/Night_FewClouds.bmp",
+        "/sd/mono/weather/Night_ScatteredClouds.bmp",
+        "/sd/mono/weather/Night_Overcast.bmp",
+        "/sd/mono/weather/Night_Rain.bmp",
+        "/sd/mono/weather/Night_Rain.bmp",
+        "/sd/mono/weather/Night_Thunder.bmp",
+        "/sd/mono/weather/Night_Snow.bmp",
+        "/sd/mono/weather/Day_Mist.bmp",
+        "/sd/mono/weather/Night_Snow.bmp",
+    };
+    // Fails to compile if a condition has no image.
+    typedef char conditionAssetsMatchConditions[sizeof(conditionAssets)/sizeof(conditionAssets[0]) == weather::Unknown + 1 ? 1 : -1];
+
+    /**
+     * @return numerator / denominator rounded half away from zero.
+     */
+    int32_t roundedDivide (int32_t numerator, int32_t denominator)
+    {
+        if (numerator < 0) return -((-numerator + denominator / 2) / denominator);
+        return (numerator + denominator / 2) / denominator;
+    }
 } // namespace
 
 AppController::AppController ()
@@ -50,8 +91,15 @@ AppController::AppController ()
     background(WhiteColor),
     topLabel(Rect(0,200,176,20),"Weather Forecast"),
     wifi(0),
+    filter(buffer),
     dimmer(20*10000,true),
     sleeper(10*1000,true),
+    results(resultMemory,sizeof(resultMemory)),
+    json(buffer,results),
+    historyStore(0),
+    history(0),
+    decoder(0),
+    parser(0),
     view1(0),
     view2(0)
 {
@@ -60,6 +108,18 @@ AppController::AppController ()
     topLabel.setTextColor(MidnightBlueColor);
     dimmer.setCallback<AppController>(this,&AppController::dim);
     sleeper.setCallback(IApplicationContext::EnterSleepMode);
+    // Only what is shown is stored on the SD card.
+    filter.keep("/city/name");
+    filter.keep("/list/*/dt");
+    filter.keep("/list/*/main/temp");
+    filter.keep("/list/*/main/humidity");
+    filter.keep("/list/*/main/pressure");
+    filter.keep("/list/*/clouds/all");
+    filter.keep("/list/*/wind");
+    filter.keep("/list/*/weather/0/icon");
+    filter.keep("/list/*/rain");
+    // The forecast file only changes when a new one arrives.
+    json.enableCache();
 }
 
 void AppController::debug (String msg)
@@ -103,22 +163,142 @@ void AppController::readForecastFromSdCardAndShow ()
     buffer.attach(previousForecast);
     if (buffer.status() != SdCardByteBuffer::SdBuffer_OK)
         return error("SD card problem",String::Format("Could not create forecast buffer %s on SD card",previousForecast()));
-    interpretForecast();
+    // The snapshot shows the forecast without parsing it again.
+    if (! readSnapshot()) return interpretForecast();
+    if (! readDisplayConf()) return;
+    forecast = snapshot.entries;
+    showForecasts(snapshot.city);
+}
+
+bool AppController::readSnapshot ()
+{
+    String path = SdCard::get().fullPath((char const *)MONO_WEATHER_SNAPSHOT);
+    FILE * file = fopen(path(),"rb");
+    if (0 == file)
+    {
+        debug(String::Format("No snapshot %s",path()));
+        return false;
+    }
+    uint8_t bytes[SNAPSHOT_BYTES_TO_KEEP];
+    size_t length = fread(bytes,1,sizeof(bytes),file);
+    fclose(file);
+    if (! snapshot.read(bytes,length))
+    {
+        debug(String::Format("Damaged snapshot %s",path()));
+        return false;
+    }
+    // The snapshot is removed before a new forecast is written, and if that
+    // failed, a forecast of another size still shows that it is stale.
+    if (snapshot.sourceBytes != buffer.bytes())
+    {
+        debug(String::Format("Stale snapshot %s",path()));
+        return false;
+    }
+    return true;
+}
+
+void AppController::writeSnapshot (uint8_t const * city)
+{
+    snapshot.setCity(city);
+    snapshot.entries = forecast;
+    snapshot.sourceBytes = buffer.bytes();
+    uint8_t bytes[SNAPSHOT_BYTES_TO_KEEP];
+    size_t length = snapshot.write(bytes,sizeof(bytes));
+    if (0 == length) return;
+    String path = SdCard::get().fullPath((char const *)MONO_WEATHER_SNAPSHOT);
+    FILE * file = fopen(path(),"wb");
+    if (0 == file)
+    {
+        debug(String::Format("Could not write snapshot %s",path()));
+        return;
+    }
+    // A short write leaves a snapshot that readSnapshot refuses.
+    fwrite(bytes,1,length,file);
+    fclose(file);
+}
+
+void AppController::recordHistory ()
+{
+    if (0 == history)
+    {
+        String path = SdCard::get().fullPath((char const *)MONO_WEATHER_HISTORY);
+        // The last part of the path is taken as a file unless it ends in a slash.
+        SdCard::get().mkdirForFullPath(String::Format("%s/",path()));
+        historyStore = new FileSegmentStore(path());
+        history = new weather::History(*historyStore);
+        // Appending to a history that was only partly read could write over
+        // the segments it missed, so it is tried again next time.
+        if (! history->open())
+        {
+            debug(String::Format("Could not read history %s",path()));
+            delete history;
+            delete historyStore;
+            history = 0;
+            historyStore = 0;
+            return;
+        }
+    }
+    size_t segments = history->segments();
+    // The forecasts start a new run, and supersede the older forecasts for
+    // the same times once the history is compacted.
+    for (size_t i = 0; i < forecast.size(); ++i)
+        history->append(forecast[i]);
+    // Compact only when a segment is full, so a refresh costs a few writes.
+    if (history->segments() > segments && forecast[0].timeUnix > HISTORY_SECONDS_TO_KEEP)
+        history->compact(forecast[0].timeUnix - HISTORY_SECONDS_TO_KEEP);
+}
+
+void AppController::keepForecast (uint8_t const * city)
+{
+    // A forecast too short to show is neither kept nor recorded.
+    if (forecast.size() < SNAPSHOT_MIN_ENTRIES) return;
+    writeSnapshot(city);
+    recordHistory();
 }
 
 void AppController::interpretForecast ()
+{
+    if (! readDisplayConf()) return;
+    // The previous forecast is replaced, so its strings can go.
+    results.reset();
+    uint8_t const * city = json.lookup("/city/name");
+    forecast = openweathermap::parseForecast(json,FORECASTS_TO_KEEP);
+    keepForecast(city);
+    showForecasts(city);
+}
+
+void AppController::showDecodedForecast ()
+{
+    if (! readDisplayConf()) return;
+    decoder->finish();
+    forecast = decoder->forecast();
+    keepForecast(decoder->city());
+    showForecasts(decoder->city());
+}
+
+bool AppController::readDisplayConf ()
 {
     if (conf.get(MONO_WEATHER_TIMEZONE) == 0)
-        return error("Missing SD conf",String::Format("Missing conf file %s on SD card",MONO_WEATHER_TIMEZONE));
+    {
+        error("Missing SD conf",String::Format("Missing conf file %s on SD card",MONO_WEATHER_TIMEZONE));
+        return false;
+    }
     timeZone = conf.get(MONO_WEATHER_TIMEZONE);
     if (conf.get(MONO_WEATHER_UNIT) == 0)
-        return error("Missing SD conf",String::Format("Missing conf file %s on SD card",MONO_WEATHER_UNIT));
+    {
+        error("Missing SD conf",String::Format("Missing conf file %s on SD card",MONO_WEATHER_UNIT));
+        return false;
+    }
     unit = conf.get(MONO_WEATHER_UNIT);
-    json::Json json(buffer);
-    uint8_t const * city = json.lookup("/city/name");
+    return true;
+}
+
+void AppController::showForecasts (uint8_t const * city)
+{
+    if (forecast.size() < SNAPSHOT_MIN_ENTRIES)
+        return error("Forecast problem","Too few forecasts to show");
     topLabel.setText((char const *)city);
     topLabel.show();
-    forecast = openweathermap::parseForecast(buffer,FORECASTS_TO_KEEP);
     // Just show the next two forecasts.
     showForecast1(forecast[0]);
     showForecast2(forecast[1]);
@@ -138,14 +318,14 @@ void AppController::showForecast2 (weather::Entry const & entry)
 void AppController::showForecast (weather::Entry const & entry, ForecastView * & view, size_t yPosition)
 {
     time_t timeZoneDiff = Iso::timeZoneToUnixTimeStampDiff(timeZone.c_str());
-    time_t unixTime = atoi((char const*)entry.timeUnix) + timeZoneDiff;
+    time_t unixTime = time_t(entry.timeUnix) + timeZoneDiff;
     tm * timeInfo = localtime(&unixTime);
     debug(String::Format("time %.2u:%.2u",timeInfo->tm_hour,timeInfo->tm_min));
-    char const * icon = conditionToIcon(entry.condition);
+    char const * icon = conditionToIcon(weather::Condition(entry.condition));
     String time = convertTimeAccordingToConf(timeInfo->tm_hour,timeInfo->tm_min);
-    String temperature = convertTemperatureAccordingToConf(entry.temperatureK);
-    String wind = convertWindAccordingToConf(entry.windSpeedMs,entry.windDirection);
-    String rain = convertRainAccordingToConf(entry.rain);
+    String temperature = convertTemperatureAccordingToConf(entry.temperatureCentiK);
+    String wind = convertWindAccordingToConf(entry.windSpeedCentiMs,entry.windDirectionDeciDegrees);
+    String rain = convertRainAccordingToConf(entry.hasRain,entry.rainCentiMm);
     view = new ForecastView(time,icon,temperature,wind,rain);
     view->setPosition(Point(0,yPosition));
     view->show();
@@ -154,43 +334,23 @@ void AppController::showForecast (weather::Entry const & entry, ForecastView * &
 char const * AppController::conditionToIcon (weather::Condition condition)
 {
     debug(String::Format("condition %d", condition));
-    switch (condition)
-    {
-        case weather::Day_ClearSky: return "/sd/mono/weather/Day_ClearSky.bmp";
-        case weather::Day_FewClouds: return "/sd/mono/weather/Day_FewClouds.bmp";
-        case weather::Day_ScatteredClouds: return "/sd/mono/weather/Day_ScatteredClouds.bmp";
-        case weather::Day_Overcast: return "/sd/mono/weather/Day_Overcast.bmp";
-        case weather::Day_Rain: return "/sd/mono/weather/Day_Rain.bmp";
-        case weather::Day_ShowerRain: return "/sd/mono/weather/Day_ShowerRain.bmp";
-        case weather::Day_Thunder: return "/sd/mono/weather/Day_Thunder.bmp";
-        case weather::Day_Snow: return "/sd/mono/weather/Day_Snow.bmp";
-        case weather::Day_Mist: return "/sd/mono/weather/Day_Mist.bmp";
-        case weather::Night_ClearSky: return "/sd/mono/weather/Night_ClearSky.bmp";
-        case weather::Night_FewClouds: return "/sd/mono/weather/Night_FewClouds.bmp";
-        case weather::Night_ScatteredClouds: return "/sd/mono/weather/Night_ScatteredClouds.bmp";
-        case weather::Night_Overcast: return "/sd/mono/weather/Night_Overcast.bmp";
-        case weather::Night_Rain: return "/sd/mono/weather/Night_Rain.bmp";
-        case weather::Night_ShowerRain: return "/sd/mono/weather/Night_Rain.bmp";
-        case weather::Night_Thunder: return "/sd/mono/weather/Night_Thunder.bmp";
-        case weather::Night_Snow: return "/sd/mono/weather/Night_Snow.bmp";
-        case weather::Night_Mist: return "/sd/mono/weather/Day_Mist.bmp";
-        default:
-        case weather::Unknown: return "/sd/mono/weather/Night_Snow.bmp";
-    }
+    if (condition > weather::Unknown) condition = weather::Unknown;
+    return conditionAssets[condition];
 }
 
-String AppController::convertTemperatureAccordingToConf (uint8_t const * temperatureK)
+String AppController::convertTemperatureAccordingToConf (int32_t centiKelvin)
 {
+    int32_t centiCelsius = centiKelvin - 27315;
     if (unit == MONO_WEATHER_METRIC)
     {
-        int temp = atoi((char const *)temperatureK) - 273;
+        int temp = roundedDivide(centiCelsius,100);
         debug(String::Format("temperature %d", temp));
         String temperature = String::Format("%d C",temp);
         return temperature;
     }
     else
     {
-        int temp = (atoi((char const *)temperatureK) - 273) * 1.8 + 32;
+        int temp = roundedDivide(centiCelsius * 9 + 5 * 3200,5 * 100);
         debug(String::Format("temperature %d", temp));
         String temperature = String::Format("%d F",temp);
         return temperature;
@@ -206,29 +366,26 @@ String AppController::convertTimeAccordingToConf (int hours, int minutes)
     return String::Format("%u am",hours);
 }
 
-String AppController::convertWindAccordingToConf (uint8_t const * windSpeedMs, uint8_t const * windDirection)
+String AppController::convertWindAccordingToConf (int32_t centiSpeed, int32_t deciDirection)
 {
-    debug(String::Format("wind: %s",(char const *)windSpeedMs));
-    float msSpeed = atof((char const *)windSpeedMs);
+    debug(String::Format("wind: %d cm/s",(int)centiSpeed));
     if (unit == MONO_WEATHER_METRIC)
-        return String::Format("%u m/s",(unsigned)(msSpeed+0.5));
+        return String::Format("%u m/s",(unsigned)roundedDivide(centiSpeed,100));
     else
-        return String::Format("%u mi/h",(unsigned)(2.237*msSpeed+0.5));
+        return String::Format("%u mi/h",(unsigned)roundedDivide(centiSpeed * 2237,100000));
 }
 
-String AppController::convertRainAccordingToConf (uint8_t const * rain)
+String AppController::convertRainAccordingToConf (bool hasRain, int32_t centiRain)
 {
-    debug(String::Format("rain: %s",(char const *)rain));
-    if (strlen((char const *)rain) == 0)
-        return String((char const *)rain);
-    float mmRain = atof((char const *)rain);
+    debug(String::Format("rain: %d", (int)centiRain));
+    if (! hasRain)
+        return String("");
     if (unit == MONO_WEATHER_METRIC)
-        return String::Format("%u mm",(unsigned)(mmRain+0.5));
+        return String::Format("%u mm",(unsigned)roundedDivide(centiRain,100));
     else
     {
-        float inch = mmRain*0.03937;
-        float fraction = inch - (unsigned)inch;
-        return String::Format("%u.%.2u in",(unsigned)inch,(unsigned)(fraction*100));
+        unsigned centiInch = centiRain * 3937 / 100000;
+        return String::Format("%u.%.2u in",centiInch / 100,centiInch % 100);
     }
 }
 
@@ -277,9 +434,12 @@ void AppController::networkReadyHandler ()
 {
     debug("Network ready");
     topLabel.setText("Using network");
+    // The snapshot would show the previous forecast once this one is written.
+    String snapshotPath = SdCard::get().fullPath((char const *)MONO_WEATHER_SNAPSHOT);
+    ::remove(snapshotPath());
     String previousForecast = (char const *)MONO_WEATHER_FORECAST;
     buffer.attach(previousForecast);
-    buffer.clear();
+    filter.clear();
     if (buffer.status() != SdCardByteBuffer::SdBuffer_OK)
         return error("SD card problem",String::Format("Could not create forecast buffer %s on SD card",previousForecast()));
     if (conf.get(MONO_WEATHER_CITY) == 0)
@@ -297,7 +457,18 @@ void AppController::networkReadyHandler ()
         MONO_OPENWEATHERMAP_APPID
     );
     debug(url);
-    wifi->get(castToBytes(url()),&buffer,this,&AppController::handleWifiResult,&AppController::handleWifiStatus);
+    // The new forecast is decoded while it arrives, so the strings of the
+    // previous one can go.
+    results.reset();
+    if (0 == decoder)
+    {
+        decoder = new openweathermap::ForecastDecoder(FORECASTS_TO_KEEP,results);
+        parser = new json::PushParser(*decoder);
+    }
+    decoder->restart();
+    parser->restart();
+    wifi->setParser(parser);
+    wifi->get(castToBytes(url()),&filter,this,&AppController::handleWifiResult,&AppController::handleWifiStatus);
 }
 
 void AppController::handleWifiStatus (Wifi::Status status)
@@ -337,7 +508,14 @@ void AppController::handleWifiResult (IByteBuffer *)
     topLabel.setText("Got forecast"),
     topLabel.show();
     setupTimersAndHandler();
-    asyncCall(&AppController::interpretForecast);
+    // A download that was cut off or broken leaves no forecast behind.
+    if (! filter.finish()) debug("Forecast was broken or incomplete");
+    // Only read the forecast back from the SD card if it could not be
+    // decoded while it arrived.
+    if (parser->isDone() && decoder->forecast().size() >= SNAPSHOT_MIN_ENTRIES)
+        asyncCall(&AppController::showDecodedForecast);
+    else
+        asyncCall(&AppController::interpretForecast);
 }
 
 void AppController::setupTimersAndHandler ()
@@ -5,12 +5,20 @@
 #include <mono.h>
 #include <vector>
 #include "forecastview.hpp"
+#include "lib/arena.hpp"
+#include "lib/filesegmentstore.hpp"
+#include "lib/filterbytebuffer.hpp"
+#include "lib/history.hpp"
+#include "lib/jsonparser.hpp"
+#include "lib/snapshot.hpp"
 #include "lib/weather.hpp"
 #include "sdcardbytebuffer.hpp"
 #include "sdcardconfiguration.hpp"
 #include "toucher.hpp"
 #include "wifi.hpp"
 
+namespace openweathermap { class ForecastDecoder; }
+
 class AppController
 :
     public mono::IApplication
@@ -20,17 +28,33 @@ class AppController
     mono::ui::TextLabelView topLabel;
     Wifi * wifi;
     SdCardByteBuffer buffer;
+    FilterByteBuffer filter;
     SdCardConfiguration conf;
     ByteString timeZone;
     ByteString unit;
     mono::Timer dimmer;
     mono::Timer sleeper;
+    uint8_t resultMemory[0x400];
+    Arena results;
+    json::Json json;
     std::vector<weather::Entry> forecast;
+    weather::Snapshot snapshot;
+    FileSegmentStore * historyStore;
+    weather::History * history;
+    openweathermap::ForecastDecoder * decoder;
+    json::PushParser * parser;
     ForecastView * view1;
     ForecastView * view2;
     void readForecastFromSdCardAndShow ();
     void getNewForecast ();
     void interpretForecast ();
+    bool readSnapshot ();
+    void writeSnapshot (uint8_t const * city);
+    void recordHistory ();
+    void keepForecast (uint8_t const * city);
+    void showDecodedForecast ();
+    bool readDisplayConf ();
+    void showForecasts (uint8_t const * city);
     void dim ();
     void undim ();
     void networkReadyHandler ();
@@ -41,10 +65,10 @@ class AppController
     void showForecast2 (weather::Entry const &);
     void showForecast (weather::Entry const & entry, ForecastView * & view, size_t yPosition);
     char const * conditionToIcon (weather::Condition condition);
-    mono::String convertTemperatureAccordingToConf (uint8_t const * temperatureK);
+    mono::String convertTemperatureAccordingToConf (int32_t centiKelvin);
     mono::String convertTimeAccordingToConf (int hours, int minutes);
-    mono::String convertWindAccordingToConf (uint8_t const * windSpeedMs, uint8_t const * windDirection);
-    mono::String convertRainAccordingToConf (uint8_t const * rain);
+    mono::String convertWindAccordingToConf (int32_t centiSpeed, int32_t deciDirection);
+    mono::String convertRainAccordingToConf (bool hasRain, int32_t centiRain);
     void setupTimersAndHandler ();
     void error (mono::String shortMsg, mono::String longMsg);
     void debug (mono::String msg);
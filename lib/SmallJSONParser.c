@@ -2,6 +2,18 @@
 
 #include <string.h>
 
+#if !defined(SMALL_JSON_PARSER_BYTEWISE) && !defined(SMALL_JSON_PARSER_SWAR)
+#if defined(__AVX2__)
+#include <immintrin.h>
+#define SMALL_JSON_PARSER_AVX2
+#elif defined(__SSE2__)
+#include <emmintrin.h>
+#define SMALL_JSON_PARSER_SSE2
+#else
+#define SMALL_JSON_PARSER_SWAR
+#endif
+#endif
+
 void InitialiseJSONParser(JSONParser *self)
 {
 	memset(self,0,sizeof(JSONParser));
@@ -21,6 +33,120 @@ void ProvideJSONInput(JSONParser *self,const uint8_t *bytes,size_t length)
 
 #define ParseError() do { token.typeandflags=ParseErrorJSONToken; token.end=self->currentbyte; return token; } while(0)
 
+// ### Fast scanning ###
+//
+// Most of the bytes in a document are inside strings or are indentation. The
+// scanning functions below skip over runs of those several bytes at a time,
+// and stop at the first byte that needs to be looked at by the state machine.
+// Which implementation is used is decided at compile time: AVX2 or SSE2 where
+// the compiler targets them, otherwise a portable word-at-a-time version.
+// Define SMALL_JSON_PARSER_SWAR to use the word-at-a-time version anyway, or
+// SMALL_JSON_PARSER_BYTEWISE to only use the state machine.
+
+#if defined(SMALL_JSON_PARSER_SWAR)
+
+typedef uintptr_t JSONWord;
+
+#define RepeatByte(b) ((JSONWord)-1/0xff*(b))
+#define HasZeroByte(x) (((x)-RepeatByte(0x01))&~(x)&RepeatByte(0x80))
+
+static inline JSONWord LoadWord(const uint8_t *bytes)
+{
+	JSONWord word;
+	memcpy(&word,bytes,sizeof(word));
+	return word;
+}
+
+#endif
+
+// Returns a pointer to the first byte from `start` that can not be part of the
+// plain body of a string: a quote, a backslash, a control character or a byte
+// of 127 or more.
+static inline const uint8_t *ScanStringBody(const uint8_t *start,const uint8_t *end)
+{
+#if defined(SMALL_JSON_PARSER_AVX2)
+	const __m256i quote=_mm256_set1_epi8('"');
+	const __m256i backslash=_mm256_set1_epi8('\\');
+	const __m256i space=_mm256_set1_epi8(' ');
+	const __m256i del=_mm256_set1_epi8(127);
+	while(end-start>=32)
+	{
+		__m256i bytes=_mm256_loadu_si256((const __m256i *)start);
+		// Signed compare, so that bytes of 128 or more count as less than space.
+		__m256i special=_mm256_or_si256(
+			_mm256_or_si256(_mm256_cmpeq_epi8(bytes,quote),_mm256_cmpeq_epi8(bytes,backslash)),
+			_mm256_or_si256(_mm256_cmpgt_epi8(space,bytes),_mm256_cmpeq_epi8(bytes,del)));
+		unsigned int mask=(unsigned int)_mm256_movemask_epi8(special);
+		if(mask) return start+__builtin_ctz(mask);
+		start+=32;
+	}
+#elif defined(SMALL_JSON_PARSER_SSE2)
+	const __m128i quote=_mm_set1_epi8('"');
+	const __m128i backslash=_mm_set1_epi8('\\');
+	const __m128i space=_mm_set1_epi8(' ');
+	const __m128i del=_mm_set1_epi8(127);
+	while(end-start>=16)
+	{
+		__m128i bytes=_mm_loadu_si128((const __m128i *)start);
+		// Signed compare, so that bytes of 128 or more count as less than space.
+		__m128i special=_mm_or_si128(
+			_mm_or_si128(_mm_cmpeq_epi8(bytes,quote),_mm_cmpeq_epi8(bytes,backslash)),
+			_mm_or_si128(_mm_cmplt_epi8(bytes,space),_mm_cmpeq_epi8(bytes,del)));
+		unsigned int mask=(unsigned int)_mm_movemask_epi8(special);
+		if(mask) return start+__builtin_ctz(mask);
+		start+=16;
+	}
+#elif defined(SMALL_JSON_PARSER_SWAR)
+	while(end-start>=(ptrdiff_t)sizeof(JSONWord))
+	{
+		JSONWord word=LoadWord(start);
+		JSONWord special=
+			HasZeroByte(word^RepeatByte('"'))|
+			HasZeroByte(word^RepeatByte('\\'))|
+			HasZeroByte(word^RepeatByte(127))|
+			((word-RepeatByte(' '))&~word)|
+			word;
+		if(special&RepeatByte(0x80)) break;
+		start+=sizeof(JSONWord);
+	}
+#endif
+	while(start<end)
+	{
+		uint8_t c=*start;
+		if(c=='"' || c=='\\' || c<=31 || c>=127) break;
+		start++;
+	}
+	return start;
+}
+
+// Returns a pointer to the first byte from `start` that is not a space.
+static inline const uint8_t *ScanSpaces(const uint8_t *start,const uint8_t *end)
+{
+#if defined(SMALL_JSON_PARSER_AVX2)
+	const __m256i space=_mm256_set1_epi8(' ');
+	while(end-start>=32)
+	{
+		__m256i bytes=_mm256_loadu_si256((const __m256i *)start);
+		unsigned int mask=~(unsigned int)_mm256_movemask_epi8(_mm256_cmpeq_epi8(bytes,space));
+		if(mask) return start+__builtin_ctz(mask);
+		start+=32;
+	}
+#elif defined(SMALL_JSON_PARSER_SSE2)
+	const __m128i space=_mm_set1_epi8(' ');
+	while(end-start>=16)
+	{
+		__m128i bytes=_mm_loadu_si128((const __m128i *)start);
+		unsigned int mask=0xffff&~(unsigned int)_mm_movemask_epi8(_mm_cmpeq_epi8(bytes,space));
+		if(mask) return start+__builtin_ctz(mask);
+		start+=16;
+	}
+#elif defined(SMALL_JSON_PARSER_SWAR)
+	while(end-start>=(ptrdiff_t)sizeof(JSONWord) && LoadWord(start)==RepeatByte(' ')) start+=sizeof(JSONWord);
+#endif
+	while(start<end && *start==' ') start++;
+	return start;
+}
+
 JSONToken NextJSONToken(JSONParser *self)
 {
 	JSONToken token={
@@ -33,6 +159,11 @@ JSONToken NextJSONToken(JSONParser *self)
 
 	while(self->currentbyte<self->end)
 	{
+#if !defined(SMALL_JSON_PARSER_BYTEWISE)
+		if(self->state==StringState) self->currentbyte=ScanStringBody(self->currentbyte,self->end);
+		else if(self->state==BaseState) self->currentbyte=ScanSpaces(self->currentbyte,self->end);
+		if(self->currentbyte==self->end) break;
+#endif
 		uint8_t c=*self->currentbyte++;
 		switch(self->state)
 		{
@@ -178,10 +309,15 @@ JSONToken NextJSONTokenWithProvider(JSONParser *self,JSONProvider *provider)
 		if(JSONTokenType(token)!=OutOfDataJSONToken)
 		{
 			// Otherwise, calculate how much more data we can fit into the
-			// buffer, and set the truncated flag if we can't fit all of it.
+			// buffer, growing it if the provider can, and set the truncated
+			// flag if we can't fit all of it.
 			// Use the buffer size -1, so that a terminating zero byte can
 			// be added later by the unescaping function.
 			size_t bytestocopy=token.end-token.start;
+			if(bufferposition+bytestocopy>provider->buffersize-1 && provider->grow)
+			{
+				provider->grow(provider,bufferposition+bytestocopy+1);
+			}
 			if(bufferposition+bytestocopy>provider->buffersize-1)
 			{
 				bytestocopy=provider->buffersize-1-bufferposition;
@@ -191,6 +327,7 @@ JSONToken NextJSONTokenWithProvider(JSONParser *self,JSONProvider *provider)
 			// Copy this fragment into the buffer.
 			memcpy(&provider->buffer[bufferposition],token.start,bytestocopy);
 			bufferposition+=bytestocopy;
+			provider->reassembledbytes+=bytestocopy;
 
 			// If this was the last fragment, exit the loop and return the
 			// data we have collected.
@@ -405,7 +542,11 @@ bool SkipUntilEndOfJSONArrayWithProvider(JSONParser *self,JSONProvider *provider
 
 bool SkipUntilJSONObjectKeyWithProvider(JSONParser *self,JSONProvider *provider,const char *key)
 {
-	size_t keylength=strlen(key);
+	return SkipUntilJSONObjectKeyWithLengthWithProvider(self,provider,key,strlen(key));
+}
+
+bool SkipUntilJSONObjectKeyWithLengthWithProvider(JSONParser *self,JSONProvider *provider,const char *key,size_t keylength)
+{
 	for(;;)
 	{
 		JSONToken token;
@@ -425,29 +566,111 @@ bool ExpectAndSkipUntilJSONObjectKeyWithProvider(JSONParser *self,JSONProvider *
 	return SkipUntilJSONObjectKeyWithProvider(self,provider,key);
 }
 
+// Skips values without producing tokens, by only following strings, escapes
+// and bracket nesting. Nothing is copied into the buffer of the provider.
+// `level` is the number of brackets already open, and the function returns
+// when they and any value started inside them have been closed.
 static bool ParseBraces(JSONParser *self,JSONProvider *provider,int level)
 {
+	self->partialtokentype=OutOfDataJSONToken;
+
 	for(;;)
 	{
-		JSONToken token;
-		if(provider) token=NextJSONTokenWithProvider(self,provider);
-		else token=NextJSONToken(self);
-
-		int type=JSONTokenType(token);
-		if(type==StartObjectJSONToken || type==StartArrayJSONToken)
+		if(self->currentbyte==self->end)
 		{
-			level++;
+			if(provider && provider->callback(self,provider->context)) continue;
+			// A bare symbol at the top can only end with the data.
+			return self->state==BareSymbolState && level==0;
 		}
-		else if(type==EndObjectJSONToken || type==EndArrayJSONToken)
-		{
-			level--;
-			if(level<0) return false;
-		}
-		else if(type==OutOfDataJSONToken || type==ParseErrorJSONToken)
+
+		uint8_t c;
+		switch(self->state)
 		{
-			return false;
-		}
+			case BaseState:
+				self->currentbyte=ScanSpaces(self->currentbyte,self->end);
+				if(self->currentbyte==self->end) break;
+				c=*self->currentbyte++;
+				switch(c)
+				{
+					case '\t': case ' ': case '\r': case '\n': case ':': case ',':
+						break;
+
+					case '"':
+						self->state=StringState;
+						break;
+
+					case '[': case '{':
+						level++;
+						break;
 
-		if(level==0) return true;
+					case ']': case '}':
+						level--;
+						if(level<0) return false;
+						if(level==0) return true;
+						break;
+
+					case '-':
+					case '0': case '1': case '2': case '3': case '4':
+					case '5': case '6': case '7': case '8': case '9':
+					case 't': case 'f': case 'n':
+						self->state=BareSymbolState;
+						break;
+
+					default:
+						return false;
+				}
+			break;
+
+			case BareSymbolState:
+				c=*self->currentbyte;
+				switch(c)
+				{
+					case '\t': case ' ': case '\r': case '\n': case ',': case ':':
+						self->currentbyte++;
+						self->state=BaseState;
+						if(level==0) return true;
+						break;
+					case ']': case '}':
+						self->state=BaseState;
+						if(level==0) return true;
+						break;
+					default:
+						if(c<=31 || c>=127) return false;
+						self->currentbyte++;
+						break;
+				}
+			break;
+
+			case StringState:
+				self->currentbyte=ScanStringBody(self->currentbyte,self->end);
+				if(self->currentbyte==self->end) break;
+				c=*self->currentbyte++;
+				switch(c)
+				{
+					case '\\':
+						self->state=StringEscapeState;
+						break;
+					case '"':
+						self->state=BaseState;
+						if(level==0) return true;
+						break;
+					default:
+						if(c<=31 || (c>=127 && c<=191)) return false;
+						break;
+				}
+			break;
+
+			case StringEscapeState:
+				c=*self->currentbyte++;
+				switch(c)
+				{
+					case '"': case '\\': case '/': case 'b':
+					case 'f': case 'n': case 'r': case 't': case 'u':
+						self->state=StringState;
+					break;
+					default: return false;
+				}
+			break;
+		}
 	}
 }
@@ -148,11 +148,12 @@ static inline bool IsJSONTokenPartial(JSONToken token) { return token.typeandfla
 // token will be pointing into the reconstruction buffer instead of into the
 // original data.
 //
-// As the reconstruction buffer is of fixed size, if a value is too big to fit
-// into the provided memory, it is truncated to fit, and any remaining data is
-// discarded. If this is a problem, you should use the minimal API to handle
-// reconstructing tokens yourself, or just load the entire JSON struture into
-// memory so there are no buffer boundaries to deal with.
+// Unless the provider has a callback to grow it, the reconstruction buffer is
+// of fixed size, so if a value is too big to fit into the provided memory, it
+// is truncated to fit, and any remaining data is discarded. If this is a
+// problem, you should use the minimal API to handle reconstructing tokens
+// yourself, or just load the entire JSON struture into memory so there are no
+// buffer boundaries to deal with.
 
 // #### Functions ####
 
@@ -165,11 +166,25 @@ static inline bool IsJSONTokenPartial(JSONToken token) { return token.typeandfla
 // indicate that there is no more input available.
 typedef bool JSONInputProviderCallbackFunction(JSONParser *parser,void *context);
 
+struct JSONProvider;
+
+// A buffer growing callback function. `provider` is the `JSONProvider` whose
+// buffer is too small to reassemble a token, and `needed` is the number of
+// bytes required.
+//
+// The function should point the `buffer` of `provider` to memory of at least
+// `needed` bytes, holding a copy of the contents of the old buffer, update
+// `buffersize`, and return `true`. Alternatively, it should return `false` to
+// have the token truncated.
+typedef bool JSONBufferGrowCallbackFunction(struct JSONProvider *provider,size_t needed);
+
 typedef struct JSONProvider {
 	JSONInputProviderCallbackFunction *callback;
 	void *context;
 	uint8_t *buffer;
 	size_t buffersize;
+	JSONBufferGrowCallbackFunction *grow;
+	size_t reassembledbytes;
 } JSONProvider;
 
 // Initialise a `JSONProvider` structure. `JSONParser` is responsible for
@@ -192,6 +207,16 @@ JSONInputProviderCallbackFunction *callback,void *context,uint8_t *buffer,size_t
 	self->context=context;
 	self->buffer=buffer;
 	self->buffersize=buffersize;
+	self->grow=NULL;
+	self->reassembledbytes=0;
+}
+
+// Let the `JSONProvider` `self` grow its buffer through `grow` instead of
+// truncating tokens that do not fit. The `reassembledbytes` field counts the
+// bytes copied into the buffer while reassembling tokens.
+static inline void SetJSONProviderGrowCallback(JSONProvider *self,JSONBufferGrowCallbackFunction *grow)
+{
+	self->grow=grow;
 }
 
 // Find the next token from the JSON data being parsed by the `JSONParser`
@@ -224,12 +249,13 @@ static inline bool IsJSONTokenTruncated(JSONToken token) { return token.typeandf
 
 // ### Token parsing API ###
 //
-// These functions help with extracting data from string and number values.
-// Numbers can be parsed both as integers ~or floating-point~ values. Strings can
-// be processed to expand escape codes, including Unicode escapes which are
-// converted into UTF-8. String escape expansion can either be done in-place or
-// into a separate buffer. If it is done in-place, the original data buffer is
-// modified, so make sure this is possible and acceptable.
+// These functions help with extracting data from string values. Numbers are
+// converted by `Decimal::toFixed()`, or on hosts also by `Decimal::toDouble()`,
+// both in decimal.hpp. Strings can be processed to expand escape codes,
+// including Unicode escapes which are converted into UTF-8. String escape
+// expansion can either be done in-place or into a separate buffer. If it is
+// done in-place, the original data buffer is modified, so make sure this is
+// possible and acceptable.
 
 // #### Functions ####
 
@@ -329,6 +355,11 @@ bool SkipUntilEndOfJSONArrayWithProvider(JSONParser *self,JSONProvider *provider
 // token for this array.
 bool SkipUntilJSONObjectKeyWithProvider(JSONParser *self,JSONProvider *provider,const char *key);
 
+// Skip through the keys and values of a JSON object until a key with value
+// `key`, for which the length is already known, is reached. Otherwise the same
+// as `SkipUntilJSONObjectKeyWithProvider()`.
+bool SkipUntilJSONObjectKeyWithLengthWithProvider(JSONParser *self,JSONProvider *provider,const char *key,size_t length);
+
 // Find the next token from the JSON data being parsed by the `JSONParser`,
 // and check that it is the start of an object. If it is, skip through the keys
 // and values of a JSON object until a key with value `key` is reached. No
@@ -342,6 +373,7 @@ static inline bool ExpectAndSkipJSONValueOfType(JSONParser *self,int expectedtyp
 static inline bool SkipUntilEndOfJSONObject(JSONParser *self) { return SkipUntilEndOfJSONObjectWithProvider(self,NULL); }
 static inline bool SkipUntilEndOfJSONArray(JSONParser *self) { return SkipUntilEndOfJSONArrayWithProvider(self,NULL); }
 static inline bool SkipUntilJSONObjectKey(JSONParser *self,const char *key) { return SkipUntilJSONObjectKeyWithProvider(self,NULL,key); }
+static inline bool SkipUntilJSONObjectKeyWithLength(JSONParser *self,const char *key,size_t length) { return SkipUntilJSONObjectKeyWithLengthWithProvider(self,NULL,key,length); }
 static inline bool ExpectAndSkipUntilJSONObjectKey(JSONParser *self,const char *key) { return ExpectAndSkipUntilJSONObjectKeyWithProvider(self,NULL,key); }
 
 // ## License ##
@@ -0,0 +1,93 @@
+// This software is part of OpenMono, see http://developer.openmono.com
+// Released under the MIT license, see LICENSE.txt
+#include "arena.hpp"
+
+Arena::Arena (size_t blockSize_)
+:
+    blockSize(blockSize_),
+    fixed(false)
+{
+    reset();
+}
+
+Arena::Arena (uint8_t * memory, size_t size)
+:
+    blockSize(size),
+    fixed(true)
+{
+    Block block;
+    block.memory = memory;
+    block.size = size;
+    blocks.push_back(block);
+    reset();
+}
+
+Arena::~Arena ()
+{
+    if (fixed) return;
+    for (size_t i = 0; i < blocks.size(); ++i) delete [] blocks[i].memory;
+}
+
+uint8_t * Arena::allocate (size_t bytes)
+{
+    while (top.block < blocks.size() && top.offset + bytes > blocks[top.block].size)
+    {
+        if (fixed) return 0;
+        // Move on to the next block, or put a big enough one in front of it.
+        ++top.block;
+        top.offset = 0;
+        if (top.block < blocks.size() && bytes > blocks[top.block].size)
+        {
+            Block block;
+            block.size = bytes;
+            block.memory = new uint8_t[block.size];
+            blocks.insert(blocks.begin()+top.block,block);
+        }
+    }
+    if (top.block == blocks.size())
+    {
+        if (fixed) return 0;
+        Block block;
+        block.size = (bytes > blockSize) ? bytes : blockSize;
+        block.memory = new uint8_t[block.size];
+        blocks.push_back(block);
+    }
+    uint8_t * memory = blocks[top.block].memory + top.offset;
+    top.offset += bytes;
+    top.used += bytes;
+    return memory;
+}
+
+void Arena::reset ()
+{
+    top.block = 0;
+    top.offset = 0;
+    top.used = 0;
+}
+
+size_t Arena::used () const
+{
+    return top.used;
+}
+
+Arena::Mark Arena::mark () const
+{
+    return top;
+}
+
+void Arena::rewind (Mark const & mark)
+{
+    top = mark;
+}
+
+Arena::Scope::Scope (Arena & arena_)
+:
+    arena(arena_),
+    start(arena_.mark())
+{
+}
+
+Arena::Scope::~Scope ()
+{
+    arena.rewind(start);
+}
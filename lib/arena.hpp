@@ -0,0 +1,98 @@
+// This software is part of OpenMono, see http://developer.openmono.com
+// Released under the MIT license, see LICENSE.txt
+#if !defined(__com_openmono_arena_h)
+#define __com_openmono_arena_h
+#include <stdint.h>
+#include <stddef.h>
+#include <vector>
+
+#define DEFAULT_ARENA_BLOCKSIZE 0x200
+
+/**
+ * Arena hands out memory by bumping a pointer, and frees everything it has
+ * handed out at once.
+ *
+ * A growable arena takes blocks from the heap as needed and keeps them for
+ * reuse after reset.  A fixed arena uses memory supplied by the caller and
+ * never touches the heap; allocations that do not fit return 0.
+ *
+ * Examples:
+ *
+ *      Arena results;
+ *      uint8_t * bytes = results.allocate(10);
+ *      results.reset();
+ *
+ *      {
+ *          Arena::Scope scope(results);
+ *          // Everything allocated here is freed at the end of the scope.
+ *      }
+ */
+class Arena
+{
+public:
+    /**
+     * Growable arena.
+     * @param blockSize bytes to take from the heap at a time.
+     */
+    Arena (size_t blockSize = DEFAULT_ARENA_BLOCKSIZE);
+    /**
+     * Fixed arena.
+     * @param memory memory to hand out, expected to live as long as the arena.
+     * @param size   bytes in memory.
+     */
+    Arena (uint8_t * memory, size_t size);
+    ~Arena ();
+    /**
+     * @param  bytes number of bytes needed.
+     * @return       pointer to the memory, or 0 if a fixed arena is full.
+     */
+    uint8_t * allocate (size_t bytes);
+    /**
+     * Free everything allocated.
+     */
+    void reset ();
+    /**
+     * @return number of bytes handed out since the last reset.
+     */
+    size_t used () const;
+    /**
+     * Position in an arena that it can be rewound to.
+     */
+    struct Mark
+    {
+        size_t block;
+        size_t offset;
+        size_t used;
+    };
+    Mark mark () const;
+    /**
+     * Free everything allocated after mark was taken.
+     */
+    void rewind (Mark const & mark);
+    /**
+     * Frees everything allocated in an arena during its own lifetime.
+     */
+    class Scope
+    {
+    public:
+        Scope (Arena & arena);
+        ~Scope ();
+    private:
+        Arena & arena;
+        Mark start;
+    };
+private:
+    struct Block
+    {
+        uint8_t * memory;
+        size_t size;
+    };
+    std::vector<Block> blocks;
+    size_t blockSize;
+    bool fixed;
+    Mark top;
+    Arena (Arena const &);
+    Arena & operator = (Arena const &);
+};
+
+#endif // __com_openmono_arena_h
@@ -0,0 +1,45 @@
+// This software is part of OpenMono, see http://developer.openmono.com
+// Released under the MIT license, see LICENSE.txt
+#if !defined(__com_openmono_byteview_h)
+#define __com_openmono_byteview_h
+#include <stdint.h>
+#include <stddef.h>
+#include <string.h>
+
+/**
+ * Bytes owned by someone else, which are not null-terminated.
+ */
+struct ByteView
+{
+    uint8_t const * bytes;
+    size_t length;
+    ByteView ()
+    :
+        bytes(0),
+        length(0)
+    {
+    }
+    ByteView (uint8_t const * bytes_, size_t length_)
+    :
+        bytes(bytes_),
+        length(length_)
+    {
+    }
+    /**
+     * @return true if the view is of nothing, as opposed to of no bytes.
+     */
+    bool isNull () const
+    {
+        return 0 == bytes;
+    }
+    bool operator == (char const * rhs) const
+    {
+        return bytes != 0 && strlen(rhs) == length && memcmp(bytes,rhs,length) == 0;
+    }
+    bool operator != (char const * rhs) const
+    {
+        return !(operator==(rhs));
+    }
+};
+
+#endif // __com_openmono_byteview_h
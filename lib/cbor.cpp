@@ -0,0 +1,490 @@
+// This software is part of OpenMono, see http://developer.openmono.com
+// Released under the MIT license, see LICENSE.txt
+#include "cbor.hpp"
+#include "decimal.hpp"
+#include <math.h>
+#include <stdio.h>
+#include <string.h>
+
+using json::IJsonVisitor;
+using json::JsonContext;
+using json::JsonPath;
+
+namespace {
+
+enum Major
+{
+    UnsignedMajor, NegativeMajor, BytesMajor, TextMajor, ArrayMajor, MapMajor, TagMajor, SimpleMajor
+};
+
+enum Simple
+{
+    FalseSimple = 20, TrueSimple = 21, NullSimple = 22, UndefinedSimple = 23,
+    HalfFloat = 25, SingleFloat = 26, DoubleFloat = 27
+};
+
+uint8_t const * copyValue (JSONToken token, Arena & results)
+{
+    uint8_t * buf = results.allocate(SizeOfUnescapingBufferForJSONStringToken(token));
+    if (0 == buf) return 0;
+    UnescapeJSONStringToken(token,buf,0);
+    return buf;
+}
+
+double halfToDouble (uint16_t half)
+{
+    int exponent = (half >> 10) & 0x1f;
+    int mantissa = half & 0x3ff;
+    double value = (exponent == 0) ? ldexp(double(mantissa),-24) : ldexp(double(mantissa + 0x400),exponent - 25);
+    return (half & 0x8000) ? -value : value;
+}
+
+/**
+ * Write a number in the shortest form that reads back as the same number.
+ * Without Decimal::toDouble every digit that might be needed is written.
+ * @param single true for a number that was sent at single precision.
+ */
+void formatNumber (double value, bool single, char * text, size_t size)
+{
+    // At most this many significant digits are needed to read back exactly.
+    int digits = single ? 9 : 17;
+#if defined(DECIMAL_DOUBLE)
+    for (int precision = 1; precision < digits; ++precision)
+    {
+        snprintf(text,size,"%.*g",precision,value);
+        double back = 0;
+        Decimal::toDouble((uint8_t const *)text,strlen(text),&back);
+        if (single ? float(back) == float(value) : back == value) return;
+    }
+#endif
+    snprintf(text,size,"%.*g",digits,value);
+}
+
+void formatUnsigned (uint64_t value, char * text)
+{
+    char reversed[24];
+    size_t length = 0;
+    do
+    {
+        reversed[length++] = '0' + value % 10;
+        value /= 10;
+    }
+    while (value != 0);
+    while (length > 0) *text++ = reversed[--length];
+    *text = 0;
+}
+
+} // namespace {
+
+namespace cbor {
+
+Cbor::Cbor (IByteBuffer const & byteBuffer_)
+:
+    byteBuffer(byteBuffer_),
+    nextChunkIndex(0),
+    chunk(0),
+    chunkBytes(0),
+    offset(0),
+    resultArena(ownResults)
+{
+}
+
+Cbor::Cbor (IByteBuffer const & byteBuffer_, Arena & results_)
+:
+    byteBuffer(byteBuffer_),
+    nextChunkIndex(0),
+    chunk(0),
+    chunkBytes(0),
+    offset(0),
+    resultArena(results_)
+{
+}
+
+Arena & Cbor::results ()
+{
+    return resultArena;
+}
+
+bool Cbor::isCbor (IByteBuffer const & byteBuffer)
+{
+    if (byteBuffer.chunks() == 0 || byteBuffer.chunkBytes(0) == 0) return false;
+    return byteBuffer.chunk(0)[0] >= 0x80;
+}
+
+uint8_t const * Cbor::lookup (char const * path)
+{
+    return lookup(JsonPath(path));
+}
+
+uint8_t const * Cbor::lookup (JsonPath const & path, size_t index)
+{
+    Head head;
+    if (! find(path,index,head)) return 0;
+    JSONToken token;
+    if (! readScalar(head,token)) return 0;
+    return copyValue(token,resultArena);
+}
+
+size_t Cbor::lookupArraySize (char const * path)
+{
+    return lookupArraySize(JsonPath(path));
+}
+
+size_t Cbor::lookupArraySize (JsonPath const & path, size_t index)
+{
+    Head head;
+    if (! find(path,index,head) || head.major != ArrayMajor) return 0;
+    if (! head.isIndefinite()) return size_t(head.argument);
+    size_t length = 0;
+    for (;;)
+    {
+        Head element;
+        if (! readItemHead(element)) return 0;
+        if (element.isBreak()) return length;
+        if (! skip(element,1)) return 0;
+        ++length;
+    }
+}
+
+bool Cbor::visit (IJsonVisitor & visitor)
+{
+    restart();
+    Head head;
+    if (! readItemHead(head)) return false;
+    JsonContext root = { 0, false, 0 };
+    return walk(head,root,visitor);
+}
+
+void Cbor::restart ()
+{
+    nextChunkIndex = 0;
+    chunk = 0;
+    chunkBytes = 0;
+    offset = 0;
+}
+
+/**
+ * Read bytes across chunks.
+ * @param bytes where to store them, or 0 to skip them.
+ */
+bool Cbor::read (uint8_t * bytes, size_t length)
+{
+    while (length > 0)
+    {
+        if (offset == chunkBytes)
+        {
+            if (nextChunkIndex >= byteBuffer.chunks()) return false;
+            chunk = byteBuffer.chunk(nextChunkIndex);
+            chunkBytes = byteBuffer.chunkBytes(nextChunkIndex);
+            ++nextChunkIndex;
+            offset = 0;
+            continue;
+        }
+        size_t available = chunkBytes - offset;
+        size_t count = length < available ? length : available;
+        if (bytes != 0)
+        {
+            memcpy(bytes,chunk+offset,count);
+            bytes += count;
+        }
+        offset += count;
+        length -= count;
+    }
+    return true;
+}
+
+bool Cbor::skipBytes (uint64_t length)
+{
+    if (uint64_t(size_t(length)) != length) return false;
+    return read(0,size_t(length));
+}
+
+bool Cbor::readHead (Head & head)
+{
+    uint8_t initial;
+    if (! read(&initial,1)) return false;
+    head.major = initial >> 5;
+    head.info = initial & 0x1f;
+    head.argument = head.info;
+    if (head.info < 24 || head.isIndefinite())
+        return ! head.isIndefinite() || (head.major >= BytesMajor && head.major != TagMajor);
+    if (head.info > 27) return false;
+    uint8_t bytes[8];
+    size_t length = size_t(1) << (head.info - 24);
+    if (! read(bytes,length)) return false;
+    head.argument = 0;
+    for (size_t i = 0; i < length; ++i) head.argument = (head.argument << 8) | bytes[i];
+    return true;
+}
+
+/**
+ * Read the head of a data item, skipping its tags.
+ */
+bool Cbor::readItemHead (Head & head)
+{
+    do
+    {
+        if (! readHead(head)) return false;
+    }
+    while (head.major == TagMajor);
+    return true;
+}
+
+/**
+ * Skip the rest of a data item after its head.
+ */
+bool Cbor::skip (Head const & head, size_t depth)
+{
+    if (depth > MAX_VISIT_DEPTH) return false;
+    switch (head.major)
+    {
+        case BytesMajor:
+        case TextMajor:
+            if (! head.isIndefinite()) return skipBytes(head.argument);
+            for (;;)
+            {
+                Head part;
+                if (! readHead(part)) return false;
+                if (part.isBreak()) return true;
+                if (part.major != head.major || part.isIndefinite() || ! skipBytes(part.argument)) return false;
+            }
+        case ArrayMajor:
+        case MapMajor:
+        {
+            uint64_t items = (head.major == MapMajor) ? 2 * head.argument : head.argument;
+            for (uint64_t i = 0; head.isIndefinite() || i < items; ++i)
+            {
+                Head item;
+                if (! readItemHead(item)) return false;
+                if (item.isBreak()) return head.isIndefinite();
+                if (! skip(item,depth+1)) return false;
+            }
+            return true;
+        }
+        case SimpleMajor:
+            return ! head.isBreak();
+        default:
+            return true;
+    }
+}
+
+/**
+ * Move to the value at a path.
+ * @param head where to store the head of the value.
+ */
+bool Cbor::find (JsonPath const & path, size_t index, Head & head)
+{
+    if (! path.isValid() || path.hasWildcard()) return false;
+    restart();
+    if (! readItemHead(head)) return false;
+    for (size_t segment = 0; segment < path.segments(); ++segment)
+    {
+        JsonPath::Segment const & step = path.segment(segment);
+        if (head.major == MapMajor)
+        {
+            if (! findKey(head,path.segmentText(segment),step.length,head)) return false;
+            continue;
+        }
+        if (head.major != ArrayMajor || ! (step.isIndex || step.isPlaceholder)) return false;
+        size_t element = step.isPlaceholder ? index : step.index;
+        if (! head.isIndefinite() && element >= head.argument) return false;
+        for (size_t i = 0;; ++i)
+        {
+            if (! readItemHead(head) || head.isBreak()) return false;
+            if (i == element) break;
+            if (! skip(head,1)) return false;
+        }
+    }
+    return true;
+}
+
+/**
+ * Move to the value of a key in a map.
+ * @param map   head of the map.
+ * @param value where to store the head of the value.
+ */
+bool Cbor::findKey (Head const & map, char const * key, size_t keyLength, Head & value)
+{
+    bool indefinite = map.isIndefinite();
+    uint64_t pairs = map.argument;
+    for (uint64_t i = 0; indefinite || i < pairs; ++i)
+    {
+        Head head;
+        if (! readItemHead(head) || head.isBreak()) return false;
+        bool matches;
+        if (! isKey(head,key,keyLength,matches)) return false;
+        if (! readItemHead(value)) return false;
+        if (matches) return true;
+        if (! skip(value,1)) return false;
+    }
+    return false;
+}
+
+/**
+ * Read a map key and compare it with a key of a path.
+ */
+bool Cbor::isKey (Head const & head, char const * key, size_t keyLength, bool & matches)
+{
+    matches = false;
+    if (head.major != TextMajor || head.isIndefinite() || head.argument != keyLength)
+        return skip(head,1);
+    uint8_t bytes[32];
+    matches = true;
+    while (keyLength > 0)
+    {
+        size_t count = keyLength < sizeof(bytes) ? keyLength : sizeof(bytes);
+        if (! read(bytes,count)) return false;
+        matches = matches && memcmp(bytes,key,count) == 0;
+        key += count;
+        keyLength -= count;
+    }
+    return true;
+}
+
+/**
+ * Read a simple value into the text buffer as JSON would have it.
+ * @return false if it is a map, an array or cannot be read.
+ */
+bool Cbor::readScalar (Head const & head, JSONToken & token)
+{
+    text.clear();
+    token.typeandflags = NumberJSONToken;
+    char number[40];
+    switch (head.major)
+    {
+        case UnsignedMajor:
+            formatUnsigned(head.argument,number);
+            appendText(number);
+            break;
+        case NegativeMajor:
+            // -1 - argument, which may not fit in 64 bits.
+            if (head.argument == ~uint64_t(0)) appendText("-18446744073709551616");
+            else
+            {
+                formatUnsigned(head.argument+1,number);
+                appendText("-");
+                appendText(number);
+            }
+            break;
+        case BytesMajor:
+        case TextMajor:
+            token.typeandflags = StringJSONToken;
+            if (! readString(head)) return false;
+            break;
+        case SimpleMajor:
+        {
+            double value = 0;
+            if (head.info == HalfFloat) value = halfToDouble(uint16_t(head.argument));
+            else if (head.info == SingleFloat)
+            {
+                uint32_t bits = uint32_t(head.argument);
+                float single;
+                memcpy(&single,&bits,sizeof(single));
+                value = single;
+            }
+            else if (head.info == DoubleFloat) memcpy(&value,&head.argument,sizeof(value));
+            else if (head.argument == FalseSimple) token.typeandflags = FalseJSONToken;
+            else if (head.argument == TrueSimple) token.typeandflags = TrueJSONToken;
+            else if (head.isBreak()) return false;
+            else token.typeandflags = NullJSONToken;
+            bool isFloat = head.info >= HalfFloat && head.info <= DoubleFloat;
+            // JSON has no infinities or NaN.
+            if (isFloat && (value != value || value - value != 0)) token.typeandflags = NullJSONToken;
+            if (token.typeandflags == FalseJSONToken) appendText("false");
+            else if (token.typeandflags == TrueJSONToken) appendText("true");
+            else if (token.typeandflags == NullJSONToken) appendText("null");
+            else
+            {
+                formatNumber(value,head.info != DoubleFloat,number,sizeof(number));
+                appendText(number);
+            }
+            break;
+        }
+        default:
+            return false;
+    }
+    if (text.size() >= MAX_CBOR_VALUESIZE) token.typeandflags |= TruncatedJSONTokenFlag;
+    text.push_back(0);
+    token.start = &text[0];
+    token.end = &text[0] + text.size() - 1;
+    return true;
+}
+
+/**
+ * Read a string into the text buffer, escaped as in JSON.
+ */
+bool Cbor::readString (Head const & head)
+{
+    if (! head.isIndefinite()) return readStringBytes(head.argument);
+    for (;;)
+    {
+        Head part;
+        if (! readHead(part)) return false;
+        if (part.isBreak()) return true;
+        if (part.major != head.major || part.isIndefinite() || ! readStringBytes(part.argument)) return false;
+    }
+}
+
+bool Cbor::readStringBytes (uint64_t length)
+{
+    for (; length > 0; --length)
+    {
+        uint8_t byte;
+        if (! read(&byte,1)) return false;
+        char escaped[8] = { char(byte), 0 };
+        if (byte == '"' || byte == '\\') sprintf(escaped,"\\%c",byte);
+        else if (byte < 0x20) sprintf(escaped,"\\u%04x",byte);
+        // Only whole escapes are kept when the value is truncated.
+        if (text.size() + strlen(escaped) <= MAX_CBOR_VALUESIZE) appendText(escaped);
+        else if (text.size() < MAX_CBOR_VALUESIZE) text.resize(MAX_CBOR_VALUESIZE,' ');
+    }
+    return true;
+}
+
+void Cbor::appendText (char const * characters)
+{
+    text.insert(text.end(),characters,characters+strlen(characters));
+}
+
+/**
+ * Visit a data item after its head has been read.
+ */
+bool Cbor::walk (Head const & head, JsonContext const & context, IJsonVisitor & visitor)
+{
+    if (head.major != ArrayMajor && head.major != MapMajor)
+    {
+        JSONToken token;
+        if (! readScalar(head,token)) return false;
+        visitor.value(token,context);
+        return true;
+    }
+    if (context.depth + 1 >= MAX_VISIT_DEPTH) return false;
+    bool isMap = (head.major == MapMajor);
+    if (isMap) visitor.startObject(context);
+    else visitor.startArray(context);
+    for (uint64_t i = 0; head.isIndefinite() || i < head.argument; ++i)
+    {
+        Head item;
+        if (! readItemHead(item)) return false;
+        if (item.isBreak())
+        {
+            if (! head.isIndefinite()) return false;
+            break;
+        }
+        JsonContext inner = { context.depth + 1, ! isMap, isMap ? 0 : size_t(i) };
+        if (isMap)
+        {
+            JSONToken key;
+            if (! readScalar(item,key)) return false;
+            key.typeandflags = StringJSONToken;
+            visitor.key(key,inner.depth);
+            if (! readItemHead(item) || item.isBreak()) return false;
+        }
+        if (! walk(item,inner,visitor)) return false;
+    }
+    if (isMap) visitor.endObject(context);
+    else visitor.endArray(context);
+    return true;
+}
+
+} // cbor
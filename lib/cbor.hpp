@@ -0,0 +1,118 @@
+// This software is part of OpenMono, see http://developer.openmono.com
+// Released under the MIT license, see LICENSE.txt
+#if !defined(__com_openmono_cbor_h)
+#define __com_openmono_cbor_h
+#include "arena.hpp"
+#include "ibytebuffer.hpp"
+#include "jsonpath.hpp"
+#include "jsonvisitor.hpp"
+#include "SmallJSONParser.h"
+#include <vector>
+
+#define MAX_CBOR_VALUESIZE 0x400
+
+namespace cbor {
+
+/**
+ * Cbor lets you look up values in a CBOR document (RFC 7049) with the same
+ * paths and results as Json, so that a forecast can be served in a compact
+ * binary form instead of JSON.
+ *
+ * Examples:
+ *
+ *      if (Cbor::isCbor(buffer)) Cbor(buffer).lookup("/city/name");
+ *
+ * Values are converted to the text JSON would have for them: numbers in
+ * decimal, with floating-point numbers in the shortest form that reads back
+ * the same, infinities and NaN as null, byte strings as strings, and tags
+ * are ignored.  Map keys in paths must be text strings.
+ *
+ * Visiting a CBOR document makes the same calls as visiting the same
+ * document in JSON, so anything that decodes Json::visit decodes CBOR too.
+ * Strings longer than MAX_CBOR_VALUESIZE are truncated.
+ */
+class Cbor
+{
+public:
+    /**
+     * @param byteBuffer the CBOR document.
+     */
+    Cbor (IByteBuffer const & byteBuffer);
+    /**
+     * @param byteBuffer the CBOR document.
+     * @param results    arena to store values in, expected to live as long as Cbor.
+     */
+    Cbor (IByteBuffer const & byteBuffer, Arena & results);
+    /**
+     * @return the arena that values are stored in.
+     */
+    Arena & results ();
+    /**
+     * Extract a value from the CBOR document.
+     * @param  path  rooted path to the element.
+     * @return       pointer to the value as string in the results arena, or 0 if not found, not a simple value or out of memory.
+     */
+    uint8_t const * lookup (char const * path);
+    /**
+     * @param  index array index for a placeholder in the path.
+     * @see lookup
+     */
+    uint8_t const * lookup (json::JsonPath const & path, size_t index = 0);
+    /**
+     * Calculate the size of an array.
+     * @param  path rooted path to the element.
+     * @return      size of array, or 0.
+     */
+    size_t lookupArraySize (char const * path);
+    size_t lookupArraySize (json::JsonPath const & path, size_t index = 0);
+    /**
+     * Visit the whole document in one pass, as Json::visit does.
+     * @param  visitor receives every key, value, map and array.
+     * @return         false if the document could not be read or nests deeper than MAX_VISIT_DEPTH.
+     */
+    bool visit (json::IJsonVisitor & visitor);
+    /**
+     * Tell a CBOR document from a JSON one, which starts with white space or
+     * an ASCII character.
+     * @return true if the buffer starts like CBOR.
+     */
+    static bool isCbor (IByteBuffer const & byteBuffer);
+private:
+    /**
+     * The first bytes of a data item.
+     */
+    struct Head
+    {
+        uint8_t major;
+        uint8_t info;
+        uint64_t argument;
+        bool isIndefinite () const { return info == 31; }
+        bool isBreak () const { return major == 7 && info == 31; }
+    };
+    IByteBuffer const & byteBuffer;
+    size_t nextChunkIndex;
+    uint8_t const * chunk;
+    size_t chunkBytes;
+    size_t offset;
+    std::vector<uint8_t> text;
+    Arena ownResults;
+    Arena & resultArena;
+    void restart ();
+    bool read (uint8_t * bytes, size_t length);
+    bool skipBytes (uint64_t length);
+    bool readHead (Head & head);
+    bool readItemHead (Head & head);
+    bool skip (Head const & head, size_t depth);
+    bool find (json::JsonPath const & path, size_t index, Head & head);
+    bool findKey (Head const & map, char const * key, size_t keyLength, Head & value);
+    bool isKey (Head const & head, char const * key, size_t keyLength, bool & matches);
+    bool readScalar (Head const & head, JSONToken & token);
+    bool readString (Head const & head);
+    bool readStringBytes (uint64_t length);
+    void appendText (char const * characters);
+    bool walk (Head const & head, json::JsonContext const & context, json::IJsonVisitor & visitor);
+};
+
+} // cbor
+
+#endif // __com_openmono_cbor_h
@@ -0,0 +1,62 @@
+// This software is part of OpenMono, see http://developer.openmono.com
+// Released under the MIT license, see LICENSE.txt
+#if !defined(__com_openmono_decimal_h)
+#define __com_openmono_decimal_h
+#include "SmallJSONParser.h"
+#include <stddef.h>
+#include <stdint.h>
+
+// Only hosts get floating point parsing, which would add strtod and a table
+// of powers to the device.
+#if defined(__unix__) || defined(__APPLE__)
+#define DECIMAL_DOUBLE
+#endif
+
+/**
+ * Conversion of JSON numbers, as in a number token or a string stored from
+ * one, without going through the C library.
+ *
+ * Examples:
+ *
+ *      int32_t centiKelvin;
+ *      Decimal::toFixed(temperatureK,2,&centiKelvin);    // "288.78" -> 28878
+ *      double speed;
+ *      Decimal::toDouble(token,&speed);                   // host only
+ */
+struct Decimal
+{
+    /**
+     * Convert a number to fixed point with integer arithmetic only, which is
+     * exact and does not need floating point support.
+     * @param  text     number in JSON syntax.
+     * @param  length   number of bytes in text.
+     * @param  decimals number of decimals to keep, the rest is rounded half away from zero.
+     * @param  result   where to store the number times 10^decimals.
+     * @return          false if text is not a number or the result does not fit.
+     */
+    static bool toFixed (uint8_t const * text, size_t length, unsigned decimals, int32_t * result);
+    static bool toFixed (uint8_t const * text, unsigned decimals, int32_t * result);
+    static bool toFixed (JSONToken const & token, unsigned decimals, int32_t * result);
+    /**
+     * Convert a number that is not negative to fixed point, such as a time
+     * in seconds after 2038.
+     * @return false if text is not a number, is negative or does not fit.
+     */
+    static bool toFixed (uint8_t const * text, size_t length, unsigned decimals, uint32_t * result);
+    static bool toFixed (uint8_t const * text, unsigned decimals, uint32_t * result);
+#if defined(DECIMAL_DOUBLE)
+    /**
+     * Convert a number to the nearest double.  Numbers of up to 19 digits
+     * with a moderate exponent are built from a 128 bit product with a
+     * power of five (the Eisel-Lemire method), others use strtod.
+     * @param  text   number in JSON syntax.
+     * @param  length number of bytes in text.
+     * @param  result where to store the number.
+     * @return        false if text is not a number.
+     */
+    static bool toDouble (uint8_t const * text, size_t length, double * result);
+    static bool toDouble (JSONToken const & token, double * result);
+#endif
+};
+
+#endif // __com_openmono_decimal_h
@@ -0,0 +1,45 @@
+// This software is part of OpenMono, see http://developer.openmono.com
+// Released under the MIT license, see LICENSE.txt
+#include "extraction.hpp"
+#include <string.h>
+
+namespace json {
+
+Extraction::Extraction ()
+:
+    arrayPath(0),
+    arrayPathLength(0),
+    maxElements(0),
+    visitor(0)
+{
+}
+
+Extraction::Field Extraction::makeField (char const * path, uint8_t const ** value)
+{
+    Field field;
+    field.path = path;
+    field.length = strlen(path);
+    field.value = value;
+    *value = 0;
+    return field;
+}
+
+void Extraction::add (char const * path, uint8_t const ** value)
+{
+    fields.push_back(makeField(path,value));
+}
+
+void Extraction::forEachElement (char const * arrayPath_, size_t maxElements_, IElementVisitor & visitor_)
+{
+    arrayPath = arrayPath_;
+    arrayPathLength = strlen(arrayPath);
+    maxElements = maxElements_;
+    visitor = &visitor_;
+}
+
+void Extraction::addElementPath (char const * path, uint8_t const ** value)
+{
+    elementFields.push_back(makeField(path,value));
+}
+
+} // json
@@ -0,0 +1,82 @@
+// This software is part of OpenMono, see http://developer.openmono.com
+// Released under the MIT license, see LICENSE.txt
+#if !defined(__com_openmono_extraction_h)
+#define __com_openmono_extraction_h
+#include <stdint.h>
+#include <stddef.h>
+#include <vector>
+
+namespace json {
+
+/**
+ * Receives a notification every time all the element paths of an
+ * Extraction have been looked up in one element of an array.
+ */
+struct IElementVisitor
+{
+    virtual ~IElementVisitor () {};
+
+    /**
+     * Called when the end of an array element has been reached.
+     * @param index index of the array element, starting from 0.
+     */
+    virtual void element (size_t index) = 0;
+};
+
+/**
+ * Extraction is a set of paths that Json::extract can look up in a single pass
+ * over a JSON document.
+ *
+ * Examples:
+ *
+ *      extraction.add("/city/name",&city);
+ *      extraction.forEachElement("/list",5,visitor);
+ *      extraction.addElementPath("/main/temp",&temperature);
+ *
+ * Absolute paths are stored once. Element paths are relative to each element
+ * of the array given to forEachElement, are reset to 0 at the start of each
+ * element, and can be read by the visitor at the end of each element.
+ */
+class Extraction
+{
+public:
+    Extraction ();
+    /**
+     * Register a rooted path to extract.
+     * @param path  rooted path to the JSON element, expected to live as long as the extraction.
+     * @param value where to store the value as string, or 0 if not found or not a simple value.
+     */
+    void add (char const * path, uint8_t const ** value);
+    /**
+     * Visit the elements of an array.
+     * @param arrayPath   rooted path to the JSON array, expected to live as long as the extraction.
+     * @param maxElements stop visiting after this many elements.
+     * @param visitor     notified at the end of every element.
+     */
+    void forEachElement (char const * arrayPath, size_t maxElements, IElementVisitor & visitor);
+    /**
+     * Register a path relative to each array element to extract.
+     * @param path  path relative to the array element, eg. "/main/temp".
+     * @param value where to store the value for the current element.
+     */
+    void addElementPath (char const * path, uint8_t const ** value);
+private:
+    struct Field
+    {
+        char const * path;
+        size_t length;
+        uint8_t const ** value;
+    };
+    std::vector<Field> fields;
+    std::vector<Field> elementFields;
+    char const * arrayPath;
+    size_t arrayPathLength;
+    size_t maxElements;
+    IElementVisitor * visitor;
+    static Field makeField (char const * path, uint8_t const ** value);
+    friend struct Extractor;
+};
+
+} // json
+
+#endif // __com_openmono_extraction_h
@@ -0,0 +1,105 @@
+// This software is part of OpenMono, see http://developer.openmono.com
+// Released under the MIT license, see LICENSE.txt
+#include "filesegmentstore.hpp"
+#include <algorithm>
+#include <ctype.h>
+#include <stdio.h>
+#include <string.h>
+
+#if defined(__unix__) || defined(__APPLE__)
+#include <dirent.h>
+#else
+#include <DirHandle.h>
+#endif
+
+namespace {
+
+/**
+ * Read the number of a segment from a file name, in any case, since a FAT
+ * card without long file names lists them in upper case.
+ * @return false if it is not the name of a segment.
+ */
+bool segmentNumber (char const * name, uint32_t * number)
+{
+    if (strlen(name) != FILESEGMENT_NAME_DIGITS + strlen(FILESEGMENT_SUFFIX)) return false;
+    char const * suffix = FILESEGMENT_SUFFIX;
+    for (size_t i = 0; suffix[i] != 0; ++i)
+        if (tolower((unsigned char)name[FILESEGMENT_NAME_DIGITS + i]) != suffix[i]) return false;
+    uint32_t value = 0;
+    for (size_t i = 0; i < FILESEGMENT_NAME_DIGITS; ++i)
+    {
+        int digit = tolower((unsigned char)name[i]);
+        if (! isxdigit(digit)) return false;
+        value = (value << 4) | uint32_t(isdigit(digit) ? digit - '0' : digit - 'a' + 10);
+    }
+    *number = value;
+    return true;
+}
+
+} // namespace {
+
+FileSegmentStore::FileSegmentStore (char const * directory_)
+{
+    strncpy(directory,directory_,sizeof(directory) - 1);
+    directory[sizeof(directory) - 1] = 0;
+    path[0] = 0;
+}
+
+char const * FileSegmentStore::pathOf (uint32_t segment)
+{
+    snprintf(path,sizeof(path),"%s/%08lx" FILESEGMENT_SUFFIX,directory,(unsigned long)segment);
+    return path;
+}
+
+void FileSegmentStore::segments (std::vector<uint32_t> & numbers)
+{
+    numbers.clear();
+    DIR * dir = opendir(directory);
+    if (0 == dir) return;
+    while (struct dirent * file = readdir(dir))
+    {
+        uint32_t number = 0;
+        if (segmentNumber(file->d_name,&number)) numbers.push_back(number);
+    }
+    closedir(dir);
+    std::sort(numbers.begin(),numbers.end());
+}
+
+size_t FileSegmentStore::bytes (uint32_t segment)
+{
+    FILE * file = fopen(pathOf(segment),"rb");
+    if (0 == file) return 0;
+    fseek(file,0,SEEK_END);
+    long length = ftell(file);
+    fclose(file);
+    return length < 0 ? 0 : size_t(length);
+}
+
+bool FileSegmentStore::read (uint32_t segment, size_t offset, uint8_t * destination, size_t length)
+{
+    FILE * file = fopen(pathOf(segment),"rb");
+    if (0 == file) return false;
+    bool ok = fseek(file,long(offset),SEEK_SET) == 0 && fread(destination,1,length,file) == length;
+    fclose(file);
+    return ok;
+}
+
+bool FileSegmentStore::append (uint32_t segment, uint8_t const * source, size_t length)
+{
+    FILE * file = fopen(pathOf(segment),"ab");
+    if (0 == file) return false;
+    bool ok = fwrite(source,1,length,file) == length;
+    return (fclose(file) == 0) && ok;
+}
+
+bool FileSegmentStore::remove (uint32_t segment)
+{
+    return ::remove(pathOf(segment)) == 0;
+}
+
+bool FileSegmentStore::rename (uint32_t from, uint32_t to)
+{
+    char fromPath[sizeof(path)];
+    strcpy(fromPath,pathOf(from));
+    return ::rename(fromPath,pathOf(to)) == 0;
+}
@@ -0,0 +1,46 @@
+// This software is part of OpenMono, see http://developer.openmono.com
+// Released under the MIT license, see LICENSE.txt
+#if !defined(__com_openmono_filesegmentstore_h)
+#define __com_openmono_filesegmentstore_h
+#include "isegmentstore.hpp"
+
+#define FILESEGMENT_MAX_PATH 128
+#define FILESEGMENT_NAME_DIGITS 8
+#define FILESEGMENT_SUFFIX ".seg"
+
+/**
+ * FileSegmentStore keeps each segment in a file of a directory, named after
+ * its number in 8.3 form such as 0000002a.seg, on an SD card as well as on
+ * a host.
+ *
+ * Examples:
+ *
+ *      FileSegmentStore store("/sd/mono/weather/history");
+ *      weather::History history(store);
+ */
+class FileSegmentStore
+:
+    public ISegmentStore
+{
+public:
+    /**
+     * @param directory existing directory for the segments, without a
+     *                  trailing slash.
+     */
+    FileSegmentStore (char const * directory);
+    virtual void segments (std::vector<uint32_t> & numbers);
+    virtual size_t bytes (uint32_t segment);
+    virtual bool read (uint32_t segment, size_t offset, uint8_t * destination, size_t length);
+    virtual bool append (uint32_t segment, uint8_t const * source, size_t length);
+    virtual bool remove (uint32_t segment);
+    virtual bool rename (uint32_t from, uint32_t to);
+private:
+    char directory[FILESEGMENT_MAX_PATH];
+    /**
+     * The directory, a slash and the name of a segment.
+     */
+    char path[FILESEGMENT_MAX_PATH + FILESEGMENT_NAME_DIGITS + sizeof(FILESEGMENT_SUFFIX)];
+    char const * pathOf (uint32_t segment);
+};
+
+#endif // __com_openmono_filesegmentstore_h
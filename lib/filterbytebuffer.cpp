@@ -0,0 +1,299 @@
+// This software is part of OpenMono, see http://developer.openmono.com
+// Released under the MIT license, see LICENSE.txt
+#include "filterbytebuffer.hpp"
+#include <string.h>
+
+using json::JsonContext;
+using json::JsonPath;
+
+FilterByteBuffer::FilterByteBuffer (IByteBuffer & sink_)
+:
+    sink(sink_),
+    parser(*this),
+    depth(0),
+    keyLength(0),
+    keyTruncated(false),
+    broken(false),
+    outputLength(0)
+{
+}
+
+bool FilterByteBuffer::keep (char const * path)
+{
+    if (paths.size() >= MAX_KEEP_PATHS) return false;
+    JsonPath compiled(path);
+    if (! compiled.isValid()) return false;
+    paths.push_back(compiled);
+    return true;
+}
+
+bool FilterByteBuffer::isDone () const
+{
+    return parser.isDone();
+}
+
+bool FilterByteBuffer::isBroken () const
+{
+    return broken;
+}
+
+bool FilterByteBuffer::finish ()
+{
+    if (broken) return false;
+    if (! parser.finish())
+    {
+        fail();
+        return false;
+    }
+    flush();
+    return true;
+}
+
+void FilterByteBuffer::add (uint8_t const * chunk, size_t length)
+{
+    if (broken) return;
+    if (! parser.feed(chunk,length)) fail();
+}
+
+size_t FilterByteBuffer::bytes () const
+{
+    return sink.bytes();
+}
+
+size_t FilterByteBuffer::chunks () const
+{
+    return sink.chunks();
+}
+
+size_t FilterByteBuffer::chunkBytes (size_t index) const
+{
+    return sink.chunkBytes(index);
+}
+
+uint8_t FilterByteBuffer::operator[] (size_t position) const
+{
+    return sink[position];
+}
+
+uint8_t const * FilterByteBuffer::chunk (size_t index) const
+{
+    return sink.chunk(index);
+}
+
+bool FilterByteBuffer::hasStableChunks () const
+{
+    return sink.hasStableChunks();
+}
+
+void FilterByteBuffer::clear ()
+{
+    parser.restart();
+    depth = 0;
+    keyLength = 0;
+    keyTruncated = false;
+    broken = false;
+    outputLength = 0;
+    sink.clear();
+}
+
+uint32_t FilterByteBuffer::generation () const
+{
+    return sink.generation();
+}
+
+void FilterByteBuffer::startObject (JsonContext const & context)
+{
+    open(false,context);
+}
+
+void FilterByteBuffer::endObject (JsonContext const &)
+{
+    close(false);
+}
+
+void FilterByteBuffer::startArray (JsonContext const & context)
+{
+    open(true,context);
+}
+
+void FilterByteBuffer::endArray (JsonContext const &)
+{
+    close(true);
+}
+
+void FilterByteBuffer::key (JSONToken const & key, size_t keyDepth)
+{
+    keyMatch = narrow(levels[keyDepth-1].match,keyDepth,&key,0);
+    keyLength = key.end - key.start;
+    keyTruncated = IsJSONTokenTruncated(key) || keyLength > sizeof(keyBuffer);
+    if (keyLength > sizeof(keyBuffer)) keyLength = sizeof(keyBuffer);
+    memcpy(keyBuffer,key.start,keyLength);
+}
+
+void FilterByteBuffer::value (JSONToken const & value, JsonContext const & context)
+{
+    if (broken || ! locate(context).whole) return;
+    // Part of a string could end in the middle of an escape.
+    if (IsJSONTokenTruncated(value) || (context.depth > 0 && ! context.inArray && keyTruncated)) return fail();
+    if (context.depth > 0)
+    {
+        writeLevels();
+        writeMember(context.depth-1,keyBuffer,keyLength,context.index);
+    }
+    bool quoted = (JSONTokenType(value) == StringJSONToken);
+    if (quoted) write('"');
+    write(value.start,value.end-value.start);
+    if (quoted) write('"');
+    if (context.depth == 0) flush();
+}
+
+FilterByteBuffer::Match FilterByteBuffer::locate (JsonContext const & context) const
+{
+    if (context.depth == 0)
+    {
+        Match root;
+        root.paths = (paths.size() == 32) ? 0xffffffff : (1u << paths.size()) - 1;
+        root.whole = false;
+        for (size_t i = 0; i < paths.size(); ++i)
+            root.whole = root.whole || paths[i].segments() == 0;
+        return root;
+    }
+    if (context.inArray) return narrow(levels[context.depth-1].match,context.depth,0,context.index);
+    return keyMatch;
+}
+
+/**
+ * Find the paths that still match one segment further down.
+ * @param match      paths matching the parent.
+ * @param valueDepth depth of the value, which is the number of segments to match.
+ * @param key        key of the value in an object, or 0 for an array element.
+ * @param index      index of the value in an array.
+ */
+FilterByteBuffer::Match FilterByteBuffer::narrow (Match const & match, size_t valueDepth, JSONToken const * key, size_t index) const
+{
+    Match result;
+    result.paths = 0;
+    result.whole = match.whole;
+    if (match.whole) return result;
+    for (size_t i = 0; i < paths.size(); ++i)
+    {
+        if ((match.paths & (1u << i)) == 0) continue;
+        JsonPath::Segment const & segment = paths[i].segment(valueDepth-1);
+        bool matches;
+        if (key != 0)
+            matches = ! segment.isWildcard && FastIsJSONStringEqualWithLength(*key,paths[i].segmentText(valueDepth-1),segment.length);
+        else
+            matches = segment.isWildcard || (segment.isIndex && segment.index == index);
+        if (! matches) continue;
+        if (paths[i].segments() == valueDepth) result.whole = true;
+        else result.paths |= (1u << i);
+    }
+    return result;
+}
+
+void FilterByteBuffer::open (bool array, JsonContext const & context)
+{
+    Level & level = levels[depth++];
+    level.match = locate(context);
+    level.array = array;
+    level.written = false;
+    level.members = 0;
+    level.keyPath = 0;
+    level.index = context.inArray ? context.index : 0;
+    while (level.keyPath < paths.size() && (level.match.paths & (1u << level.keyPath)) == 0) ++level.keyPath;
+    if (broken || ! level.match.whole) return;
+    if (context.depth > 0 && ! context.inArray && keyTruncated) return fail();
+    // Everything in it is kept, so write it now with its actual key.
+    --depth;
+    writeLevels();
+    if (depth > 0) writeMember(depth-1,keyBuffer,keyLength,level.index);
+    write(array ? '[' : '{');
+    level.written = true;
+    ++depth;
+}
+
+void FilterByteBuffer::close (bool array)
+{
+    if (depth == 0) return;
+    Level & level = levels[--depth];
+    if (broken) return;
+    if (level.written) write(array ? ']' : '}');
+    if (depth == 0) flush();
+}
+
+/**
+ * Write the objects and arrays around a kept value that have not been
+ * written yet.  Their keys are on the paths they matched.
+ */
+void FilterByteBuffer::writeLevels ()
+{
+    for (size_t i = 0; i < depth; ++i)
+    {
+        Level & level = levels[i];
+        if (level.written) continue;
+        if (i > 0)
+        {
+            JsonPath const & path = paths[level.keyPath];
+            writeMember(i-1,(uint8_t const *)path.segmentText(i-1),path.segment(i-1).length,level.index);
+        }
+        write(level.array ? '[' : '{');
+        level.written = true;
+    }
+}
+
+/**
+ * Write what comes before a member of an object or an array.  Elements of
+ * an array that were dropped before it become null, to keep its index.
+ */
+void FilterByteBuffer::writeMember (size_t level, uint8_t const * key, size_t length, size_t index)
+{
+    Level & parent = levels[level];
+    while (parent.array && parent.members < index)
+    {
+        if (parent.members++ > 0) write(',');
+        write((uint8_t const *)"null",4);
+    }
+    if (parent.members++ > 0) write(',');
+    if (parent.array) return;
+    write('"');
+    write(key,length);
+    write('"');
+    write(':');
+}
+
+void FilterByteBuffer::write (uint8_t const * bytes, size_t length)
+{
+    while (length > 0)
+    {
+        size_t room = sizeof(output) - outputLength;
+        size_t bytesToCopy = length < room ? length : room;
+        memcpy(output+outputLength,bytes,bytesToCopy);
+        outputLength += bytesToCopy;
+        bytes += bytesToCopy;
+        length -= bytesToCopy;
+        if (outputLength == sizeof(output)) flush();
+    }
+}
+
+void FilterByteBuffer::write (char byte)
+{
+    write((uint8_t const *)&byte,1);
+}
+
+/**
+ * Drop the document, so that what was written of it is not taken for all
+ * of it.
+ */
+void FilterByteBuffer::fail ()
+{
+    broken = true;
+    outputLength = 0;
+    sink.clear();
+}
+
+void FilterByteBuffer::flush ()
+{
+    if (outputLength == 0) return;
+    sink.add(output,outputLength);
+    outputLength = 0;
+}
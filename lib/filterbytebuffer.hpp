@@ -0,0 +1,133 @@
+// This software is part of OpenMono, see http://developer.openmono.com
+// Released under the MIT license, see LICENSE.txt
+#if !defined(__com_openmono_filterbytebuffer_h)
+#define __com_openmono_filterbytebuffer_h
+#include "ibytebuffer.hpp"
+#include "jsonpath.hpp"
+#include "jsonvisitor.hpp"
+#include "pushparser.hpp"
+#include <vector>
+
+#define MAX_KEEP_PATHS 32
+#define FILTER_CHUNKSIZE 0x100
+
+/**
+ * FilterByteBuffer passes a JSON document that arrives in chunks on to
+ * another byte buffer, keeping only the values on a list of paths and
+ * writing them as minified JSON.  Everything else is dropped before it
+ * reaches the other buffer, which makes the stored document smaller and
+ * faster to parse later.
+ *
+ * Paths are rooted and may have wildcard segments, consisting of only *,
+ * for array indices.  A path to an object or array keeps all of it.
+ * Objects and arrays are only written if something in them is kept.  Array
+ * elements before a kept one are written as null, so an index means the
+ * same in the filtered document as in the original one.
+ *
+ * A broken document, or a kept string longer than MAX_PUSH_TOKENSIZE, empties
+ * the other buffer, so that part of a document is never mistaken for all of
+ * it.  So does a document that has not ended when finish is called.
+ *
+ * Examples:
+ *
+ *      FilterByteBuffer filter(sdCardBuffer);
+ *      filter.keep("/city/name");
+ *      filter.add(chunk,length);
+ *      bool ok = filter.finish();
+ *
+ * Reading the buffer reads the other buffer.  The filtered document reaches
+ * it in chunks of FILTER_CHUNKSIZE bytes, the last one when the document ends.
+ */
+class FilterByteBuffer
+:
+    public IByteBuffer,
+    public json::IJsonVisitor
+{
+public:
+    /**
+     * @param sink buffer to write the filtered document to.
+     */
+    FilterByteBuffer (IByteBuffer & sink);
+    /**
+     * Keep the values on a path.
+     * @param  path rooted path, expected to live as long as FilterByteBuffer.
+     * @return      false if the path is not valid or there are too many paths.
+     */
+    bool keep (char const * path);
+    /**
+     * @return true if the whole document has been filtered.
+     */
+    bool isDone () const;
+    /**
+     * @return true if the document was broken or could not be kept whole.
+     */
+    bool isBroken () const;
+    /**
+     * Signal that the whole document has arrived, such as at the end of a
+     * download that may have been cut off.
+     * @return true if the whole document was filtered, otherwise the other
+     *         buffer is emptied.
+     */
+    bool finish ();
+    virtual void add (uint8_t const * chunk, size_t length);
+    virtual size_t bytes () const;
+    virtual size_t chunks () const;
+    virtual size_t chunkBytes (size_t index) const;
+    virtual uint8_t operator[] (size_t position) const;
+    virtual uint8_t const * chunk (size_t index) const;
+    virtual bool hasStableChunks () const;
+    virtual void clear ();
+    virtual uint32_t generation () const;
+    virtual void startObject (json::JsonContext const & context);
+    virtual void endObject (json::JsonContext const & context);
+    virtual void startArray (json::JsonContext const & context);
+    virtual void endArray (json::JsonContext const & context);
+    virtual void key (JSONToken const & key, size_t depth);
+    virtual void value (JSONToken const & value, json::JsonContext const & context);
+private:
+    /**
+     * Which paths a value is on.
+     */
+    struct Match
+    {
+        // Bit for every path whose segments so far match.
+        uint32_t paths;
+        // True if a whole path has matched, so everything is kept.
+        bool whole;
+    };
+    struct Level
+    {
+        Match match;
+        bool array;
+        bool written;
+        size_t members;
+        // Path to take the key of the object or array from, if written later.
+        size_t keyPath;
+        // Index in the parent, if the parent is an array.
+        size_t index;
+    };
+    IByteBuffer & sink;
+    json::PushParser parser;
+    std::vector<json::JsonPath> paths;
+    Level levels[MAX_VISIT_DEPTH];
+    size_t depth;
+    Match keyMatch;
+    uint8_t keyBuffer[MAX_PUSH_TOKENSIZE];
+    size_t keyLength;
+    bool keyTruncated;
+    bool broken;
+    uint8_t output[FILTER_CHUNKSIZE];
+    size_t outputLength;
+    Match locate (json::JsonContext const & context) const;
+    Match narrow (Match const & match, size_t depth, JSONToken const * key, size_t index) const;
+    void open (bool array, json::JsonContext const & context);
+    void close (bool array);
+    void writeLevels ();
+    void writeMember (size_t level, uint8_t const * key, size_t keyLength, size_t index);
+    void fail ();
+    void write (uint8_t const * bytes, size_t length);
+    void write (char byte);
+    void flush ();
+};
+
+#endif // __com_openmono_filterbytebuffer_h
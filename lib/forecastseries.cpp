@@ -0,0 +1,222 @@
+// This software is part of OpenMono, see http://developer.openmono.com
+// Released under the MIT license, see LICENSE.txt
+#include "forecastseries.hpp"
+
+#define SERIES_BLOCK 16
+
+namespace {
+
+template <class T>
+T const * data (std::vector<T> const & values)
+{
+    return values.empty() ? 0 : &values[0];
+}
+
+} // namespace {
+
+namespace weather {
+
+ForecastSeries::ForecastSeries ()
+:
+    cityId(0)
+{
+}
+
+void ForecastSeries::reserve (size_t entries)
+{
+    times.reserve(entries);
+    temperatures.reserve(entries);
+    pressures.reserve(entries);
+    windSpeeds.reserve(entries);
+    windDirections.reserve(entries);
+    rains.reserve(entries);
+    clouds.reserve(entries);
+    humidity.reserve(entries);
+    condition.reserve(entries);
+    hasRain.reserve(entries);
+}
+
+void ForecastSeries::add (Entry const & entry)
+{
+    cityId = entry.city;
+    times.push_back(entry.timeUnix);
+    temperatures.push_back(entry.temperatureCentiK);
+    pressures.push_back(entry.pressureDeciHpa);
+    windSpeeds.push_back(entry.windSpeedCentiMs);
+    windDirections.push_back(entry.windDirectionDeciDegrees);
+    rains.push_back(entry.rainCentiMm);
+    clouds.push_back(entry.cloudPercentage);
+    humidity.push_back(entry.humidity);
+    condition.push_back(entry.condition);
+    hasRain.push_back(entry.hasRain);
+}
+
+void ForecastSeries::clear ()
+{
+    cityId = 0;
+    times.clear();
+    temperatures.clear();
+    pressures.clear();
+    windSpeeds.clear();
+    windDirections.clear();
+    rains.clear();
+    clouds.clear();
+    humidity.clear();
+    condition.clear();
+    hasRain.clear();
+}
+
+size_t ForecastSeries::size () const
+{
+    return times.size();
+}
+
+Entry ForecastSeries::entry (size_t index) const
+{
+    Entry entry;
+    entry.timeUnix = times[index];
+    entry.city = cityId;
+    entry.temperatureCentiK = temperatures[index];
+    entry.pressureDeciHpa = pressures[index];
+    entry.windSpeedCentiMs = windSpeeds[index];
+    entry.windDirectionDeciDegrees = windDirections[index];
+    entry.rainCentiMm = rains[index];
+    entry.cloudPercentage = clouds[index];
+    entry.humidity = humidity[index];
+    entry.condition = condition[index];
+    entry.hasRain = hasRain[index] != 0;
+    return entry;
+}
+
+uint32_t ForecastSeries::city () const
+{
+    return cityId;
+}
+
+void ForecastSeries::setCity (uint32_t city)
+{
+    cityId = city;
+}
+
+uint32_t const * ForecastSeries::timesUnix () const
+{
+    return data(times);
+}
+
+uint16_t const * ForecastSeries::temperaturesCentiK () const
+{
+    return data(temperatures);
+}
+
+uint16_t const * ForecastSeries::pressuresDeciHpa () const
+{
+    return data(pressures);
+}
+
+uint16_t const * ForecastSeries::windSpeedsCentiMs () const
+{
+    return data(windSpeeds);
+}
+
+uint16_t const * ForecastSeries::windDirectionsDeciDegrees () const
+{
+    return data(windDirections);
+}
+
+uint16_t const * ForecastSeries::rainsCentiMm () const
+{
+    return data(rains);
+}
+
+uint8_t const * ForecastSeries::cloudPercentages () const
+{
+    return data(clouds);
+}
+
+uint8_t const * ForecastSeries::humidities () const
+{
+    return data(humidity);
+}
+
+uint8_t const * ForecastSeries::conditions () const
+{
+    return data(condition);
+}
+
+uint8_t const * ForecastSeries::rainFlags () const
+{
+    return data(hasRain);
+}
+
+bool ForecastSeries::temperatureRange (uint16_t * lowest, uint16_t * highest) const
+{
+    size_t count = temperatures.size();
+    uint16_t const * values = data(temperatures);
+    // A missing temperature is 0.  The lowest is found among the temperatures
+    // minus one, where 0 wraps around to the largest value and never wins.
+    uint16_t lowBelow[SERIES_BLOCK];
+    uint16_t high[SERIES_BLOCK];
+    for (size_t j = 0; j < SERIES_BLOCK; ++j)
+    {
+        lowBelow[j] = 0xffff;
+        high[j] = 0;
+    }
+    // Blocks of a fixed size let the compiler use vector instructions.
+    size_t i = 0;
+    for (; i + SERIES_BLOCK <= count; i += SERIES_BLOCK)
+    {
+        for (size_t j = 0; j < SERIES_BLOCK; ++j)
+        {
+            uint16_t below = uint16_t(values[i+j] - 1);
+            lowBelow[j] = below < lowBelow[j] ? below : lowBelow[j];
+            high[j] = values[i+j] > high[j] ? values[i+j] : high[j];
+        }
+    }
+    for (; i < count; ++i)
+    {
+        uint16_t below = uint16_t(values[i] - 1);
+        lowBelow[0] = below < lowBelow[0] ? below : lowBelow[0];
+        high[0] = values[i] > high[0] ? values[i] : high[0];
+    }
+    uint16_t lowestBelow = lowBelow[0];
+    uint16_t highestValue = high[0];
+    for (size_t j = 1; j < SERIES_BLOCK; ++j)
+    {
+        lowestBelow = lowBelow[j] < lowestBelow ? lowBelow[j] : lowestBelow;
+        highestValue = high[j] > highestValue ? high[j] : highestValue;
+    }
+    if (highestValue == 0) return false;
+    *lowest = uint16_t(lowestBelow + 1);
+    *highest = highestValue;
+    return true;
+}
+
+uint32_t ForecastSeries::totalRainCentiMm () const
+{
+    size_t count = rains.size();
+    uint16_t const * values = data(rains);
+    uint32_t totals[SERIES_BLOCK] = { 0 };
+    size_t i = 0;
+    for (; i + SERIES_BLOCK <= count; i += SERIES_BLOCK)
+        for (size_t j = 0; j < SERIES_BLOCK; ++j) totals[j] += values[i+j];
+    uint32_t total = 0;
+    for (; i < count; ++i) total += values[i];
+    for (size_t j = 0; j < SERIES_BLOCK; ++j) total += totals[j];
+    return total;
+}
+
+uint16_t ForecastSeries::highestWindSpeedCentiMs () const
+{
+    size_t count = windSpeeds.size();
+    uint16_t const * values = data(windSpeeds);
+    uint16_t highest[SERIES_BLOCK] = { 0 };
+    size_t i = 0;
+    for (; i + SERIES_BLOCK <= count; i += SERIES_BLOCK)
+        for (size_t j = 0; j < SERIES_BLOCK; ++j) highest[j] = values[i+j] > highest[j] ? values[i+j] : highest[j];
+    uint16_t result = 0;
+    for (; i < count; ++i) result = values[i] > result ? values[i] : result;
+    for (size_t j = 0; j < SERIES_BLOCK; ++j) result = highest[j] > result ? highest[j] : result;
+    return result;
+}
+
+} // weather
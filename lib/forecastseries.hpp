@@ -0,0 +1,97 @@
+// This software is part of OpenMono, see http://developer.openmono.com
+// Released under the MIT license, see LICENSE.txt
+#if !defined(__com_openmono_forecastseries_h)
+#define __com_openmono_forecastseries_h
+#include "weather.hpp"
+#include <stddef.h>
+#include <stdint.h>
+#include <vector>
+
+namespace weather {
+
+/**
+ * ForecastSeries holds many entries of one city with one array per field,
+ * so that computing something over the whole series, such as the highest
+ * temperature or the total rain, reads one contiguous array instead of
+ * every field of every entry.
+ *
+ * Examples:
+ *
+ *      ForecastSeries series;
+ *      series.add(entry);
+ *      uint16_t lowest, highest;
+ *      series.temperatureRange(&lowest,&highest);
+ *      uint16_t const * temperatures = series.temperaturesCentiK();
+ */
+class ForecastSeries
+{
+public:
+    ForecastSeries ();
+    /**
+     * Make room for a number of entries.
+     */
+    void reserve (size_t entries);
+    /**
+     * Append an entry, whose city becomes the city of the series.
+     */
+    void add (Entry const & entry);
+    void clear ();
+    size_t size () const;
+    /**
+     * @param  index position in the series, less than size().
+     * @return       the entry at the position.
+     */
+    Entry entry (size_t index) const;
+    /**
+     * @return cityId of the city of the series, or 0 if empty.
+     */
+    uint32_t city () const;
+    void setCity (uint32_t city);
+    /**
+     * Arrays of size() values, or 0 if the series is empty, valid until the
+     * series changes.
+     */
+    uint32_t const * timesUnix () const;
+    uint16_t const * temperaturesCentiK () const;
+    uint16_t const * pressuresDeciHpa () const;
+    uint16_t const * windSpeedsCentiMs () const;
+    uint16_t const * windDirectionsDeciDegrees () const;
+    uint16_t const * rainsCentiMm () const;
+    uint8_t const * cloudPercentages () const;
+    uint8_t const * humidities () const;
+    uint8_t const * conditions () const;
+    /**
+     * @return 1 for each entry that has rain, even if it is 0 mm.
+     */
+    uint8_t const * rainFlags () const;
+    /**
+     * @param  lowest  where to store the lowest temperature.
+     * @param  highest where to store the highest temperature.
+     * @return         false if no entry has a temperature, which is missing when it is 0.
+     */
+    bool temperatureRange (uint16_t * lowest, uint16_t * highest) const;
+    /**
+     * @return the sum of the rain of all entries in hundredths of a mm.
+     */
+    uint32_t totalRainCentiMm () const;
+    /**
+     * @return the highest wind speed, or 0 if the series is empty.
+     */
+    uint16_t highestWindSpeedCentiMs () const;
+private:
+    uint32_t cityId;
+    std::vector<uint32_t> times;
+    std::vector<uint16_t> temperatures;
+    std::vector<uint16_t> pressures;
+    std::vector<uint16_t> windSpeeds;
+    std::vector<uint16_t> windDirections;
+    std::vector<uint16_t> rains;
+    std::vector<uint8_t> clouds;
+    std::vector<uint8_t> humidity;
+    std::vector<uint8_t> condition;
+    std::vector<uint8_t> hasRain;
+};
+
+} // weather
+
+#endif // __com_openmono_forecastseries_h
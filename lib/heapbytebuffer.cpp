@@ -5,6 +5,7 @@
 
 HeapByteBuffer::HeapByteBuffer ()
 :
+    generationCount(0),
     storeSize(0),
     storeCapacity(0),
     byteStore(0),
@@ -25,12 +26,13 @@ void HeapByteBuffer::add (uint8_t const * bytes, size_t length)
     byteStore[storeSize] = memory;
     lengthStore[storeSize] = length;
     ++storeSize;
+    ++generationCount;
 }
 
 uint8_t HeapByteBuffer::operator[] (size_t position) const
 {
     size_t remaining = position;
-    for (uint8_t i = 0; i < storeSize; ++i)
+    for (size_t i = 0; i < storeSize; ++i)
         if (remaining < lengthStore[i])
             return byteStore[i][remaining];
         else
@@ -47,6 +49,7 @@ void HeapByteBuffer::clear ()
     lengthStore = 0;
     storeSize = 0;
     storeCapacity = 0;
+    ++generationCount;
 }
 
 void HeapByteBuffer::enlargeStoreIfTooSmall ()
@@ -82,21 +85,16 @@ void HeapByteBuffer::doubleStoreCapacity ()
 size_t HeapByteBuffer::bytes () const
 {
     size_t total = 0;
-    for (uint8_t i = 0; i < storeSize; ++i) total += lengthStore[i];
+    for (size_t i = 0; i < storeSize; ++i) total += lengthStore[i];
     return total;
 }
 
-size_t HeapByteBuffer::chunks () const
-{
-    return storeSize;
-}
-
-uint8_t const * const HeapByteBuffer::chunk(size_t index) const
+bool HeapByteBuffer::hasStableChunks () const
 {
-    return byteStore[index];
+    return true;
 }
 
-size_t HeapByteBuffer::chunkBytes(size_t index) const
+uint32_t HeapByteBuffer::generation () const
 {
-    return lengthStore[index];
+    return generationCount;
 }
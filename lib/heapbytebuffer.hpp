@@ -20,9 +20,12 @@ public:
     virtual size_t chunks () const;
     virtual size_t chunkBytes (size_t index) const;
     virtual uint8_t operator[] (size_t position) const;
-    virtual uint8_t const * const chunk (size_t index) const;
+    virtual uint8_t const * chunk (size_t index) const;
+    virtual bool hasStableChunks () const;
     virtual void clear ();
+    virtual uint32_t generation () const;
 private:
+    uint32_t generationCount;
     size_t storeSize;
     size_t storeCapacity;
     uint8_t const ** byteStore;
@@ -32,4 +35,21 @@ private:
     void doubleStoreCapacity ();
 };
 
+// Chunk access is defined here so that BufferJson can inline it.
+
+inline size_t HeapByteBuffer::chunks () const
+{
+    return storeSize;
+}
+
+inline uint8_t const * HeapByteBuffer::chunk (size_t index) const
+{
+    return byteStore[index];
+}
+
+inline size_t HeapByteBuffer::chunkBytes (size_t index) const
+{
+    return lengthStore[index];
+}
+
 #endif // __com_openmono_heapbytebuffer_h
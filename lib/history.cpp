@@ -0,0 +1,315 @@
+// This software is part of OpenMono, see http://developer.openmono.com
+// Released under the MIT license, see LICENSE.txt
+#include "history.hpp"
+#include <algorithm>
+#include <set>
+#include <string.h>
+
+// Records with the same time and city supersede each other.
+#define HISTORY_KEY_BYTES 8
+
+namespace {
+
+uint32_t recordTime (uint8_t const * record)
+{
+    return uint32_t(record[0]) | (uint32_t(record[1]) << 8) |
+        (uint32_t(record[2]) << 16) | (uint32_t(record[3]) << 24);
+}
+
+/**
+ * @return the time and city of a record, with the time in the low half.
+ */
+uint64_t recordKey (uint8_t const * record)
+{
+    uint64_t key = 0;
+    for (size_t i = 0; i < HISTORY_KEY_BYTES; ++i) key |= uint64_t(record[i]) << (8 * i);
+    return key;
+}
+
+/**
+ * Survivors copies the records that a compaction keeps to the scratch
+ * segment, one block at a time.
+ */
+struct Survivors
+{
+    Survivors (ISegmentStore & store_, uint32_t scratch_)
+    :
+        store(store_),
+        scratch(scratch_),
+        buffered(0)
+    {
+    }
+    bool add (uint8_t const * record)
+    {
+        memcpy(records + buffered * HISTORY_RECORD_BYTES,record,HISTORY_RECORD_BYTES);
+        return ++buffered < HISTORY_BLOCK_RECORDS || flush();
+    }
+    bool flush ()
+    {
+        size_t count = buffered;
+        buffered = 0;
+        return count == 0 || store.append(scratch,records,count * HISTORY_RECORD_BYTES);
+    }
+    ISegmentStore & store;
+    uint32_t scratch;
+    size_t buffered;
+    uint8_t records[HISTORY_BLOCK_RECORDS * HISTORY_RECORD_BYTES];
+};
+
+} // namespace {
+
+namespace weather {
+
+History::History (ISegmentStore & store_)
+:
+    store(store_),
+    records(0),
+    last(0),
+    run(0),
+    nextSegment(0),
+    sealed(false)
+{
+}
+
+void History::recover ()
+{
+    std::vector<uint32_t> numbers;
+    store.segments(numbers);
+    for (size_t i = 0; i < numbers.size(); ++i)
+    {
+        if ((numbers[i] & HISTORY_SCRATCH_SEGMENT) == 0) continue;
+        // The copy is complete once its segment has been removed.
+        uint32_t target = numbers[i] & ~uint32_t(HISTORY_SCRATCH_SEGMENT);
+        if (std::binary_search(numbers.begin(),numbers.end(),target))
+            store.remove(numbers[i]);
+        else
+            store.rename(numbers[i],target);
+    }
+}
+
+void History::addBlock (size_t segment, size_t first)
+{
+    Block block = { 0xffffffff, index.empty() ? 0 : index.back().high, segment, first };
+    index.push_back(block);
+}
+
+void History::track (uint32_t time)
+{
+    if (index.back().high < time) index.back().high = time;
+    // The blocks before may hold entries newer than this one.
+    for (size_t block = index.size(); block > 0 && index[block-1].low > time; --block)
+        index[block-1].low = time;
+    if (records == 0 || time < last) run = time;
+    last = time;
+    ++records;
+}
+
+bool History::open ()
+{
+    segmentList.clear();
+    index.clear();
+    records = 0;
+    last = 0;
+    run = 0;
+    nextSegment = 0;
+    sealed = false;
+    recover();
+    std::vector<uint32_t> numbers;
+    store.segments(numbers);
+    uint8_t bytes[HISTORY_BLOCK_RECORDS * HISTORY_RECORD_BYTES];
+    for (size_t i = 0; i < numbers.size(); ++i)
+    {
+        if ((numbers[i] & HISTORY_SCRATCH_SEGMENT) != 0) continue;
+        nextSegment = numbers[i] + 1;
+        size_t length = store.bytes(numbers[i]);
+        sealed = (length % HISTORY_RECORD_BYTES) != 0;
+        Segment segment = { numbers[i], length / HISTORY_RECORD_BYTES, index.size() };
+        if (segment.records == 0) continue;
+        segmentList.push_back(segment);
+        for (size_t first = 0; first < segment.records; first += HISTORY_BLOCK_RECORDS)
+        {
+            addBlock(segmentList.size() - 1,first);
+            if (! readBlock(index.size() - 1,bytes)) return false;
+            size_t count = blockRecords(index.size() - 1);
+            for (size_t record = 0; record < count; ++record)
+                track(recordTime(bytes + record * HISTORY_RECORD_BYTES));
+        }
+    }
+    return true;
+}
+
+bool History::append (Entry const & entry)
+{
+    if (records > 0 && entry.timeUnix < run) return false;
+    bool rollover = segmentList.empty() || sealed || segmentList.back().records >= HISTORY_SEGMENT_RECORDS;
+    uint32_t number = rollover ? nextSegment++ : segmentList.back().number;
+    uint8_t record[HISTORY_RECORD_BYTES];
+    writeEntryRecord(entry,record);
+    // A failed write may leave part of a record, so nothing more goes after it.
+    sealed = ! store.append(number,record,sizeof(record));
+    if (sealed) return false;
+    if (rollover)
+    {
+        Segment segment = { number, 0, index.size() };
+        segmentList.push_back(segment);
+    }
+    Segment & segment = segmentList.back();
+    if (segment.records % HISTORY_BLOCK_RECORDS == 0) addBlock(segmentList.size() - 1,segment.records);
+    ++segment.records;
+    track(entry.timeUnix);
+    return true;
+}
+
+size_t History::size () const
+{
+    return records;
+}
+
+size_t History::segments () const
+{
+    return segmentList.size();
+}
+
+uint32_t History::lastTime () const
+{
+    return last;
+}
+
+uint32_t History::runTime () const
+{
+    return run;
+}
+
+size_t History::blockRecords (size_t block) const
+{
+    size_t left = segmentList[index[block].segment].records - index[block].first;
+    return left < HISTORY_BLOCK_RECORDS ? left : HISTORY_BLOCK_RECORDS;
+}
+
+bool History::readBlock (size_t block, uint8_t * bytes)
+{
+    Block const & position = index[block];
+    return store.read(segmentList[position.segment].number,position.first * HISTORY_RECORD_BYTES,bytes,blockRecords(block) * HISTORY_RECORD_BYTES);
+}
+
+bool History::query (uint32_t from, uint32_t to, std::vector<Entry> & entries)
+{
+    // Blocks before the first one that reaches the range only hold older entries.
+    size_t low = 0;
+    size_t high = index.size();
+    while (low < high)
+    {
+        size_t middle = low + (high - low) / 2;
+        if (index[middle].high < from)
+            low = middle + 1;
+        else
+            high = middle;
+    }
+    uint8_t bytes[HISTORY_BLOCK_RECORDS * HISTORY_RECORD_BYTES];
+    for (size_t block = low; block < index.size() && index[block].low < to; ++block)
+    {
+        if (! readBlock(block,bytes)) return false;
+        size_t count = blockRecords(block);
+        for (size_t i = 0; i < count; ++i)
+        {
+            Entry entry;
+            if (! readEntryRecord(bytes + i * HISTORY_RECORD_BYTES,&entry)) return false;
+            if (entry.timeUnix >= from && entry.timeUnix < to) entries.push_back(entry);
+        }
+    }
+    return true;
+}
+
+bool History::findSuperseded (size_t segment, std::vector<bool> & superseded)
+{
+    uint8_t bytes[HISTORY_BLOCK_RECORDS * HISTORY_RECORD_BYTES];
+    std::vector<uint64_t> keys;
+    uint32_t oldest = 0xffffffff;
+    uint32_t newest = 0;
+    size_t end = segmentList[segment + 1].firstBlock;
+    for (size_t block = segmentList[segment].firstBlock; block < end; ++block)
+    {
+        if (! readBlock(block,bytes)) return false;
+        size_t count = blockRecords(block);
+        for (size_t i = 0; i < count; ++i)
+        {
+            uint8_t const * record = bytes + i * HISTORY_RECORD_BYTES;
+            keys.push_back(recordKey(record));
+            oldest = std::min(oldest,recordTime(record));
+            newest = std::max(newest,recordTime(record));
+        }
+    }
+    // Only the keys of later records in the times of the segment matter, and
+    // the blocks from where all records are newer hold none of them.
+    std::set<uint64_t> later;
+    for (size_t block = end; block < index.size() && index[block].low <= newest; ++block)
+    {
+        if (! readBlock(block,bytes)) return false;
+        size_t count = blockRecords(block);
+        for (size_t i = 0; i < count; ++i)
+        {
+            uint8_t const * record = bytes + i * HISTORY_RECORD_BYTES;
+            uint32_t time = recordTime(record);
+            if (time >= oldest && time <= newest) later.insert(recordKey(record));
+        }
+    }
+    superseded.assign(keys.size(),false);
+    for (size_t i = keys.size(); i > 0; --i)
+        superseded[i-1] = ! later.insert(keys[i-1]).second;
+    return true;
+}
+
+bool History::copySurvivors (size_t segment, std::vector<bool> const & superseded)
+{
+    Survivors survivors(store,segmentList[segment].number | HISTORY_SCRATCH_SEGMENT);
+    uint8_t bytes[HISTORY_BLOCK_RECORDS * HISTORY_RECORD_BYTES];
+    size_t record = 0;
+    size_t end = segmentList[segment + 1].firstBlock;
+    for (size_t block = segmentList[segment].firstBlock; block < end; ++block)
+    {
+        if (! readBlock(block,bytes)) return false;
+        size_t count = blockRecords(block);
+        for (size_t i = 0; i < count; ++i, ++record)
+            if (! superseded[record] && ! survivors.add(bytes + i * HISTORY_RECORD_BYTES)) return false;
+    }
+    return survivors.flush();
+}
+
+bool History::compactSegment (size_t segment)
+{
+    uint32_t number = segmentList[segment].number;
+    uint32_t scratch = number | HISTORY_SCRATCH_SEGMENT;
+    std::vector<bool> superseded;
+    if (! findSuperseded(segment,superseded)) return false;
+    size_t kept = std::count(superseded.begin(),superseded.end(),false);
+    if (kept == superseded.size()) return true;
+    if (kept == 0) return store.remove(number);
+    store.remove(scratch);
+    if (! copySurvivors(segment,superseded))
+    {
+        store.remove(scratch);
+        return false;
+    }
+    // From here on, open finishes the compaction if it is interrupted.
+    if (! store.remove(number))
+    {
+        store.remove(scratch);
+        return false;
+    }
+    return store.rename(scratch,number);
+}
+
+bool History::compact (uint32_t before)
+{
+    // A segment can go when it and the ones before only hold older entries.
+    size_t drop = 0;
+    while (drop + 1 < segmentList.size() && index[segmentList[drop + 1].firstBlock - 1].high < before) ++drop;
+    bool ok = true;
+    for (size_t segment = 0; ok && segment < drop; ++segment)
+        ok = store.remove(segmentList[segment].number);
+    for (size_t segment = drop; ok && segment + 1 < segmentList.size(); ++segment)
+        ok = compactSegment(segment);
+    return open() && ok;
+}
+
+} // weather
@@ -0,0 +1,135 @@
+// This software is part of OpenMono, see http://developer.openmono.com
+// Released under the MIT license, see LICENSE.txt
+#if !defined(__com_openmono_history_h)
+#define __com_openmono_history_h
+#include "isegmentstore.hpp"
+#include "snapshot.hpp"
+#include "weather.hpp"
+#include <stddef.h>
+#include <stdint.h>
+#include <vector>
+
+#define HISTORY_RECORD_BYTES SNAPSHOT_ENTRY_BYTES
+#define HISTORY_BLOCK_RECORDS 16
+#define HISTORY_SEGMENT_RECORDS 256
+#define HISTORY_SCRATCH_SEGMENT 0x80000000
+
+namespace weather {
+
+/**
+ * History keeps entries for weeks in a log of segments that only grow at
+ * their end.  Each segment holds up to HISTORY_SEGMENT_RECORDS records in
+ * the layout of writeEntryRecord, and the next segment starts when it is
+ * full.  The entries come in runs in the order of their time, such as the
+ * forecasts of one refresh, and each run starts no earlier than the run
+ * before it.
+ *
+ * An index in memory holds, for every block of HISTORY_BLOCK_RECORDS
+ * records, the oldest time in it and after it, and the newest time in it
+ * and before it, so a query searches the index and then reads one block at
+ * a time: a query that finds k entries among n costs O(log n) in memory and
+ * k / HISTORY_BLOCK_RECORDS + 2 reads, plus the blocks of the runs that
+ * overlap the range.
+ *
+ * Examples:
+ *
+ *      History history(store);
+ *      history.open();
+ *      history.append(entry);
+ *      std::vector<Entry> lastWeek;
+ *      history.query(now - 7 * 24 * 3600,now,lastWeek);
+ *      history.compact(now - 28 * 24 * 3600);
+ *
+ * An entry with the same time and city as a later one is superseded by it,
+ * such as an older forecast for the same time, and compact removes it.
+ */
+class History
+{
+public:
+    History (ISegmentStore & store);
+    /**
+     * Read the segments in the store, one block at a time, to index them,
+     * and finish a compaction that was interrupted.
+     * @return false if the store could not be read.
+     */
+    bool open ();
+    /**
+     * Add an entry at the end of the log.  An entry older than lastTime()
+     * starts a new run.  A record that was only partly written before is
+     * left behind, and the entry goes to a new segment.
+     * @return false if the entry is older than runTime(), or if it could
+     *         not be written.
+     */
+    bool append (Entry const & entry);
+    /**
+     * @return number of entries in the log.
+     */
+    size_t size () const;
+    /**
+     * @return number of segments in the log.
+     */
+    size_t segments () const;
+    /**
+     * @return time of the last entry, 0 if the log is empty.
+     */
+    uint32_t lastTime () const;
+    /**
+     * @return time of the first entry of the last run, 0 if the log is empty.
+     */
+    uint32_t runTime () const;
+    /**
+     * Find the entries from one time until another.
+     * @param  from    time of the first entries to find.
+     * @param  to      time after the last entries to find.
+     * @param  entries where to append the entries, in the order of the log.
+     * @return         false if the store could not be read.
+     */
+    bool query (uint32_t from, uint32_t to, std::vector<Entry> & entries);
+    /**
+     * Remove the segments whose entries are all older than a time, and the
+     * superseded entries of the other segments, except the last one.
+     * @param  before time of the oldest entries to keep.
+     * @return        false if the store could not be changed.
+     */
+    bool compact (uint32_t before);
+private:
+    struct Segment
+    {
+        uint32_t number;
+        size_t records;
+        size_t firstBlock;
+    };
+    struct Block
+    {
+        /**
+         * Oldest time in this block and the ones after it.
+         */
+        uint32_t low;
+        /**
+         * Newest time in this block and the ones before it.
+         */
+        uint32_t high;
+        size_t segment;
+        size_t first;
+    };
+    ISegmentStore & store;
+    std::vector<Segment> segmentList;
+    std::vector<Block> index;
+    size_t records;
+    uint32_t last;
+    uint32_t run;
+    uint32_t nextSegment;
+    bool sealed;
+    void recover ();
+    void addBlock (size_t segment, size_t first);
+    void track (uint32_t time);
+    size_t blockRecords (size_t block) const;
+    bool readBlock (size_t block, uint8_t * bytes);
+    bool findSuperseded (size_t segment, std::vector<bool> & superseded);
+    bool copySurvivors (size_t segment, std::vector<bool> const & superseded);
+    bool compactSegment (size_t segment);
+};
+
+} // weather
+
+#endif // __com_openmono_history_h
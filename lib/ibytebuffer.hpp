@@ -50,12 +50,25 @@ struct IByteBuffer
      * @param  index chunk index between 0 and chunks().
      * @return       A pointer to the contents of the chunk, possibly in temporary storage.
      */
-    virtual uint8_t const * const chunk (size_t index) const = 0;
+    virtual uint8_t const * chunk (size_t index) const = 0;
+
+    /**
+     * @return true if pointers returned by chunk stay valid until the buffer
+     *         is cleared, false if they are only valid until the next call.
+     */
+    virtual bool hasStableChunks () const { return false; }
 
     /**
      * Empty the buffer.
      */
     virtual void clear () = 0;
+
+    /**
+     * Tell whether the contents have changed.  The generation changes every
+     * time something is added or the buffer is cleared.
+     * @return generation of the contents.
+     */
+    virtual uint32_t generation () const = 0;
 };
 
 #endif // __com_openmono_ibytebuffer_h
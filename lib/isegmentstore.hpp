@@ -0,0 +1,57 @@
+// This software is part of OpenMono, see http://developer.openmono.com
+// Released under the MIT license, see LICENSE.txt
+#if !defined(__com_openmono_isegmentstore_h)
+#define __com_openmono_isegmentstore_h
+#include <stdint.h>
+#include <stddef.h>
+#include <vector>
+
+/**
+ * SegmentStore holds numbered files that only grow at their end, such as
+ * the segments of a log on an SD card.
+ */
+struct ISegmentStore
+{
+    virtual ~ISegmentStore () {};
+
+    /**
+     * @param numbers where to store the numbers of the existing segments, in
+     *                increasing order.
+     */
+    virtual void segments (std::vector<uint32_t> & numbers) = 0;
+
+    /**
+     * @param  segment number of the segment.
+     * @return         bytes in the segment, 0 if it does not exist.
+     */
+    virtual size_t bytes (uint32_t segment) = 0;
+
+    /**
+     * Read part of a segment in one read.
+     * @param  segment     number of the segment.
+     * @param  offset      position of the first byte to read.
+     * @param  destination where to store the bytes.
+     * @param  length      number of bytes to read.
+     * @return             false if the bytes could not all be read.
+     */
+    virtual bool read (uint32_t segment, size_t offset, uint8_t * destination, size_t length) = 0;
+
+    /**
+     * Add bytes at the end of a segment, which is created if needed.
+     * @return false if the bytes could not all be written.
+     */
+    virtual bool append (uint32_t segment, uint8_t const * source, size_t length) = 0;
+
+    /**
+     * @return false if the segment could not be removed.
+     */
+    virtual bool remove (uint32_t segment) = 0;
+
+    /**
+     * Give a segment another number, which must not exist.
+     * @return false if the segment could not be renamed.
+     */
+    virtual bool rename (uint32_t from, uint32_t to) = 0;
+};
+
+#endif // __com_openmono_isegmentstore_h
@@ -2,8 +2,10 @@
 // Released under the MIT license, see LICENSE.txt
 #include "jsonparser.hpp"
 #include "SmallJSONParser.h"
+#include "decimal.hpp"
 #include "weather.hpp"
 #include <cstdlib>
+#include <string.h>
 
 //#define DEBUG
 #if defined(DEBUG)
@@ -21,6 +23,55 @@ extern "C" bool inputProvider (JSONParser * parser, void * context)
     return owner->provideMoreInput();
 }
 
+extern "C" bool growBuffer (JSONProvider * provider, size_t needed)
+{
+    json::Json * owner = (json::Json *)provider->context;
+    return owner->growValueBuffer(needed);
+}
+
+bool readAnyChunk (IByteBuffer const & buffer, size_t index, uint8_t const ** chunk, size_t * length)
+{
+    if (index >= buffer.chunks()) return false;
+    *chunk = buffer.chunk(index);
+    *length = buffer.chunkBytes(index);
+    return true;
+}
+
+bool isSimpleValue (JSONToken token)
+{
+    int type = JSONTokenType(token);
+    return
+        type == StringJSONToken || type == NumberJSONToken || type == TrueJSONToken ||
+        type == FalseJSONToken || type == NullJSONToken;
+}
+
+uint8_t const * copyValue (JSONToken token, Arena & results)
+{
+    uint8_t * buf = results.allocate(SizeOfUnescapingBufferForJSONStringToken(token));
+    if (0 == buf) return 0;
+    UnescapeJSONStringToken(token,buf,0);
+    return buf;
+}
+
+ByteView copyView (JSONToken token, Arena & results)
+{
+    uint8_t * buf = results.allocate(SizeOfUnescapingBufferForJSONStringToken(token));
+    if (0 == buf) return ByteView();
+    uint8_t * end;
+    UnescapeJSONStringToken(token,buf,&end);
+    return ByteView(buf,end-buf);
+}
+
+/**
+ * @return true if prefix is the first whole segments of path.
+ */
+bool isPathPrefix (char const * prefix, size_t prefixLength, char const * path, size_t pathLength)
+{
+    if (prefixLength > pathLength) return false;
+    if (memcmp(prefix,path,prefixLength) != 0) return false;
+    return (prefixLength == pathLength || path[prefixLength] == '/');
+}
+
 } // namespace {
 
 namespace json {
@@ -28,128 +79,848 @@ namespace json {
 struct Searcher
 {
     Json & parent;
-    char const * path;
-    size_t pathIndex;
-    char key[MAX_KEYSIZE];
-    Searcher (char const * path_, Json & parent_)
+    JsonPath const & path;
+    size_t placeholderIndex;
+    size_t segment;
+    Searcher (JsonPath const & path_, size_t placeholderIndex_, Json & parent_)
     :
         parent(parent_),
         path(path_),
-        pathIndex(0)
+        placeholderIndex(placeholderIndex_),
+        segment(0)
     {
         parent.restart();
     }
     JSONToken lookupValue ()
     {
         JSONToken token;
-        while (! isAtEndOfPath())
+        if (! path.isValid() || path.hasWildcard())
+        {
+            token.typeandflags = ParseErrorJSONToken;
+            token.start = token.end = 0;
+            return token;
+        }
+        resumeFromNearestCheckpoint();
+        for (; segment < path.segments(); ++segment)
         {
-            nextKey();
 #           if defined(DEBUG)
-            std::cout << "looking for key " << key << std::endl;
+            std::cout << "looking for key " << std::string(path.segmentText(segment),path.segment(segment).length) << std::endl;
 #           endif
             token = NextJSONTokenWithProvider(&parent.parser,&parent.provider);
             if (JSONTokenType(token) == StartArrayJSONToken)
             {
-                size_t i = atoi(key);
-                while (i > 0)
-                {
-                    --i;
-                    if (! SkipJSONValueWithProvider(&parent.parser,&parent.provider)) break;
-                }
+                skipElements(segment,0,elementIndex(segment));
             }
-            else if (!SkipUntilJSONObjectKeyWithProvider(&parent.parser,&parent.provider,key))
+            else if (!SkipUntilJSONObjectKeyWithLengthWithProvider(&parent.parser,&parent.provider,path.segmentText(segment),path.segment(segment).length))
             {
 #               if defined(DEBUG)
                 std::cout << "not found" << std::endl;
 #               endif
                 token.typeandflags = ParseErrorJSONToken;
                 return token;
-                break;
             }
         }
         token = NextJSONTokenWithProvider(&parent.parser,&parent.provider);
 #       if defined(DEBUG)
         std::cout << JSONTokenType(token) << std::endl;
-#       endif
-        uint8_t buf[SizeOfUnescapingBufferForJSONStringToken(token)];
-        UnescapeJSONStringToken(token,buf,0);
-#       if defined(DEBUG)
-        //std::cout << buf << std::endl;
 #       endif
         return token;
     }
-    bool isAtEndOfPath () const
+    size_t elementIndex (size_t index) const
+    {
+        JsonPath::Segment const & segment = path.segment(index);
+        return segment.isPlaceholder ? placeholderIndex : segment.index;
+    }
+    /**
+     * Checkpoints are keyed on the path to the array, which is only known
+     * when no placeholder comes before it.
+     */
+    bool isCheckpointed (size_t index) const
     {
-        return ('\0' == path[pathIndex]);
+        return ! path.hasPlaceholderBefore(index);
+    }
+    /**
+     * Skip from the start of one array element to the start of another.
+     * @param index segment of the path that indexes the array.
+     */
+    bool skipElements (size_t index, size_t from, size_t to)
+    {
+        bool checkpointed = isCheckpointed(index);
+        size_t arrayPathLength = path.prefixLength(index);
+        for (size_t i = from; i < to; ++i)
+        {
+            if (checkpointed) parent.passElement(path.text(),arrayPathLength,i);
+            if (! SkipJSONValueWithProvider(&parent.parser,&parent.provider)) return false;
+        }
+        if (checkpointed && to > 0) parent.passElement(path.text(),arrayPathLength,to);
+        return true;
     }
-    char const * nextKey ()
+    /**
+     * Jump to the deepest array element in the path that has a checkpoint.
+     */
+    void resumeFromNearestCheckpoint ()
     {
-        if (isAtEndOfPath()) return 0;
-        if (path[pathIndex] != '/') return 0;
-        size_t i = 0;
-        for (++pathIndex; path[pathIndex] != '/' && !isAtEndOfPath(); ++i, ++pathIndex)
+        Json::Checkpoint const * nearest = 0;
+        size_t nearestSegment = 0;
+        for (size_t i = 0; i < path.segments() && isCheckpointed(i); ++i)
         {
-            key[i] = path[pathIndex];
+            JsonPath::Segment const & segment = path.segment(i);
+            if (! segment.isIndex && ! segment.isPlaceholder) continue;
+            Json::Checkpoint const * checkpoint = parent.nearestCheckpoint(path.text(),path.prefixLength(i),elementIndex(i));
+            if (0 == checkpoint) continue;
+            nearest = checkpoint;
+            nearestSegment = i;
         }
-        key[i] = '\0';
-        return key;
+        if (0 == nearest) return;
+        parent.resume(*nearest);
+        skipElements(nearestSegment,nearest->element,elementIndex(nearestSegment));
+        segment = nearestSegment + 1;
     }
 };
 
-Json::Json (IByteBuffer const & byteBuffer_)
+/**
+ * Walks the JSON document once, descending only into the parts that can
+ * contain a path of the extraction and skipping everything else.
+ */
+struct Extractor
+{
+    typedef std::vector<Extraction::Field> Fields;
+    Json & parent;
+    Extraction & extraction;
+    char path[MAX_PATHSIZE];
+    size_t pathLength;
+    size_t elementPathStart;
+    size_t fieldsFound;
+    size_t elementsVisited;
+    bool finished;
+    Extractor (Extraction & extraction_, Json & parent_)
+    :
+        parent(parent_),
+        extraction(extraction_),
+        pathLength(0),
+        elementPathStart(0),
+        fieldsFound(0),
+        elementsVisited(0),
+        finished(false)
+    {
+        path[0] = '\0';
+        parent.restart();
+    }
+    bool run ()
+    {
+        if (isComplete()) return true;
+        if (walkValue(next())) finished = true;
+        return finished;
+    }
+    JSONToken next ()
+    {
+        return NextJSONTokenWithProvider(&parent.parser,&parent.provider);
+    }
+    /**
+     * @return false when walking should stop, because of an error, because the results arena is full or because all values have been found.
+     */
+    bool walkValue (JSONToken token)
+    {
+        int type = JSONTokenType(token);
+        if (type == StartObjectJSONToken) return walkObject();
+        if (type == StartArrayJSONToken) return walkArray();
+        if (! isSimpleValue(token)) return false;
+        return store(token);
+    }
+    bool walkObject ()
+    {
+        for (;;)
+        {
+            JSONToken key = next();
+            int type = JSONTokenType(key);
+            if (type == EndObjectJSONToken) return true;
+            if (type != StringJSONToken) return false;
+            size_t parentLength = pathLength;
+            bool ok;
+            if (pushSegment(key.start,key.end-key.start) && isWanted())
+                ok = walkValue(next());
+            else
+                ok = SkipJSONValueWithProvider(&parent.parser,&parent.provider);
+            popSegments(parentLength);
+            if (! ok) return false;
+        }
+    }
+    bool walkArray ()
+    {
+        bool elements = isElementArray();
+        for (size_t index = 0; ; ++index)
+        {
+            JSONToken token = next();
+            if (JSONTokenType(token) == EndArrayJSONToken) return true;
+            size_t parentLength = pathLength;
+            bool ok;
+            if (! pushIndex(index))
+                ok = skipValue(token);
+            else if (elements)
+                ok = walkElement(token,index);
+            else if (isWanted())
+                ok = walkValue(token);
+            else
+                ok = skipValue(token);
+            popSegments(parentLength);
+            if (! ok) return false;
+        }
+    }
+    bool walkElement (JSONToken token, size_t index)
+    {
+        if (index >= extraction.maxElements) return skipValue(token);
+        Fields & fields = extraction.elementFields;
+        for (size_t i = 0; i < fields.size(); ++i) *fields[i].value = 0;
+        elementPathStart = pathLength;
+        bool ok = walkValue(token);
+        elementPathStart = 0;
+        if (! ok) return false;
+        extraction.visitor->element(index);
+        ++elementsVisited;
+        return ! stopIfComplete();
+    }
+    bool skipValue (JSONToken token)
+    {
+        int type = JSONTokenType(token);
+        if (type == StartObjectJSONToken || type == StartArrayJSONToken)
+            return SkipUntilEndOfJSONObjectWithProvider(&parent.parser,&parent.provider);
+        return isSimpleValue(token);
+    }
+    bool store (JSONToken token)
+    {
+        Fields & fields = extraction.fields;
+        for (size_t i = 0; i < fields.size(); ++i)
+        {
+            if (*fields[i].value != 0) continue;
+            if (fields[i].length != pathLength || memcmp(fields[i].path,path,pathLength) != 0) continue;
+            uint8_t const * value = copyValue(token,parent.resultArena);
+            if (0 == value) return false;
+            *fields[i].value = value;
+            ++fieldsFound;
+            return ! stopIfComplete();
+        }
+        if (0 == elementPathStart) return true;
+        Fields & elementFields = extraction.elementFields;
+        char const * relative = path + elementPathStart;
+        size_t relativeLength = pathLength - elementPathStart;
+        for (size_t i = 0; i < elementFields.size(); ++i)
+        {
+            if (elementFields[i].length != relativeLength) continue;
+            if (memcmp(elementFields[i].path,relative,relativeLength) != 0) continue;
+            *elementFields[i].value = copyValue(token,parent.resultArena);
+            return *elementFields[i].value != 0;
+        }
+        return true;
+    }
+    bool isComplete () const
+    {
+        if (fieldsFound < extraction.fields.size()) return false;
+        if (extraction.visitor != 0 && elementsVisited < extraction.maxElements) return false;
+        return true;
+    }
+    bool stopIfComplete ()
+    {
+        if (isComplete()) finished = true;
+        return finished;
+    }
+    bool isElementArray () const
+    {
+        if (0 == extraction.visitor || elementPathStart != 0) return false;
+        if (pathLength != extraction.arrayPathLength) return false;
+        return memcmp(path,extraction.arrayPath,pathLength) == 0;
+    }
+    bool isWanted () const
+    {
+        Fields const & fields = extraction.fields;
+        for (size_t i = 0; i < fields.size(); ++i)
+        {
+            if (*fields[i].value != 0) continue;
+            if (isPathPrefix(path,pathLength,fields[i].path,fields[i].length)) return true;
+        }
+        if (extraction.visitor != 0)
+        {
+            if (isPathPrefix(path,pathLength,extraction.arrayPath,extraction.arrayPathLength)) return true;
+        }
+        if (0 == elementPathStart) return false;
+        Fields const & elementFields = extraction.elementFields;
+        char const * relative = path + elementPathStart;
+        size_t relativeLength = pathLength - elementPathStart;
+        for (size_t i = 0; i < elementFields.size(); ++i)
+        {
+            if (isPathPrefix(relative,relativeLength,elementFields[i].path,elementFields[i].length)) return true;
+        }
+        return false;
+    }
+    bool pushSegment (uint8_t const * segment, size_t length)
+    {
+        if (pathLength + 1 + length >= MAX_PATHSIZE) return false;
+        path[pathLength] = '/';
+        memcpy(path+pathLength+1,segment,length);
+        pathLength += 1 + length;
+        path[pathLength] = '\0';
+        return true;
+    }
+    bool pushIndex (size_t index)
+    {
+        uint8_t digits[24];
+        size_t length = 0;
+        do
+        {
+            digits[sizeof(digits) - ++length] = uint8_t('0' + index % 10);
+            index /= 10;
+        }
+        while (index != 0);
+        return pushSegment(digits + sizeof(digits) - length,length);
+    }
+    void popSegments (size_t length)
+    {
+        pathLength = length;
+        path[pathLength] = '\0';
+    }
+};
+
+/**
+ * Follows a path with wildcards through the JSON document, visiting every
+ * element of the arrays that wildcards stand for, and skipping everything else.
+ */
+struct Projector
+{
+    Json & parent;
+    JsonPath const & path;
+    IProjectionVisitor & visitor;
+    size_t element;
+    Projector (JsonPath const & path_, IProjectionVisitor & visitor_, Json & parent_)
+    :
+        parent(parent_),
+        path(path_),
+        visitor(visitor_),
+        element(0)
+    {
+        parent.restart();
+    }
+    bool run ()
+    {
+        if (! path.isValid()) return false;
+        return matchValue(0,next());
+    }
+    JSONToken next ()
+    {
+        return NextJSONTokenWithProvider(&parent.parser,&parent.provider);
+    }
+    /**
+     * Match the rest of the path from a segment against a value, and consume all of the value.
+     * @return false if the document could not be parsed.
+     */
+    bool matchValue (size_t segment, JSONToken token)
+    {
+        int type = JSONTokenType(token);
+        if (segment == path.segments())
+        {
+            if (isSimpleValue(token))
+            {
+                visitor.value(element,token);
+                return true;
+            }
+            return skipValue(token);
+        }
+        if (type == StartObjectJSONToken) return matchObject(segment);
+        if (type == StartArrayJSONToken) return matchArray(segment);
+        return isSimpleValue(token);
+    }
+    bool matchObject (size_t segment)
+    {
+        JsonPath::Segment const & key = path.segment(segment);
+        for (;;)
+        {
+            JSONToken token = next();
+            int type = JSONTokenType(token);
+            if (type == EndObjectJSONToken) return true;
+            if (type != StringJSONToken) return false;
+            if (! key.isWildcard && FastIsJSONStringEqualWithLength(token,path.segmentText(segment),key.length))
+            {
+                if (! matchValue(segment+1,next())) return false;
+                return SkipUntilEndOfJSONObjectWithProvider(&parent.parser,&parent.provider);
+            }
+            if (! SkipJSONValueWithProvider(&parent.parser,&parent.provider)) return false;
+        }
+    }
+    bool matchArray (size_t segment)
+    {
+        JsonPath::Segment const & index = path.segment(segment);
+        for (size_t i = 0; ; ++i)
+        {
+            JSONToken token = next();
+            int type = JSONTokenType(token);
+            if (type == EndArrayJSONToken) return true;
+            bool ok;
+            if (index.isWildcard)
+            {
+                size_t outer = element;
+                element = i;
+                ok = matchValue(segment+1,token);
+                element = outer;
+            }
+            else if (index.isIndex && index.index == i)
+                ok = matchValue(segment+1,token);
+            else
+                ok = skipValue(token);
+            if (! ok) return false;
+        }
+    }
+    bool skipValue (JSONToken token)
+    {
+        int type = JSONTokenType(token);
+        if (type == StartObjectJSONToken || type == StartArrayJSONToken)
+            return SkipUntilEndOfJSONObjectWithProvider(&parent.parser,&parent.provider);
+        return isSimpleValue(token);
+    }
+};
+
+/**
+ * Stores projected values in a column.
+ */
+struct ColumnFiller
+:
+    public IProjectionVisitor
+{
+    uint8_t const ** column;
+    size_t rows;
+    size_t used;
+    Arena & results;
+    ColumnFiller (uint8_t const ** column_, size_t rows_, Arena & results_)
+    :
+        column(column_),
+        rows(rows_),
+        used(0),
+        results(results_)
+    {
+        for (size_t i = 0; i < rows; ++i) column[i] = 0;
+    }
+    virtual void value (size_t index, JSONToken const & token)
+    {
+        if (index >= rows) return;
+        column[index] = copyValue(token,results);
+        if (index >= used) used = index + 1;
+    }
+};
+
+Json::Json (IByteBuffer const & byteBuffer_, size_t maxCheckpoints_)
+:
+    byteBuffer(byteBuffer_),
+    readChunk(readAnyChunk),
+    nextChunkIndex(0),
+    provider(),
+    maxCheckpoints(maxCheckpoints_),
+    tape(0),
+    reassembled(0),
+    resultArena(ownResults),
+    generation(byteBuffer_.generation()),
+    maxCachedBytes(DEFAULT_CACHE_BYTES)
+{
+}
+
+Json::Json (IByteBuffer const & byteBuffer_, Arena & results_, size_t maxCheckpoints_)
+:
+    byteBuffer(byteBuffer_),
+    readChunk(readAnyChunk),
+    nextChunkIndex(0),
+    provider(),
+    maxCheckpoints(maxCheckpoints_),
+    tape(0),
+    reassembled(0),
+    resultArena(results_),
+    generation(byteBuffer_.generation()),
+    maxCachedBytes(DEFAULT_CACHE_BYTES)
+{
+}
+
+Json::Json (IByteBuffer const & byteBuffer_, ChunkReader readChunk_, size_t maxCheckpoints_)
+:
+    byteBuffer(byteBuffer_),
+    readChunk(readChunk_),
+    nextChunkIndex(0),
+    provider(),
+    maxCheckpoints(maxCheckpoints_),
+    tape(0),
+    reassembled(0),
+    resultArena(ownResults),
+    generation(byteBuffer_.generation()),
+    maxCachedBytes(DEFAULT_CACHE_BYTES)
+{
+}
+
+Json::Json (IByteBuffer const & byteBuffer_, Arena & results_, ChunkReader readChunk_, size_t maxCheckpoints_)
 :
     byteBuffer(byteBuffer_),
-    nextChunkIndex(0)
+    readChunk(readChunk_),
+    nextChunkIndex(0),
+    provider(),
+    maxCheckpoints(maxCheckpoints_),
+    tape(0),
+    reassembled(0),
+    resultArena(results_),
+    generation(byteBuffer_.generation()),
+    maxCachedBytes(DEFAULT_CACHE_BYTES)
+{
+}
+
+Arena & Json::results ()
 {
+    return resultArena;
 }
 
 Json::~Json ()
 {
+    delete tape;
+}
+
+void Json::enableCache (size_t entries, size_t bytes)
+{
+    size_t size = 1;
+    while (size < entries) size *= 2;
+    CachedValue empty;
+    memset(&empty,0,sizeof(empty));
+    cache.assign(size,empty);
+    cachedValues.reset();
+    maxCachedBytes = bytes;
+}
+
+bool Json::buildIndex ()
+{
+    sync();
+    if (0 == tape) tape = new Tape(byteBuffer);
+    return tape->build();
 }
 
 uint8_t const * Json::lookup (char const * path)
+{
+    return lookup(JsonPath(path));
+}
+
+uint8_t const * Json::lookup (JsonPath const & path, size_t index)
 {
 #   if defined(DEBUG)
-    std::cout << "path " << path << std::endl;
+    std::cout << "path " << path.text() << std::endl;
 #   endif
-    Searcher state(path,*this);
-    JSONToken token = state.lookupValue();
-    int type = JSONTokenType(token);
-    if
-    (
-        type != StringJSONToken && type != NumberJSONToken && type != TrueJSONToken &&
-        type != FalseJSONToken && type != NullJSONToken
-    ){
-        return 0;
+    sync();
+    if (tape != 0 && tape->isBuilt()) return tape->lookup(path,index,resultArena);
+    if (! cache.empty())
+    {
+        CachedValue const * cached = lookupCached(path,index);
+        return (0 == cached) ? 0 : cached->value;
     }
+    Searcher state(path,index,*this);
+    JSONToken token = state.lookupValue();
+    if (! isSimpleValue(token)) return 0;
 #   if defined(DEBUG)
     std::cout << "  buffer size " << SizeOfUnescapingBufferForJSONStringToken(token) << std::endl;
 #   endif
-    uint8_t * buf = new uint8_t[SizeOfUnescapingBufferForJSONStringToken(token)];
-    UnescapeJSONStringToken(token,buf,0);
-    return buf;
+    return copyValue(token,resultArena);
+}
+
+ByteView Json::lookupView (char const * path)
+{
+    return lookupView(JsonPath(path));
+}
+
+ByteView Json::lookupView (JsonPath const & path, size_t index)
+{
+    sync();
+    if (tape != 0 && tape->isBuilt())
+    {
+        uint8_t const * value = tape->lookup(path,index,resultArena);
+        if (0 == value) return ByteView();
+        return ByteView(value,strlen((char const *)value));
+    }
+    if (! cache.empty())
+    {
+        CachedValue const * cached = lookupCached(path,index);
+        if (0 == cached || 0 == cached->value) return ByteView();
+        return ByteView(cached->value,cached->length);
+    }
+    Searcher state(path,index,*this);
+    JSONToken token = state.lookupValue();
+    if (! isSimpleValue(token)) return ByteView();
+    size_t length = token.end - token.start;
+    bool escaped = JSONTokenType(token) == StringJSONToken && memchr(token.start,'\\',length) != 0;
+    if (isInDocument(token) && ! escaped) return ByteView(token.start,length);
+    return copyView(token,resultArena);
+}
+
+bool Json::lookupNumber (JsonPath const & path, size_t index, JSONToken & token)
+{
+    sync();
+    if (tape != 0 && tape->isBuilt())
+        return tape->lookupNumber(path,index,valueBuffer,sizeof(valueBuffer),token);
+    if (! cache.empty())
+    {
+        CachedValue const * cached = lookupCached(path,index);
+        if (0 == cached || 0 == cached->value) return false;
+        token.typeandflags = cached->type;
+        token.start = cached->value;
+        token.end = cached->value + cached->length;
+        return JSONTokenType(token) == NumberJSONToken && ! IsJSONTokenTruncated(token);
+    }
+    Searcher state(path,index,*this);
+    token = state.lookupValue();
+    return JSONTokenType(token) == NumberJSONToken && ! IsJSONTokenTruncated(token);
+}
+
+bool Json::lookupInt (char const * path, int & value)
+{
+    return lookupInt(JsonPath(path),value);
+}
+
+bool Json::lookupInt (JsonPath const & path, int & value, size_t index)
+{
+    JSONToken token;
+    if (! lookupNumber(path,index,token)) return false;
+    return ParseNumberTokenAsInteger(token,&value);
+}
+
+bool Json::lookupFixedPoint (char const * path, unsigned decimals, int32_t & value)
+{
+    return lookupFixedPoint(JsonPath(path),decimals,value);
+}
+
+bool Json::lookupFixedPoint (JsonPath const & path, unsigned decimals, int32_t & value, size_t index)
+{
+    JSONToken token;
+    if (! lookupNumber(path,index,token)) return false;
+    return Decimal::toFixed(token,decimals,&value);
+}
+
+#if defined(DECIMAL_DOUBLE)
+bool Json::lookupDouble (char const * path, double & value)
+{
+    return lookupDouble(JsonPath(path),value);
 }
 
+bool Json::lookupDouble (JsonPath const & path, double & value, size_t index)
+{
+    JSONToken token;
+    if (! lookupNumber(path,index,token)) return false;
+    return Decimal::toDouble(token,&value);
+}
+#endif
+
 size_t Json::lookupArraySize (char const * path)
 {
-    Searcher state(path,*this);
+    return lookupArraySize(JsonPath(path));
+}
+
+size_t Json::lookupArraySize (JsonPath const & path, size_t index)
+{
+    sync();
+    if (tape != 0 && tape->isBuilt()) return tape->lookupArraySize(path,index);
+    Searcher state(path,index,*this);
     JSONToken token = state.lookupValue();
     if (JSONTokenType(token) != StartArrayJSONToken) return 0;
     size_t length = 0;
+    bool checkpointed = state.isCheckpointed(path.segments());
     while (JSONTokenType(token) != EndArrayJSONToken)
     {
+        if (checkpointed) passElement(path.text(),path.length(),length);
         if (! SkipJSONValueWithProvider(&parser,&provider)) break;
         ++length;
     }
     return length;
 }
 
+bool Json::extract (Extraction & extraction)
+{
+    Extractor state(extraction,*this);
+    return state.run();
+}
+
+bool Json::project (JsonPath const & path, IProjectionVisitor & visitor)
+{
+    Projector state(path,visitor,*this);
+    return state.run();
+}
+
+size_t Json::project (JsonPath const & path, uint8_t const ** column, size_t rows)
+{
+    ColumnFiller filler(column,rows,resultArena);
+    if (! project(path,filler)) return 0;
+    return filler.used;
+}
+
+bool Json::visit (IJsonVisitor & visitor)
+{
+    restart();
+    JsonWalker walker(visitor);
+    for (;;)
+    {
+        JsonWalker::Status status = walker.token(NextJSONTokenWithProvider(&parser,&provider));
+        if (status != JsonWalker::Walking) return status == JsonWalker::Done;
+    }
+}
+
+/**
+ * Forget everything learnt about the document if the buffer has changed.
+ */
+void Json::sync ()
+{
+    if (byteBuffer.generation() == generation) return;
+    generation = byteBuffer.generation();
+    arrays.clear();
+    delete tape;
+    tape = 0;
+    clearCache();
+}
+
+void Json::clearCache ()
+{
+    for (size_t i = 0; i < cache.size(); ++i) cache[i].isSet = false;
+    cachedValues.reset();
+}
+
+/**
+ * Find the value for a path in the cache, looking it up on a miss.
+ * @return the cached value, or 0 if out of memory.
+ */
+Json::CachedValue const * Json::lookupCached (JsonPath const & path, size_t index)
+{
+    uint32_t hash = JsonPath::hash(path.text(),path.length()) ^ (uint32_t(index) * 0x9e3779b1u);
+    CachedValue & slot = cache[hash & (cache.size() - 1)];
+    if (slot.isSet && slot.hash == hash && slot.index == index && slot.pathLength == path.length() &&
+        memcmp(slot.path,path.text(),path.length()) == 0)
+        return &slot;
+    Searcher state(path,index,*this);
+    JSONToken token = state.lookupValue();
+    // Paths that keep taking each other's slot would otherwise fill memory.
+    size_t bytes = path.length() + (isSimpleValue(token) ? SizeOfUnescapingBufferForJSONStringToken(token) : 0);
+    if (cachedValues.used() + bytes > maxCachedBytes) clearCache();
+    ByteView value;
+    if (isSimpleValue(token))
+    {
+        value = copyView(token,cachedValues);
+        if (value.isNull()) return 0;
+    }
+    char * pathCopy = (char *)cachedValues.allocate(path.length());
+    if (0 == pathCopy) return 0;
+    memcpy(pathCopy,path.text(),path.length());
+    slot.isSet = true;
+    slot.hash = hash;
+    slot.path = pathCopy;
+    slot.pathLength = path.length();
+    slot.index = index;
+    slot.type = token.typeandflags;
+    slot.value = value.bytes;
+    slot.length = value.length;
+    return &slot;
+}
+
 void Json::restart ()
 {
+    sync();
     nextChunkIndex = 0;
     InitialiseJSONParser(&parser);
-    InitialiseJSONProvider(&provider,inputProvider,this,valueBuffer,sizeof(valueBuffer));
+    reassembled += provider.reassembledbytes;
+    // Keep using a buffer that has grown, rather than growing it again.
+    if (reassemblyBuffer.empty())
+        InitialiseJSONProvider(&provider,inputProvider,this,valueBuffer,sizeof(valueBuffer));
+    else
+        InitialiseJSONProvider(&provider,inputProvider,this,&reassemblyBuffer[0],reassemblyBuffer.size());
+    SetJSONProviderGrowCallback(&provider,growBuffer);
+}
+
+/**
+ * @return true if a token points into a chunk that stays valid, rather than
+ *         into the reassembly buffer or a chunk that is about to be replaced.
+ */
+bool Json::isInDocument (JSONToken const & token) const
+{
+    if (! byteBuffer.hasStableChunks()) return false;
+    return token.start < provider.buffer || token.start >= provider.buffer + provider.buffersize;
+}
+
+size_t Json::reassembledBytes () const
+{
+    return reassembled + provider.reassembledbytes;
+}
+
+void Json::resume (Checkpoint const & checkpoint)
+{
+    uint8_t const * chunk = 0;
+    size_t chunkBytes = 0;
+    readChunk(byteBuffer,checkpoint.nextChunkIndex-1,&chunk,&chunkBytes);
+    ProvideJSONInput(&parser,chunk,chunkBytes);
+    parser.currentbyte += chunkBytes - checkpoint.remainingBytes;
+    parser.state = checkpoint.state;
+    parser.partialtokentype = checkpoint.partialTokenType;
+    nextChunkIndex = checkpoint.nextChunkIndex;
+}
+
+Json::ArrayCheckpoints * Json::findArray (char const * arrayPath, size_t arrayPathLength)
+{
+    for (size_t i = 0; i < arrays.size(); ++i)
+    {
+        std::vector<char> const & path = arrays[i].path;
+        if (path.size() == arrayPathLength && memcmp(&path[0],arrayPath,arrayPathLength) == 0)
+            return &arrays[i];
+    }
+    return 0;
+}
+
+void Json::passElement (char const * arrayPath, size_t arrayPathLength, size_t element)
+{
+    // Nothing has been parsed before the first chunk, and only the root can be an empty path.
+    if (0 == maxCheckpoints || 0 == nextChunkIndex || 0 == arrayPathLength) return;
+    ArrayCheckpoints * array = findArray(arrayPath,arrayPathLength);
+    if (0 == array)
+    {
+        if (arrays.size() >= MAX_CHECKPOINTED_ARRAYS) return;
+        arrays.push_back(ArrayCheckpoints());
+        array = &arrays.back();
+        array->path.assign(arrayPath,arrayPath+arrayPathLength);
+        array->stride = 1;
+    }
+    std::vector<Checkpoint> & checkpoints = array->checkpoints;
+    // Checkpoints are always every stride'th element up to the last one.
+    if (element % array->stride != 0) return;
+    if (! checkpoints.empty() && element <= checkpoints.back().element) return;
+    if (checkpoints.size() >= maxCheckpoints)
+    {
+        array->stride *= 2;
+        size_t kept = 0;
+        for (size_t i = 0; i < checkpoints.size(); ++i)
+            if (checkpoints[i].element % array->stride == 0) checkpoints[kept++] = checkpoints[i];
+        checkpoints.resize(kept);
+        if (element % array->stride != 0) return;
+    }
+    Checkpoint checkpoint;
+    checkpoint.element = element;
+    checkpoint.nextChunkIndex = nextChunkIndex;
+    checkpoint.remainingBytes = parser.end - parser.currentbyte;
+    checkpoint.state = parser.state;
+    checkpoint.partialTokenType = parser.partialtokentype;
+    checkpoints.push_back(checkpoint);
+}
+
+Json::Checkpoint const * Json::nearestCheckpoint (char const * arrayPath, size_t arrayPathLength, size_t element)
+{
+    ArrayCheckpoints * array = findArray(arrayPath,arrayPathLength);
+    if (0 == array || array->checkpoints.empty()) return 0;
+    size_t index = element / array->stride;
+    if (index >= array->checkpoints.size()) index = array->checkpoints.size() - 1;
+    return &array->checkpoints[index];
+}
+
+bool Json::growValueBuffer (size_t needed)
+{
+    size_t size = 2 * provider.buffersize;
+    if (size < needed) size = needed;
+    // Values too long even for the biggest buffer are truncated to fit it.
+    if (size > MAX_REASSEMBLYSIZE) size = MAX_REASSEMBLYSIZE;
+    if (size <= provider.buffersize) return false;
+    std::vector<uint8_t> bigger(size);
+    memcpy(&bigger[0],provider.buffer,provider.buffersize);
+    reassemblyBuffer.swap(bigger);
+    provider.buffer = &reassemblyBuffer[0];
+    provider.buffersize = reassemblyBuffer.size();
+    return needed <= size;
 }
 
 bool Json::provideMoreInput ()
@@ -157,7 +928,9 @@ bool Json::provideMoreInput ()
 #   if defined(DEBUG)
     std::cout << "(more input needed)" << std::endl;
 #   endif
-    if (nextChunkIndex >= byteBuffer.chunks())
+    uint8_t const * chunk;
+    size_t chunkBytes;
+    if (! readChunk(byteBuffer,nextChunkIndex,&chunk,&chunkBytes))
     {
 #      if defined(DEBUG)
         std::cout << "(no more input)" << std::endl;
@@ -165,9 +938,9 @@ bool Json::provideMoreInput ()
         return false;
     }
 #   if defined(DEBUG)
-    std::cout << std::string((char const *)byteBuffer.chunk(nextChunkIndex),byteBuffer.chunkBytes(nextChunkIndex)) << std::endl;
+    std::cout << std::string((char const *)chunk,chunkBytes) << std::endl;
 #   endif
-    ProvideJSONInput(&parser,byteBuffer.chunk(nextChunkIndex),byteBuffer.chunkBytes(nextChunkIndex));
+    ProvideJSONInput(&parser,chunk,chunkBytes);
     ++nextChunkIndex;
     return true;
 }
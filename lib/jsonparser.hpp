@@ -3,12 +3,39 @@
 #if !defined(__com_openmono_jsonparser_h)
 #define __com_openmono_jsonparser_h
 
+#include "arena.hpp"
+#include "byteview.hpp"
+#include "decimal.hpp"
+#include "extraction.hpp"
 #include "ibytebuffer.hpp"
+#include "jsonpath.hpp"
+#include "jsonvisitor.hpp"
 #include "SmallJSONParser.h"
+#include "tape.hpp"
 #include "weather.hpp"
+#include <vector>
+
+#define DEFAULT_MAX_CHECKPOINTS 16
+#define DEFAULT_CACHE_ENTRIES 16
+#define DEFAULT_CACHE_BYTES 0x800
 
 namespace json {
 
+/**
+ * Receives the values matching a path with wildcards.
+ */
+struct IProjectionVisitor
+{
+    virtual ~IProjectionVisitor () {};
+
+    /**
+     * Called for every value matching the path, in document order.
+     * @param index element index of the innermost wildcard.
+     * @param token the value, which is not unescaped and only valid during the call.
+     */
+    virtual void value (size_t index, JSONToken const & token) = 0;
+};
+
 /**
  * Json lets you look up values in a JSON document by using traditional paths
  * strings.
@@ -21,37 +48,293 @@ namespace json {
  *      lookup("/list/4/humidity") == "56"
  *
  * Arrays are indexed from 0.
+ * Paths that are used repeatedly can be compiled once into a JsonPath, which
+ * can also have a placeholder for an array index.
  * Json must be provided as a stream of data in form of a ByteBuffer.
+ *
+ * Values found are copied into an Arena, either owned by Json and freed with
+ * it, or supplied by the caller so that the values can outlive Json.
+ *
+ * Every lookup restarts parsing from the beginning of the document, so when
+ * several values are needed, register them in an Extraction and call extract
+ * to get them all in one pass.
+ *
+ * While skipping array elements, Json records checkpoints that let later
+ * lookups into the same array resume at the nearest element instead of
+ * reparsing everything before it.  At most maxCheckpoints are kept per array;
+ * when they run out, every other checkpoint is dropped and only elements at
+ * twice the previous distance are recorded from then on.  Checkpoints are
+ * dropped whenever the generation of the buffer changes.
+ *
+ * A series of values from every element of an array, such as the
+ * temperature of every forecast in "/list", can be projected in one pass
+ * with a path that has a * wildcard for the array index.
+ *
+ * When many lookups are needed in random order, buildIndex parses the
+ * document once into a Tape, which later lookups walk instead.
+ *
+ * When the same paths are looked up again and again in a document that
+ * rarely changes, enableCache remembers the value found for each path, so
+ * that repeated lookups do not parse at all until the buffer changes.
+ *
+ * Consumers that need to see the whole document can visit it, which calls
+ * an IJsonVisitor for every part of it in one pass and in constant memory.
+ *
+ * Json reads chunks through the IByteBuffer interface.  BufferJson does the
+ * same for a concrete buffer type without virtual calls.
  */
 class Json
 {
 public:
-    Json (IByteBuffer const & byteBuffer);
+    /**
+     * Function that reads one chunk of a buffer.
+     * @param  buffer the buffer.
+     * @param  index  chunk index.
+     * @param  chunk  where to store a pointer to the contents of the chunk.
+     * @param  length where to store the number of bytes in the chunk.
+     * @return        false if there is no such chunk.
+     */
+    typedef bool (* ChunkReader) (IByteBuffer const & buffer, size_t index, uint8_t const ** chunk, size_t * length);
+    /**
+     * @param byteBuffer     the JSON document.
+     * @param maxCheckpoints maximum number of checkpoints per array, or 0 to disable checkpoints.
+     */
+    Json (IByteBuffer const & byteBuffer, size_t maxCheckpoints = DEFAULT_MAX_CHECKPOINTS);
+    /**
+     * @param byteBuffer     the JSON document.
+     * @param results        arena to store values in, expected to live as long as Json.
+     * @param maxCheckpoints maximum number of checkpoints per array, or 0 to disable checkpoints.
+     */
+    Json (IByteBuffer const & byteBuffer, Arena & results, size_t maxCheckpoints = DEFAULT_MAX_CHECKPOINTS);
     ~Json ();
+    /**
+     * @return the arena that values are stored in.
+     */
+    Arena & results ();
+    /**
+     * Remember the values found by lookup, lookupView and the number lookups
+     * until the generation of the buffer changes.  Values found through the
+     * cache are stored in it rather than in the results arena, and stay valid
+     * until the buffer changes or the cache is full, when it starts over.
+     * The cache is not used once buildIndex has succeeded.
+     * @param entries number of paths to remember, rounded up to a power of two.
+     * @param bytes   memory for the paths and values that are remembered.
+     */
+    void enableCache (size_t entries = DEFAULT_CACHE_ENTRIES, size_t bytes = DEFAULT_CACHE_BYTES);
     /**
      * Extract a value from the JSON document.
      * @param  path  rooted path to the JSON element.
-     * @return       pointer to the value as string (possibly in temporary storage), or 0 if not found or not a simple value.
+     * @return       pointer to the value as string in the results arena, or 0 if not found, not a simple value or out of memory.
      */
     uint8_t const * lookup (char const * path);
+    /**
+     * @param  index array index for a placeholder in the path.
+     * @see lookup
+     */
+    uint8_t const * lookup (JsonPath const & path, size_t index = 0);
+    /**
+     * Extract a value from the JSON document without copying it, if it lies
+     * within one chunk of a buffer with stable chunks and has no escapes.
+     * Otherwise the value is stored in the results arena, as for lookup.
+     * @param  path  rooted path to the JSON element.
+     * @return       view of the value, which is not null-terminated, or a null view if not found, not a simple value or out of memory.
+     */
+    ByteView lookupView (char const * path);
+    ByteView lookupView (JsonPath const & path, size_t index = 0);
+    /**
+     * Extract a number from the JSON document without storing it as a string.
+     * @param  path  rooted path to the JSON element.
+     * @param  value where to store the number.
+     * @return       false if not found, not a number, or if the number does not fit.
+     */
+    bool lookupInt (char const * path, int & value);
+    bool lookupInt (JsonPath const & path, int & value, size_t index = 0);
+    /**
+     * Extract a number from the JSON document as a fixed-point value.
+     * @param  path     rooted path to the JSON element.
+     * @param  decimals number of decimals to keep, eg. 2 for hundredths.
+     * @param  value    where to store the number times 10^decimals.
+     * @return          false if not found, not a number, or if the scaled number does not fit.
+     * @see Decimal::toFixed
+     */
+    bool lookupFixedPoint (char const * path, unsigned decimals, int32_t & value);
+    bool lookupFixedPoint (JsonPath const & path, unsigned decimals, int32_t & value, size_t index = 0);
+#if defined(DECIMAL_DOUBLE)
+    /**
+     * Extract a number from the JSON document as a floating-point value.
+     * Only available on hosts, see Decimal::toDouble.
+     * @see lookupInt
+     */
+    bool lookupDouble (char const * path, double & value);
+    bool lookupDouble (JsonPath const & path, double & value, size_t index = 0);
+#endif
     /**
      * Calculate the size of a JSON array element.
      * @param  path rooted path to the JSON element.
      * @return      size of array, or 0.
      */
     size_t lookupArraySize (char const * path);
+    size_t lookupArraySize (JsonPath const & path, size_t index = 0);
+    /**
+     * Extract several values from the JSON document in one pass.  Parsing
+     * stops as soon as all the requested values have been found.
+     * @param  extraction paths to look up and where to store their values.
+     * @return            false if the document could not be parsed or the results arena ran out of memory.
+     */
+    bool extract (Extraction & extraction);
+    /**
+     * Visit every value matching a path in one pass.  Wildcards in the path
+     * match every element of an array.
+     * @param  path    rooted path with wildcards.
+     * @param  visitor receives the values.
+     * @return         false if the document could not be parsed.
+     */
+    bool project (JsonPath const & path, IProjectionVisitor & visitor);
+    /**
+     * Store every value matching a path in a column, at the element index of
+     * the innermost wildcard.  Rows without a value are set to 0.
+     * @param  path   rooted path with wildcards.
+     * @param  column where to store the values as strings in the results arena.
+     * @param  rows   size of column.
+     * @return        number of rows up to and including the last value stored, or 0 if the document could not be parsed.
+     */
+    size_t project (JsonPath const & path, uint8_t const ** column, size_t rows);
+    /**
+     * Visit the whole JSON document in one pass, without storing anything.
+     * Strings longer than MAX_REASSEMBLYSIZE are truncated.
+     * @param  visitor receives every key, value, object and array.
+     * @return         false if the document could not be parsed or nests deeper than MAX_VISIT_DEPTH.
+     */
+    bool visit (IJsonVisitor & visitor);
+    /**
+     * Index the structure of the JSON document in one pass, so that lookup
+     * and lookupArraySize can skip over values without parsing them again.
+     * @return false if the document could not be parsed, in which case lookups parse the document.
+     */
+    bool buildIndex ();
+    /**
+     * Values that are split between chunks of the buffer are copied together
+     * before they are returned.
+     * @return number of bytes copied for that since Json was created.
+     */
+    size_t reassembledBytes () const;
+protected:
+    /**
+     * @param readChunk reads chunks of byteBuffer.
+     * @see Json
+     */
+    Json (IByteBuffer const & byteBuffer, ChunkReader readChunk, size_t maxCheckpoints);
+    Json (IByteBuffer const & byteBuffer, Arena & results, ChunkReader readChunk, size_t maxCheckpoints);
 private:
     #define MAX_KEYSIZE 64
+    #define MAX_REASSEMBLYSIZE 0x400
+    #define MAX_PATHSIZE 128
+    #define MAX_CHECKPOINTED_ARRAYS 4
+    /**
+     * Parser position just before an array element.  The provider buffer
+     * is only used while reassembling a single token, so it needs no saving.
+     */
+    struct Checkpoint
+    {
+        size_t element;
+        size_t nextChunkIndex;
+        size_t remainingBytes;
+        int state;
+        int partialTokenType;
+    };
+    struct ArrayCheckpoints
+    {
+        std::vector<char> path;
+        size_t stride;
+        std::vector<Checkpoint> checkpoints;
+    };
+    /**
+     * Value found for a path and placeholder index.
+     */
+    struct CachedValue
+    {
+        bool isSet;
+        uint32_t hash;
+        char const * path;
+        size_t pathLength;
+        size_t index;
+        int type;
+        // 0 if not found or not a simple value.
+        uint8_t const * value;
+        size_t length;
+    };
     uint8_t valueBuffer[MAX_KEYSIZE];
     IByteBuffer const & byteBuffer;
+    ChunkReader readChunk;
     size_t nextChunkIndex;
     JSONParser parser;
     JSONProvider provider;
+    size_t maxCheckpoints;
+    std::vector<ArrayCheckpoints> arrays;
+    Tape * tape;
+    std::vector<uint8_t> reassemblyBuffer;
+    size_t reassembled;
+    Arena ownResults;
+    Arena & resultArena;
+    uint32_t generation;
+    std::vector<CachedValue> cache;
+    Arena cachedValues;
+    size_t maxCachedBytes;
+    void sync ();
+    void clearCache ();
+    CachedValue const * lookupCached (JsonPath const & path, size_t index);
     void restart ();
+    bool isInDocument (JSONToken const & token) const;
+    bool lookupNumber (JsonPath const & path, size_t index, JSONToken & token);
+    void resume (Checkpoint const & checkpoint);
+    void passElement (char const * arrayPath, size_t arrayPathLength, size_t element);
+    ArrayCheckpoints * findArray (char const * arrayPath, size_t arrayPathLength);
+    Checkpoint const * nearestCheckpoint (char const * arrayPath, size_t arrayPathLength, size_t element);
     friend struct Searcher;
+    friend struct Extractor;
+    friend struct Projector;
 public:
-    // Only for use by global callback C function.
+    // Only for use by global callback C functions.
     bool provideMoreInput ();
+    bool growValueBuffer (size_t needed);
+};
+
+/**
+ * Json for a buffer of a known type, which calls the methods of the buffer
+ * directly, so that compilers can inline reading chunks.  The rest of the
+ * reader is shared with Json rather than compiled again for every type.
+ *
+ * Examples:
+ *
+ *      HeapByteBuffer buffer;
+ *      BufferJson<HeapByteBuffer> json(buffer);
+ *      json.lookup("/city/name");
+ */
+template <class Buffer>
+class BufferJson
+:
+    public Json
+{
+public:
+    BufferJson (Buffer const & byteBuffer, size_t maxCheckpoints = DEFAULT_MAX_CHECKPOINTS)
+    :
+        Json(byteBuffer,&readBufferChunk,maxCheckpoints)
+    {
+    }
+    BufferJson (Buffer const & byteBuffer, Arena & results, size_t maxCheckpoints = DEFAULT_MAX_CHECKPOINTS)
+    :
+        Json(byteBuffer,results,&readBufferChunk,maxCheckpoints)
+    {
+    }
+private:
+    static bool readBufferChunk (IByteBuffer const & buffer, size_t index, uint8_t const ** chunk, size_t * length)
+    {
+        Buffer const & concrete = static_cast<Buffer const &>(buffer);
+        if (index >= concrete.Buffer::chunks()) return false;
+        *chunk = concrete.Buffer::chunk(index);
+        *length = concrete.Buffer::chunkBytes(index);
+        return true;
+    }
 };
 
 } // json
@@ -0,0 +1,118 @@
+// This software is part of OpenMono, see http://developer.openmono.com
+// Released under the MIT license, see LICENSE.txt
+#include "jsonpath.hpp"
+#include <string.h>
+
+namespace json {
+
+JsonPath::JsonPath (char const * path_)
+:
+    path(path_),
+    pathLength(strlen(path_))
+{
+    compile();
+}
+
+JsonPath::JsonPath (char const * path_, size_t length_)
+:
+    path(path_),
+    pathLength(length_)
+{
+    compile();
+}
+
+void JsonPath::compile ()
+{
+    segmentCount = 0;
+    firstPlaceholder = MAX_PATHSEGMENTS;
+    wildcard = false;
+    valid = (pathLength <= 0xffff);
+    size_t position = 0;
+    while (valid && position < pathLength)
+    {
+        if (path[position] != '/' || segmentCount >= MAX_PATHSEGMENTS)
+        {
+            valid = false;
+            break;
+        }
+        Segment & segment = segmentStore[segmentCount];
+        segment.offset = ++position;
+        while (position < pathLength && path[position] != '/') ++position;
+        segment.length = position - segment.offset;
+        char const * text = path + segment.offset;
+        segment.hash = hash(text,segment.length);
+        segment.isPlaceholder = (1 == segment.length && JSON_PATH_PLACEHOLDER == text[0]);
+        segment.isWildcard = (1 == segment.length && JSON_PATH_WILDCARD == text[0]);
+        wildcard = wildcard || segment.isWildcard;
+        segment.isIndex = (segment.length > 0);
+        segment.index = 0;
+        for (size_t i = 0; i < segment.length && segment.isIndex; ++i)
+        {
+            if (text[i] < '0' || text[i] > '9') segment.isIndex = false;
+            else segment.index = segment.index * 10 + (text[i] - '0');
+        }
+        if (! segment.isIndex) segment.index = 0;
+        if (segment.isPlaceholder && firstPlaceholder == MAX_PATHSEGMENTS) firstPlaceholder = segmentCount;
+        ++segmentCount;
+    }
+}
+
+bool JsonPath::isValid () const
+{
+    return valid;
+}
+
+size_t JsonPath::segments () const
+{
+    return segmentCount;
+}
+
+JsonPath::Segment const & JsonPath::segment (size_t index) const
+{
+    return segmentStore[index];
+}
+
+char const * JsonPath::segmentText (size_t index) const
+{
+    return path + segmentStore[index].offset;
+}
+
+size_t JsonPath::prefixLength (size_t index) const
+{
+    if (index >= segmentCount) return pathLength;
+    return segmentStore[index].offset - 1;
+}
+
+bool JsonPath::hasPlaceholderBefore (size_t index) const
+{
+    return firstPlaceholder < index;
+}
+
+bool JsonPath::hasWildcard () const
+{
+    return wildcard;
+}
+
+char const * JsonPath::text () const
+{
+    return path;
+}
+
+size_t JsonPath::length () const
+{
+    return pathLength;
+}
+
+uint32_t JsonPath::hash (char const * text, size_t length)
+{
+    // FNV-1a
+    uint32_t value = 2166136261u;
+    for (size_t i = 0; i < length; ++i)
+    {
+        value ^= (uint8_t)text[i];
+        value *= 16777619u;
+    }
+    return value;
+}
+
+} // json
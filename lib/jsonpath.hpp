@@ -0,0 +1,96 @@
+// This software is part of OpenMono, see http://developer.openmono.com
+// Released under the MIT license, see LICENSE.txt
+#if !defined(__com_openmono_jsonpath_h)
+#define __com_openmono_jsonpath_h
+#include <stdint.h>
+#include <stddef.h>
+
+#define MAX_PATHSEGMENTS 12
+#define JSON_PATH_PLACEHOLDER '#'
+#define JSON_PATH_WILDCARD '*'
+
+/**
+ * Compile a string literal path, using its compile-time length.
+ */
+#define JSON_PATH(literal) json::JsonPath(literal,sizeof(literal)-1)
+
+namespace json {
+
+/**
+ * JsonPath is a path split into segments once, so that lookups do not have
+ * to split it again.
+ *
+ * Examples:
+ *
+ *      static JsonPath const name = JSON_PATH("/city/name");
+ *      static JsonPath const temperature = JSON_PATH("/list/#/main/temp");
+ *      lookup(temperature,4) == lookup("/list/4/main/temp")
+ *
+ * A segment consisting of only # is a placeholder for an array index given
+ * when looking up the path.  A segment consisting of only * is a wildcard
+ * matching every element of an array, which only Json::project accepts.
+ */
+class JsonPath
+{
+public:
+    struct Segment
+    {
+        uint16_t offset;
+        uint16_t length;
+        uint32_t hash;
+        uint32_t index;
+        bool isIndex;
+        bool isPlaceholder;
+        bool isWildcard;
+    };
+    /**
+     * @param path rooted path, expected to live as long as JsonPath.
+     */
+    explicit JsonPath (char const * path);
+    /**
+     * @param path   rooted path, expected to live as long as JsonPath.
+     * @param length length of path.
+     */
+    JsonPath (char const * path, size_t length);
+    /**
+     * @return false if the path is not rooted or has too many segments.
+     */
+    bool isValid () const;
+    size_t segments () const;
+    Segment const & segment (size_t index) const;
+    /**
+     * @return the characters of a segment, which are not zero terminated.
+     */
+    char const * segmentText (size_t index) const;
+    /**
+     * @return the length of the path up to the slash in front of a segment.
+     */
+    size_t prefixLength (size_t index) const;
+    /**
+     * @return true if a placeholder comes before a segment.
+     */
+    bool hasPlaceholderBefore (size_t index) const;
+    /**
+     * @return true if any segment is a wildcard.
+     */
+    bool hasWildcard () const;
+    char const * text () const;
+    size_t length () const;
+    /**
+     * Hash function used for segments.
+     */
+    static uint32_t hash (char const * text, size_t length);
+private:
+    char const * path;
+    size_t pathLength;
+    size_t segmentCount;
+    size_t firstPlaceholder;
+    bool wildcard;
+    bool valid;
+    Segment segmentStore[MAX_PATHSEGMENTS];
+    void compile ();
+};
+
+} // json
+
+#endif // __com_openmono_jsonpath_h
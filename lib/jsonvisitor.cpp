@@ -0,0 +1,104 @@
+// This software is part of OpenMono, see http://developer.openmono.com
+// Released under the MIT license, see LICENSE.txt
+#include "jsonvisitor.hpp"
+
+namespace json {
+
+JsonWalker::JsonWalker (IJsonVisitor & visitor_)
+:
+    visitor(visitor_)
+{
+    restart();
+}
+
+void JsonWalker::restart ()
+{
+    depth = 0;
+    state = Walking;
+}
+
+JsonWalker::Status JsonWalker::token (JSONToken const & token)
+{
+    if (state != Walking) return state;
+    int type = JSONTokenType(token);
+    Level * level = depth > 0 ? &levels[depth-1] : 0;
+    if (level != 0 && ! level->array && level->expectKey)
+    {
+        if (type == StringJSONToken)
+        {
+            visitor.key(token,depth);
+            level->expectKey = false;
+            return state;
+        }
+        if (type != EndObjectJSONToken) return state = Failed;
+        close(false);
+    }
+    else if (type == StartObjectJSONToken || type == StartArrayJSONToken)
+    {
+        if (! open(type == StartArrayJSONToken)) state = Failed;
+        return state;
+    }
+    else if (type == EndArrayJSONToken && level != 0 && level->array)
+        close(true);
+    else if
+    (
+        type == StringJSONToken || type == NumberJSONToken || type == TrueJSONToken ||
+        type == FalseJSONToken || type == NullJSONToken
+    ) {
+        visitor.value(token,context());
+        next();
+    }
+    else return state = Failed;
+    if (depth == 0) state = Done;
+    return state;
+}
+
+JsonWalker::Status JsonWalker::status () const
+{
+    return state;
+}
+
+/**
+ * @return the context of the value about to be visited at the current depth.
+ */
+JsonContext JsonWalker::context () const
+{
+    JsonContext result;
+    result.depth = depth;
+    result.inArray = depth > 0 && levels[depth-1].array;
+    result.index = result.inArray ? levels[depth-1].index : 0;
+    return result;
+}
+
+bool JsonWalker::open (bool array)
+{
+    if (depth == MAX_VISIT_DEPTH) return false;
+    if (array) visitor.startArray(context());
+    else visitor.startObject(context());
+    Level & level = levels[depth++];
+    level.array = array;
+    level.expectKey = ! array;
+    level.index = 0;
+    return true;
+}
+
+void JsonWalker::close (bool array)
+{
+    --depth;
+    if (array) visitor.endArray(context());
+    else visitor.endObject(context());
+    next();
+}
+
+/**
+ * Move on to the next value at the current depth.
+ */
+void JsonWalker::next ()
+{
+    if (depth == 0) return;
+    Level & level = levels[depth-1];
+    if (level.array) ++level.index;
+    else level.expectKey = true;
+}
+
+} // json
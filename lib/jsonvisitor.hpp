@@ -0,0 +1,105 @@
+// This software is part of OpenMono, see http://developer.openmono.com
+// Released under the MIT license, see LICENSE.txt
+#if !defined(__com_openmono_jsonvisitor_h)
+#define __com_openmono_jsonvisitor_h
+#include "SmallJSONParser.h"
+#include <stddef.h>
+
+#define MAX_VISIT_DEPTH 32
+
+namespace json {
+
+/**
+ * Where a value is in the JSON document.
+ */
+struct JsonContext
+{
+    /**
+     * Nesting level of the value, 0 for the root value.
+     */
+    size_t depth;
+    /**
+     * True if the value is an element of an array.
+     */
+    bool inArray;
+    /**
+     * Index of the value in its array, or 0 if not in an array.
+     */
+    size_t index;
+};
+
+/**
+ * Receives every part of a JSON document in document order from Json::visit.
+ * Tokens are not unescaped, and are only valid during the call.
+ *
+ * Examples:
+ *
+ *      {"a":[1,2]} gives
+ *      startObject(0), key("a",1), startArray(1), value(1,1,0), value(2,1,1),
+ *      endArray(1), endObject(0)
+ */
+struct IJsonVisitor
+{
+    virtual ~IJsonVisitor () {};
+    virtual void startObject (JsonContext const &) {};
+    virtual void endObject (JsonContext const &) {};
+    virtual void startArray (JsonContext const &) {};
+    virtual void endArray (JsonContext const &) {};
+    /**
+     * Called before the value of each key of an object, with the key and
+     * the nesting level of the value.
+     */
+    virtual void key (JSONToken const &, size_t) {};
+    /**
+     * Called for strings, numbers, booleans and nulls.
+     */
+    virtual void value (JSONToken const &, JsonContext const &) {};
+};
+
+/**
+ * JsonWalker turns a stream of tokens into IJsonVisitor calls, one token at
+ * a time, so that it can be fed by a pull loop or by chunks pushed to it.
+ * Open objects and arrays are kept on a fixed stack of MAX_VISIT_DEPTH
+ * levels, and nothing is allocated.
+ */
+class JsonWalker
+{
+public:
+    enum Status
+    {
+        Walking,
+        Done,
+        Failed
+    };
+    JsonWalker (IJsonVisitor & visitor);
+    /**
+     * Start walking a new document.
+     */
+    void restart ();
+    /**
+     * @param  token next complete token of the document.
+     * @return       Done after the token that ends the root value, Failed
+     *               if the document is broken or nests too deep.
+     */
+    Status token (JSONToken const & token);
+    Status status () const;
+private:
+    struct Level
+    {
+        bool array;
+        bool expectKey;
+        size_t index;
+    };
+    IJsonVisitor & visitor;
+    Level levels[MAX_VISIT_DEPTH];
+    size_t depth;
+    Status state;
+    JsonContext context () const;
+    bool open (bool array);
+    void close (bool array);
+    void next ();
+};
+
+} // json
+
+#endif // __com_openmono_jsonvisitor_h
@@ -0,0 +1,174 @@
+// This software is part of OpenMono, see http://developer.openmono.com
+// Released under the MIT license, see LICENSE.txt
+#include "openweathermap.hpp"
+#include "decimal.hpp"
+#include <string.h>
+
+namespace {
+
+using namespace weather;
+
+/**
+ * Slot of an icon code in iconConditions.  The numbers of the codes are
+ * all different modulo 17, so no two codes share a slot.
+ */
+#define ICON_SLOT(tens,ones,night) ((((tens) * 10 + (ones)) % 17) * 2 + (night))
+#define ICON_SLOTS 34
+
+/**
+ * Condition of the icon code in each slot, or Unknown for unused slots.
+ */
+Condition const iconConditions[ICON_SLOTS] =
+{
+    Unknown, Unknown,
+    Day_ClearSky, Night_ClearSky,                   // 01
+    Day_FewClouds, Night_FewClouds,                 // 02
+    Day_ScatteredClouds, Night_ScatteredClouds,     // 03
+    Day_Overcast, Night_Overcast,                   // 04
+    Unknown, Unknown, Unknown, Unknown, Unknown, Unknown, Unknown, Unknown,
+    Day_ShowerRain, Night_ShowerRain,               // 09
+    Day_Rain, Night_Rain,                           // 10
+    Day_Thunder, Night_Thunder,                     // 11
+    Unknown, Unknown,
+    Day_Snow, Night_Snow,                           // 13
+    Unknown, Unknown, Unknown, Unknown,
+    Day_Mist, Night_Mist,                           // 50
+};
+
+/**
+ * @return a number in fixed point with some decimals, or 0 if it is missing or does not fit.
+ */
+uint32_t fixedOrZero (uint8_t const * text, unsigned decimals, uint32_t max)
+{
+    uint32_t value = 0;
+    if (0 == text || ! Decimal::toFixed(text,decimals,&value)) return 0;
+    return value > max ? 0 : value;
+}
+
+} // namespace {
+
+namespace openweathermap {
+
+Condition translateIcon (uint8_t const * icon)
+{
+    if (0 == icon) return Unknown;
+    unsigned tens = icon[0] - '0';
+    if (tens > 9) return Unknown;
+    unsigned ones = icon[1] - '0';
+    if (ones > 9 || (icon[2] != 'd' && icon[2] != 'n')) return Unknown;
+    Condition condition = iconConditions[ICON_SLOT(tens,ones,icon[2] == 'n' ? 1 : 0)];
+    if (memcmp(conditionIcons[condition],icon,4) != 0) return Unknown;
+    return condition;
+}
+
+Entry toEntry (EntryText const & text)
+{
+    Entry entry;
+    entry.timeUnix = fixedOrZero(text.timeUnix,0,0xffffffff);
+    entry.city = cityId(text.city);
+    entry.temperatureCentiK = fixedOrZero(text.temperatureK,2,0xffff);
+    entry.pressureDeciHpa = fixedOrZero(text.pressureHpa,1,0xffff);
+    entry.windSpeedCentiMs = fixedOrZero(text.windSpeedMs,2,0xffff);
+    entry.windDirectionDeciDegrees = fixedOrZero(text.windDirection,1,0xffff);
+    entry.rainCentiMm = fixedOrZero(text.rainNode,2,0xffff);
+    entry.cloudPercentage = fixedOrZero(text.cloudPercentage,0,100);
+    entry.humidity = fixedOrZero(text.humidity,0,100);
+    entry.condition = translateIcon(text.icon);
+    entry.hasRain = (text.rainNode != 0);
+    return entry;
+}
+
+Entry parseCurrent (IByteBuffer const & buffer, Arena & results)
+{
+    Json json (buffer,results);
+    EntryText entry = EntryText();
+    Extraction extraction;
+    extraction.add("/name",&entry.city);
+    extraction.add("/main/temp",&entry.temperatureK);
+    extraction.add("/clouds/all",&entry.cloudPercentage);
+    extraction.add("/main/humidity",&entry.humidity);
+    extraction.add("/main/pressure",&entry.pressureHpa);
+    extraction.add("/wind/speed",&entry.windSpeedMs);
+    extraction.add("/wind/deg",&entry.windDirection);
+    extraction.add("/dt",&entry.timeUnix);
+    extraction.add("/weather/0/icon",&entry.icon);
+    extraction.add("/rain/3h",&entry.rainNode);
+    json.extract(extraction);
+    return toEntry(entry);
+}
+
+std::vector<Entry> parseForecast (Json & json, size_t entries)
+{
+    return decodeForecast(json,entries);
+}
+
+std::vector<Entry> parseForecast (cbor::Cbor & cbor, size_t entries)
+{
+    return decodeForecast(cbor,entries);
+}
+
+std::vector<Entry> parseForecast (IByteBuffer const & buffer, size_t entries, Arena & results)
+{
+    if (cbor::Cbor::isCbor(buffer))
+    {
+        cbor::Cbor document (buffer,results);
+        return parseForecast(document,entries);
+    }
+    Json json (buffer,results);
+    return parseForecast(json,entries);
+}
+
+bool parseForecast (IByteBuffer const & buffer, size_t entries, Arena & results, ForecastSeries & series)
+{
+    Arena::Scope scope (results);
+    if (cbor::Cbor::isCbor(buffer))
+    {
+        cbor::Cbor document (buffer,results);
+        return decodeForecast(document,entries,series);
+    }
+    Json json (buffer,results);
+    return decodeForecast(json,entries,series);
+}
+
+ParallelForecast::ParallelForecast (size_t threads_)
+:
+    threads(threads_)
+{
+}
+
+ParallelForecast::~ParallelForecast ()
+{
+    for (size_t i = 0; i < parts.size(); ++i) delete parts[i].results;
+}
+
+bool ParallelForecast::parse (uint8_t const * text, size_t length, std::vector<Entry> & entries)
+{
+    entries.clear();
+    ParallelArray array (text,length,threads);
+    if (! array.split("/list")) return false;
+    while (parts.size() < array.parts())
+    {
+        Part part = { new Arena(), std::vector<Entry>(), false };
+        parts.push_back(part);
+    }
+    for (size_t i = 0; i < parts.size(); ++i) parts[i].results->reset();
+    array.run(*this);
+    for (size_t i = 0; i < array.parts(); ++i)
+    {
+        if (! parts[i].ok) return false;
+        entries.insert(entries.end(),parts[i].entries.begin(),parts[i].entries.end());
+    }
+    return true;
+}
+
+void ParallelForecast::part (size_t index, size_t, IByteBuffer const & document)
+{
+    Part & part = parts[index];
+    Json json (document,*part.results);
+    ForecastDecoder decoder (~size_t(0),*part.results);
+    part.ok = json.visit(decoder);
+    decoder.finish();
+    part.entries = decoder.forecast();
+}
+
+} // openweathermap
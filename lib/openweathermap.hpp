@@ -2,8 +2,12 @@
 // Released under the MIT license, see LICENSE.txt
 #if !defined(__com_openmono_openweathermap_h)
 #define __com_openmono_openweathermap_h
+#include "cbor.hpp"
+#include "forecastseries.hpp"
 #include "ibytebuffer.hpp"
 #include "jsonparser.hpp"
+#include "parallelarray.hpp"
+#include "schemadecoder.hpp"
 #include "weather.hpp"
 #include <vector>
 
@@ -12,96 +16,285 @@ namespace openweathermap {
 using namespace weather;
 using namespace json;
 
-Condition translateIcon (uint8_t const * icon)
+/**
+ * Icon code of each condition, see http://openweathermap.org/weather-conditions
+ */
+char const conditionIcons[Unknown+1][4] =
 {
-    char const * iconTable[] =
+    "01d","02d","03d","04d","10d","09d","11d","13d","50d",
+    "01n","02n","03n","04n","10n","09n","11n","13n","50n",
+    ""
+};
+
+/**
+ * Translate an icon code in constant time: the code is hashed to its slot,
+ * and the code of the condition found there is compared with it.
+ */
+Condition translateIcon (uint8_t const * icon);
+
+/**
+ * The values of an entry as strings, as they are in the document.
+ */
+struct EntryText
+{
+    uint8_t const * city;
+    uint8_t const * temperatureK;
+    uint8_t const * cloudPercentage;
+    uint8_t const * windSpeedMs;
+    uint8_t const * windDirection;
+    uint8_t const * humidity;
+    uint8_t const * pressureHpa;
+    uint8_t const * timeUnix;
+    uint8_t const * icon;
+    uint8_t const * rainNode;
+};
+
+/**
+ * Convert the strings of an entry to fixed point.
+ */
+Entry toEntry (EntryText const & text);
+
+/**
+ * @param results arena to store the strings of the entry in while it is parsed.
+ */
+Entry parseCurrent (IByteBuffer const & buffer, Arena & results);
+
+/**
+ * Receives forecast entries as ForecastDecoder completes them.
+ */
+struct IForecastHandler
+{
+    virtual ~IForecastHandler () {};
+    /**
+     * @param index position of the entry in the forecast.
+     * @param entry the entry, with the city if it came before the list.
+     */
+    virtual void entry (size_t index, Entry const & entry) = 0;
+};
+
+/**
+ * Where the values of a forecast go, see http://openweathermap.org/forecast5
+ */
+SchemaField<EntryText> const forecastElementFields[] =
+{
+    { { "dt" }, &EntryText::timeUnix },
+    { { "main", "temp" }, &EntryText::temperatureK },
+    { { "main", "humidity" }, &EntryText::humidity },
+    { { "main", "pressure" }, &EntryText::pressureHpa },
+    { { "clouds", "all" }, &EntryText::cloudPercentage },
+    { { "wind", "speed" }, &EntryText::windSpeedMs },
+    { { "wind", "deg" }, &EntryText::windDirection },
+    { { "weather", "0", "icon" }, &EntryText::icon },
+    { { "rain", "3h" }, &EntryText::rainNode },
+};
+
+SchemaField<EntryText> const forecastDocumentFields[] =
+{
+    { { "city", "name" }, &EntryText::city },
+};
+
+Schema<EntryText> const forecastSchema =
+{
+    { "list" }, SCHEMA_FIELDS(forecastElementFields), SCHEMA_FIELDS(forecastDocumentFields)
+};
+
+/**
+ * ForecastDecoder picks forecast entries out of a document as it is being
+ * visited, so that it can decode a forecast that is still being received
+ * through a PushParser, as well as one visited by Json::visit.  Entries are
+ * complete as soon as the end of their element in "/list" has been seen.
+ *
+ * The strings of an entry are freed from the results arena once it has been
+ * converted, so only the city stays there, and the arena needs room for one
+ * entry whatever the number of entries.
+ */
+class ForecastDecoder
+:
+    public SchemaDecoder<EntryText>
+{
+public:
+    /**
+     * @param entries maximum number of entries to decode.
+     * @param results arena to store the strings in while they are decoded.
+     * @param handler optional receiver of each entry when it is complete.
+     */
+    ForecastDecoder (size_t entries, Arena & results_, IForecastHandler * handler_ = 0)
+    :
+        SchemaDecoder<EntryText>(forecastSchema,results_),
+        results(results_),
+        maxEntries(entries),
+        handler(handler_),
+        series(0)
     {
-        // See http://openweathermap.org/weather-conditions
-        "01d","02d","03d","04d","10d","09d","11d","13d","50d",
-        "01n","02n","03n","04n","10n","09n","11n","13n","50n",
-        0
-    };
-    for (size_t i = 0; iconTable[i] != 0; ++i)
+    }
+    /**
+     * Decode the entries straight into a series instead of keeping them.
+     * @param entries maximum number of entries to decode.
+     * @param results arena to store the strings in while they are decoded.
+     * @param series  where to append the entries.
+     */
+    ForecastDecoder (size_t entries, Arena & results_, ForecastSeries & series_)
+    :
+        SchemaDecoder<EntryText>(forecastSchema,results_),
+        results(results_),
+        maxEntries(entries),
+        handler(0),
+        series(&series_)
+    {
+    }
+    /**
+     * Forget the entries decoded, but not the city in the results arena.
+     */
+    void restart ()
+    {
+        SchemaDecoder<EntryText>::restart();
+        entries.clear();
+    }
+    /**
+     * @return the entries decoded so far.
+     */
+    std::vector<Entry> const & forecast () const
+    {
+        return entries;
+    }
+    /**
+     * Give the entries decoded the city once the whole document has been
+     * visited, since the city may come after the list in the document.
+     */
+    void finish ()
+    {
+        uint32_t id = cityId(city());
+        if (series != 0) series->setCity(id);
+        for (size_t i = 0; i < entries.size(); ++i) entries[i].city = id;
+    }
+    /**
+     * @return the city, or "" if it has not been seen yet.
+     */
+    uint8_t const * city () const
+    {
+        return document().city != 0 ? document().city : (uint8_t const *)"";
+    }
+protected:
+    virtual bool startRecord (size_t index)
     {
-        if (strcmp((char const *)icon,iconTable[i]) == 0)
-            return Condition(i);
+        recordStart = results.mark();
+        return index < maxEntries;
     }
-    return Unknown;
+    virtual void endRecord (size_t index, EntryText const & record)
+    {
+        Entry entry = toEntry(record);
+        entry.city = cityId(city());
+        if (series != 0) series->add(entry);
+        else entries.push_back(entry);
+        if (handler != 0) handler->entry(index,entry);
+        // The city is outside the list, so it was stored before the record.
+        results.rewind(recordStart);
+    }
+private:
+    Arena & results;
+    Arena::Mark recordStart;
+    size_t maxEntries;
+    IForecastHandler * handler;
+    ForecastSeries * series;
+    std::vector<Entry> entries;
+};
+
+/**
+ * @param  document the forecast as Json or Cbor, with the arena to store the strings in while they are decoded.
+ * @return          the entries, or none if the document is broken.
+ */
+template <class Document>
+std::vector<Entry> decodeForecast (Document & document, size_t entries)
+{
+    ForecastDecoder decoder (entries,document.results());
+    if (! document.visit(decoder)) return std::vector<Entry>();
+    decoder.finish();
+    return decoder.forecast();
 }
 
-Entry parseCurrent (IByteBuffer const & buffer)
+/**
+ * @param json the forecast document, with the arena to store the strings in while they are decoded.
+ */
+std::vector<Entry> parseForecast (Json & json, size_t entries);
+
+/**
+ * @param cbor the forecast document in CBOR, with the arena to store the strings in while they are decoded.
+ */
+std::vector<Entry> parseForecast (cbor::Cbor & cbor, size_t entries);
+
+/**
+ * Parse a forecast in either JSON or CBOR.
+ * @param results arena to store the strings in while they are decoded.
+ */
+std::vector<Entry> parseForecast (IByteBuffer const & buffer, size_t entries, Arena & results);
+
+/**
+ * @param document the forecast as Json or Cbor, with the arena to store the strings in while they are decoded.
+ * @param series   where to append the entries.
+ */
+template <class Document>
+bool decodeForecast (Document & document, size_t entries, ForecastSeries & series)
 {
-    Json json (buffer);
-    Entry entry;
-    entry.city = json.lookup("/name");
-    entry.temperatureK = json.lookup("/main/temp");
-    entry.cloudPercentage = json.lookup("/clouds/all");
-    entry.humidity = json.lookup("/main/humidity");
-    entry.pressureHpa = json.lookup("/main/pressure");
-    entry.windSpeedMs = json.lookup("/wind/speed");
-    entry.windDirection = json.lookup("/wind/deg");
-    entry.timeUnix = json.lookup("/dt");
-    entry.condition = translateIcon(json.lookup("/weather/0/icon"));
-    uint8_t const * rainNode = json.lookup("/rain/3h");
-    if (0 == rainNode)
-        entry.rain = (uint8_t const *)"";
-    else
-        entry.rain = rainNode;
-    return entry;
+    ForecastDecoder decoder (entries,document.results(),series);
+    bool ok = document.visit(decoder);
+    decoder.finish();
+    return ok;
 }
 
-std::vector<Entry> parseForecast (IByteBuffer const & buffer, size_t entries)
+/**
+ * Parse a forecast in either JSON or CBOR into a series.
+ * @param results arena to store the strings in while they are decoded.
+ * @return        false if the forecast could not be parsed.
+ */
+bool parseForecast (IByteBuffer const & buffer, size_t entries, Arena & results, ForecastSeries & series);
+
+/**
+ * ParallelForecast parses a forecast with a very long list on several
+ * threads, for bulk exports processed on the host.  The list is split into
+ * one part per thread with ParallelArray, and each part is decoded with its
+ * own ForecastDecoder and arena.  Entries come out in document order
+ * whatever the number of threads.
+ *
+ * Each part is a whole document: everything before the list, its own range
+ * of elements, and everything after the list, where the city is.  So what
+ * is around the list is parsed once for every part, which costs little when
+ * the list is most of the forecast.  Every part decodes all of its
+ * elements, so there is no limit on the number of entries.
+ *
+ * Examples:
+ *
+ *      ParallelForecast parser (4);
+ *      std::vector<Entry> entries;
+ *      if (parser.parse(text,length,entries)) ...
+ */
+class ParallelForecast
+:
+    private IArrayPartHandler
 {
-    struct State
+public:
+    /**
+     * @param threads maximum number of threads to use.
+     */
+    ParallelForecast (size_t threads);
+    ~ParallelForecast ();
+    /**
+     * @param  text    the forecast, expected to stay unchanged during the call.
+     * @param  length  number of bytes in text.
+     * @param  entries where to store the entries.
+     * @return         false if the forecast could not be parsed.
+     */
+    bool parse (uint8_t const * text, size_t length, std::vector<Entry> & entries);
+private:
+    struct Part
     {
-        Json json;
-        State (IByteBuffer const & buffer)
-        :
-            json(buffer)
-        {
-            city = json.lookup("/city/name");
-            strcpy(path,"/list");
-        }
+        Arena * results;
         std::vector<Entry> entries;
-        char path[128];
-        char const * indexedPath (size_t index, char const * slug)
-        {
-            strcpy(path,"/list/");
-            char const * intSize = (sizeof(size_t)==sizeof(unsigned)) ? "%u" : "%lu";
-            size_t indexLength = sprintf(path+6,intSize,index);
-            strcpy(path+6+indexLength,slug);
-            return path;
-        }
-        uint8_t const * city;
-        Condition extractCondition (size_t index)
-        {
-            uint8_t const * icon = json.lookup(indexedPath(index,"/weather/0/icon"));
-            return translateIcon(icon);
-        }
-        void extractEntry (size_t index)
-        {
-            Entry entry;
-            entry.city = city;
-            entry.temperatureK = json.lookup(indexedPath(index,"/main/temp"));
-            entry.cloudPercentage = json.lookup(indexedPath(index,"/clouds/all"));
-            entry.humidity = json.lookup(indexedPath(index,"/main/humidity"));
-            entry.pressureHpa = json.lookup(indexedPath(index,"/main/pressure"));
-            entry.windSpeedMs = json.lookup(indexedPath(index,"/wind/speed"));
-            entry.windDirection = json.lookup(indexedPath(index,"/wind/deg"));
-            entry.timeUnix = json.lookup(indexedPath(index,"/dt"));
-            entry.condition = extractCondition(index);
-            uint8_t const * rainNode = json.lookup(indexedPath(index,"/rain/3h"));
-            if (0 == rainNode)
-                entry.rain = (uint8_t const *)"";
-            else
-                entry.rain = rainNode;
-            entries.push_back(entry);
-        }
+        bool ok;
     };
-    State state(buffer);
-    for (size_t i = 0; i < entries; ++i) state.extractEntry(i);
-    return state.entries;
-}
+    size_t threads;
+    std::vector<Part> parts;
+    virtual void part (size_t index, size_t, IByteBuffer const & document);
+};
 
 } // openweathermap
 
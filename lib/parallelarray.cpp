@@ -0,0 +1,394 @@
+// This software is part of OpenMono, see http://developer.openmono.com
+// Released under the MIT license, see LICENSE.txt
+#include "parallelarray.hpp"
+#include "jsonpath.hpp"
+#include "jsonvisitor.hpp"
+#include "SmallJSONParser.h"
+
+#if defined(__unix__) || defined(__APPLE__)
+#include <pthread.h>
+#define PARALLEL_ARRAY_THREADS
+#endif
+
+using json::JsonPath;
+
+namespace {
+
+typedef void (*TaskFunction) (void * context, size_t index);
+
+struct Task
+{
+    TaskFunction function;
+    void * context;
+    size_t index;
+};
+
+void * runTask (void * task)
+{
+    Task const & t = *static_cast<Task *>(task);
+    t.function(t.context,t.index);
+    return 0;
+}
+
+/**
+ * Run tasks 0 to count-1 at the same time and wait for them all.  The
+ * calling thread runs task 0, and any task that cannot get a thread.
+ */
+void runInParallel (size_t count, TaskFunction function, void * context)
+{
+    std::vector<Task> tasks(count);
+    for (size_t i = 0; i < count; ++i)
+    {
+        tasks[i].function = function;
+        tasks[i].context = context;
+        tasks[i].index = i;
+    }
+#if defined(PARALLEL_ARRAY_THREADS)
+    std::vector<pthread_t> threads(count);
+    std::vector<bool> started(count,false);
+    for (size_t i = 1; i < count; ++i)
+        started[i] = (pthread_create(&threads[i],0,runTask,&tasks[i]) == 0);
+    for (size_t i = 0; i < count; ++i)
+        if (! started[i]) runTask(&tasks[i]);
+    for (size_t i = 1; i < count; ++i)
+        if (started[i]) pthread_join(threads[i],0);
+#else
+    for (size_t i = 0; i < count; ++i) runTask(&tasks[i]);
+#endif
+}
+
+/**
+ * Nesting and string state while scanning the text of an array.
+ */
+struct ScanState
+{
+    bool inString;
+    bool escaped;
+    long depth;
+    long lowestDepth;
+    /**
+     * @return true if c is a comma or bracket outside a string.
+     */
+    bool step (uint8_t c)
+    {
+        if (inString)
+        {
+            if (escaped) escaped = false;
+            else if (c == '\\') escaped = true;
+            else if (c == '"') inString = false;
+            return false;
+        }
+        switch (c)
+        {
+            case '"':
+                inString = true;
+                return false;
+            case '[': case '{':
+                ++depth;
+                return true;
+            case ']': case '}':
+                if (--depth < lowestDepth) lowestDepth = depth;
+                return true;
+            case ',':
+                return true;
+            default:
+                return false;
+        }
+    }
+};
+
+/**
+ * A stretch of the text of the array, scanned by one thread.
+ */
+struct Segment
+{
+    size_t start;
+    size_t end;
+    /**
+     * Where the scan ends up if the segment starts outside [0] or inside [1] a string.
+     */
+    ScanState speculative[2];
+    /**
+     * How the segment really starts, once the segments before it are known.
+     */
+    bool startsInString;
+    long startDepth;
+    size_t arrayEnd;
+    std::vector<size_t> separators;
+};
+
+struct Scan
+{
+    uint8_t const * text;
+    std::vector<Segment> segments;
+};
+
+void speculate (void * context, size_t index)
+{
+    Scan & scan = *static_cast<Scan *>(context);
+    Segment & segment = scan.segments[index];
+    for (int inString = 0; inString < 2; ++inString)
+    {
+        ScanState state = { inString != 0, false, 0, 0 };
+        for (size_t position = segment.start; position < segment.end; ++position)
+            state.step(scan.text[position]);
+        segment.speculative[inString] = state;
+    }
+}
+
+void collectSeparators (void * context, size_t index)
+{
+    Scan & scan = *static_cast<Scan *>(context);
+    Segment & segment = scan.segments[index];
+    ScanState state = { segment.startsInString, false, segment.startDepth, segment.startDepth };
+    for (size_t position = segment.start; position < segment.end; ++position)
+    {
+        uint8_t c = scan.text[position];
+        if (! state.step(c)) continue;
+        if (c == ',' && state.depth == 0) segment.separators.push_back(position);
+        else if (state.depth < 0)
+        {
+            segment.arrayEnd = position;
+            return;
+        }
+    }
+}
+
+/**
+ * The whole document with only some elements left in the array.
+ */
+class PartByteBuffer
+:
+    public IByteBuffer
+{
+public:
+    PartByteBuffer (uint8_t const * text, size_t prefixEnd, size_t partStart, size_t partEnd, size_t suffixStart, size_t length)
+    {
+        start[0] = text;
+        start[1] = text + partStart;
+        start[2] = text + suffixStart;
+        lengths[0] = prefixEnd;
+        lengths[1] = partEnd - partStart;
+        lengths[2] = length - suffixStart;
+    }
+    virtual void add (uint8_t const *, size_t) {}
+    virtual size_t bytes () const
+    {
+        return lengths[0] + lengths[1] + lengths[2];
+    }
+    virtual size_t chunks () const
+    {
+        return 3;
+    }
+    virtual size_t chunkBytes (size_t index) const
+    {
+        return lengths[index];
+    }
+    virtual uint8_t operator[] (size_t position) const
+    {
+        size_t index = 0;
+        while (index < 2 && position >= lengths[index]) position -= lengths[index++];
+        return start[index][position];
+    }
+    virtual uint8_t const * chunk (size_t index) const
+    {
+        return start[index];
+    }
+    virtual bool hasStableChunks () const
+    {
+        return true;
+    }
+    virtual void clear () {}
+    virtual uint32_t generation () const
+    {
+        return 0;
+    }
+private:
+    uint8_t const * start[3];
+    size_t lengths[3];
+};
+
+struct Run
+{
+    json::ParallelArray const * array;
+    json::IArrayPartHandler * handler;
+};
+
+} // namespace {
+
+namespace json {
+
+ParallelArray::ParallelArray (uint8_t const * text_, size_t length_, size_t threads_)
+:
+    text(text_),
+    length(length_),
+    threads(threads_ > 0 ? threads_ : 1),
+    arrayStart(0),
+    arrayEnd(0)
+{
+}
+
+bool ParallelArray::split (char const * path)
+{
+    separators.clear();
+    arrayStart = arrayEnd = 0;
+    return findArray(path) && findSeparators();
+}
+
+size_t ParallelArray::elements () const
+{
+    if (! separators.empty()) return separators.size() + 1;
+    for (size_t position = arrayStart + 1; position < arrayEnd; ++position)
+    {
+        uint8_t c = text[position];
+        if (c != ' ' && c != '\t' && c != '\r' && c != '\n') return 1;
+    }
+    return 0;
+}
+
+size_t ParallelArray::parts () const
+{
+    size_t count = elements();
+    return count < threads ? count : threads;
+}
+
+void ParallelArray::run (IArrayPartHandler & handler) const
+{
+    Run context = { this, &handler };
+    runInParallel(parts(),runPart,&context);
+}
+
+void ParallelArray::runPart (void * context, size_t index)
+{
+    Run const & run = *static_cast<Run *>(context);
+    ParallelArray const & array = *run.array;
+    size_t count = array.elements();
+    size_t parts = array.parts();
+    size_t first = index * count / parts;
+    size_t next = (index + 1) * count / parts;
+    Range range = array.elementRange(first,next-first);
+    PartByteBuffer document (array.text,array.arrayStart+1,range.start,range.end,array.arrayEnd,array.length);
+    run.handler->part(index,first,document);
+}
+
+/**
+ * Find the start of the array by parsing the document up to it.
+ */
+bool ParallelArray::findArray (char const * path)
+{
+    JsonPath steps (path);
+    if (! steps.isValid()) return false;
+    for (size_t i = 0; i < steps.segments(); ++i)
+        if (steps.segment(i).isPlaceholder || steps.segment(i).isWildcard) return false;
+    JSONParser parser;
+    InitialiseJSONParser(&parser);
+    ProvideJSONInput(&parser,text,length);
+    bool isObject[MAX_VISIT_DEPTH];
+    bool atKey[MAX_VISIT_DEPTH];
+    // Containers open, and how many of them are on the path.
+    size_t depth = 0;
+    size_t matched = 0;
+    bool keyMatches = false;
+    for (;;)
+    {
+        JSONToken token = NextJSONToken(&parser);
+        int type = JSONTokenType(token);
+        if (IsJSONTokenPartial(token) || type == OutOfDataJSONToken || type == ParseErrorJSONToken) return false;
+        if (type == EndObjectJSONToken || type == EndArrayJSONToken)
+        {
+            if (depth == 0) return false;
+            --depth;
+            if (matched > depth) matched = depth;
+            if (depth > 0 && isObject[depth-1]) atKey[depth-1] = true;
+            continue;
+        }
+        if (depth > 0 && isObject[depth-1] && atKey[depth-1])
+        {
+            atKey[depth-1] = false;
+            keyMatches = matched == depth && depth <= steps.segments() && type == StringJSONToken &&
+                FastIsJSONStringEqualWithLength(token,steps.segmentText(depth-1),steps.segment(depth-1).length);
+            continue;
+        }
+        bool onPath = (depth == 0) || (matched == depth && isObject[depth-1] && keyMatches);
+        if (onPath && depth == steps.segments())
+        {
+            if (type != StartArrayJSONToken) return false;
+            arrayStart = token.start - text;
+            return true;
+        }
+        if (type == StartObjectJSONToken || type == StartArrayJSONToken)
+        {
+            if (depth == MAX_VISIT_DEPTH) return false;
+            isObject[depth] = (type == StartObjectJSONToken);
+            atKey[depth] = true;
+            if (onPath) matched = depth + 1;
+            ++depth;
+        }
+        else if (depth > 0 && isObject[depth-1]) atKey[depth-1] = true;
+    }
+}
+
+/**
+ * Find the commas between the elements and the end of the array.
+ */
+bool ParallelArray::findSeparators ()
+{
+    size_t bodyStart = arrayStart + 1;
+    size_t bodyLength = length - bodyStart;
+    size_t count = bodyLength / PARALLEL_MIN_SEGMENT;
+    if (count > threads) count = threads;
+    if (count == 0) count = 1;
+    Scan scan;
+    scan.text = text;
+    scan.segments.resize(count);
+    size_t start = bodyStart;
+    for (size_t i = 0; i < count; ++i)
+    {
+        size_t end = (i + 1 == count) ? length : bodyStart + (i + 1) * (bodyLength / count);
+        if (end < start) end = start;
+        // Keep escapes within one segment.
+        while (end < length && text[end-1] == '\\') ++end;
+        scan.segments[i].start = start;
+        scan.segments[i].end = end;
+        start = end;
+    }
+    runInParallel(count,speculate,&scan);
+    // Chain the speculative results to know how each segment starts.
+    size_t last = 0;
+    bool inString = false;
+    long depth = 0;
+    for (size_t i = 0; i < count; ++i)
+    {
+        Segment & segment = scan.segments[i];
+        ScanState const & result = segment.speculative[inString ? 1 : 0];
+        segment.startsInString = inString;
+        segment.startDepth = depth;
+        segment.arrayEnd = length;
+        if (depth + result.lowestDepth < 0)
+        {
+            last = i + 1;
+            break;
+        }
+        inString = result.inString;
+        depth += result.depth;
+    }
+    if (last == 0) return false;
+    scan.segments.resize(last);
+    runInParallel(last,collectSeparators,&scan);
+    arrayEnd = scan.segments[last-1].arrayEnd;
+    if (arrayEnd == length) return false;
+    for (size_t i = 0; i < last; ++i)
+        separators.insert(separators.end(),scan.segments[i].separators.begin(),scan.segments[i].separators.end());
+    return true;
+}
+
+ParallelArray::Range ParallelArray::elementRange (size_t first, size_t count) const
+{
+    Range range;
+    range.start = (first == 0) ? arrayStart + 1 : separators[first-1] + 1;
+    size_t next = first + count;
+    range.end = (next > separators.size()) ? arrayEnd : separators[next-1];
+    return range;
+}
+
+} // json
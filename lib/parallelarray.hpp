@@ -0,0 +1,105 @@
+// This software is part of OpenMono, see http://developer.openmono.com
+// Released under the MIT license, see LICENSE.txt
+#if !defined(__com_openmono_parallelarray_h)
+#define __com_openmono_parallelarray_h
+#include "ibytebuffer.hpp"
+#include <stddef.h>
+#include <stdint.h>
+#include <vector>
+
+#define PARALLEL_MIN_SEGMENT 0x4000
+
+namespace json {
+
+/**
+ * Receives the parts of an array that ParallelArray has split up.  Parts are
+ * handled at the same time on different threads.
+ */
+struct IArrayPartHandler
+{
+    virtual ~IArrayPartHandler () {};
+    /**
+     * @param part         index of the part, from 0 to ParallelArray::parts().
+     * @param firstElement index in the whole array of the first element in the part.
+     * @param document     the whole document with only the elements of the part in the array.
+     */
+    virtual void part (size_t part, size_t firstElement, IByteBuffer const & document) = 0;
+};
+
+/**
+ * ParallelArray splits a large JSON document held in memory into parts
+ * with consecutive elements of one array, so that they can be decoded on
+ * several threads at once.  It is meant for the host, where documents can
+ * have hundreds of thousands of elements.
+ *
+ * Examples:
+ *
+ *      ParallelArray array (text,length,4);
+ *      if (array.split("/list")) array.run(handler);
+ *
+ * Splitting takes two passes over the array, each on several threads.  The
+ * first finds, for each segment of the text, where its nesting and string
+ * state end up both if it starts inside a string and if it does not.  Those
+ * are chained from the start of the array to know how each segment really
+ * starts, and the second pass collects the commas between the elements.
+ * Segments never start right after a backslash, so an escape never spans
+ * them.
+ *
+ * Each part is handed over as the whole document with only the elements of
+ * the part left in the array, so anything that decodes the whole document
+ * decodes a part, and values outside the array are seen by every part.
+ * Parts are split in order, so collecting the results of part 0, 1 and so
+ * on gives the same result however many threads are used.
+ *
+ * The text between elements is not checked for errors, that is left to
+ * whatever decodes the parts.  Without POSIX threads everything runs on the
+ * calling thread.
+ */
+class ParallelArray
+{
+public:
+    /**
+     * @param text    the document, expected to live as long as ParallelArray.
+     * @param length  number of bytes in text.
+     * @param threads maximum number of threads to use.
+     */
+    ParallelArray (uint8_t const * text, size_t length, size_t threads);
+    /**
+     * Find the elements of an array.
+     * @param  path rooted path of object keys to the array, such as "/list".
+     * @return      false if there is no array at path.
+     */
+    bool split (char const * path);
+    /**
+     * @return number of elements in the array.
+     */
+    size_t elements () const;
+    /**
+     * @return number of parts the elements are split into, at most one per thread.
+     */
+    size_t parts () const;
+    /**
+     * Hand every part to a handler, one thread per part, and wait for them all.
+     */
+    void run (IArrayPartHandler & handler) const;
+private:
+    struct Range
+    {
+        size_t start;
+        size_t end;
+    };
+    uint8_t const * text;
+    size_t length;
+    size_t threads;
+    size_t arrayStart;
+    size_t arrayEnd;
+    std::vector<size_t> separators;
+    bool findArray (char const * path);
+    bool findSeparators ();
+    Range elementRange (size_t first, size_t count) const;
+    static void runPart (void * context, size_t index);
+};
+
+} // json
+
+#endif // __com_openmono_parallelarray_h
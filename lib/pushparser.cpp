@@ -0,0 +1,85 @@
+// This software is part of OpenMono, see http://developer.openmono.com
+// Released under the MIT license, see LICENSE.txt
+#include "pushparser.hpp"
+#include <string.h>
+
+namespace json {
+
+PushParser::PushParser (IJsonVisitor & visitor)
+:
+    walker(visitor)
+{
+    restart();
+}
+
+void PushParser::restart ()
+{
+    InitialiseJSONParser(&parser);
+    walker.restart();
+    tokenLength = 0;
+    tokenType = OutOfDataJSONToken;
+    tokenFlags = 0;
+    pending = false;
+}
+
+bool PushParser::feed (uint8_t const * chunk, size_t length)
+{
+    if (walker.status() != JsonWalker::Walking) return walker.status() == JsonWalker::Done;
+    ProvideJSONInput(&parser,chunk,length);
+    for (;;)
+    {
+        JSONToken token = NextJSONToken(&parser);
+        int type = JSONTokenType(token);
+        if (type == OutOfDataJSONToken) return true;
+        if (pending || IsJSONTokenPartial(token))
+        {
+            // The rest of a token split between chunks arrives as a token
+            // of the same type, so collect its pieces until it is complete.
+            append(token);
+            if (IsJSONTokenPartial(token)) return true;
+            token = reassembled(0);
+        }
+        if (walker.token(token) != JsonWalker::Walking) return walker.status() == JsonWalker::Done;
+    }
+}
+
+bool PushParser::finish ()
+{
+    // A number at the very end of the document only ends with the input.
+    if (pending) walker.token(reassembled(PartialJSONTokenFlag));
+    return walker.status() == JsonWalker::Done;
+}
+
+bool PushParser::isDone () const
+{
+    return walker.status() == JsonWalker::Done;
+}
+
+void PushParser::append (JSONToken const & token)
+{
+    // Leave room for a terminating zero added by UnescapeJSONStringTokenInPlace.
+    size_t bytes = token.end - token.start;
+    if (tokenLength + bytes > sizeof(tokenBuffer) - 1)
+    {
+        bytes = sizeof(tokenBuffer) - 1 - tokenLength;
+        tokenFlags |= TruncatedJSONTokenFlag;
+    }
+    memcpy(tokenBuffer+tokenLength,token.start,bytes);
+    tokenLength += bytes;
+    tokenType = JSONTokenType(token);
+    pending = true;
+}
+
+JSONToken PushParser::reassembled (unsigned int flags)
+{
+    JSONToken token;
+    token.typeandflags = tokenType | tokenFlags | flags;
+    token.start = tokenBuffer;
+    token.end = tokenBuffer + tokenLength;
+    tokenLength = 0;
+    tokenFlags = 0;
+    pending = false;
+    return token;
+}
+
+} // json
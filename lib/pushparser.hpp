@@ -0,0 +1,64 @@
+// This software is part of OpenMono, see http://developer.openmono.com
+// Released under the MIT license, see LICENSE.txt
+#if !defined(__com_openmono_pushparser_h)
+#define __com_openmono_pushparser_h
+#include "jsonvisitor.hpp"
+#include "SmallJSONParser.h"
+
+#define MAX_PUSH_TOKENSIZE 64
+
+namespace json {
+
+/**
+ * PushParser parses a JSON document while it arrives in chunks, such as an
+ * HTTP response, and calls a visitor as soon as each part is complete.
+ * Tokens split between chunks are reassembled in a small buffer, so strings
+ * longer than MAX_PUSH_TOKENSIZE are truncated.  Chunks do not have to live
+ * longer than the call to feed.
+ *
+ * Examples:
+ *
+ *      PushParser parser(visitor);
+ *      parser.feed(chunk1,length1);
+ *      parser.feed(chunk2,length2);
+ *      bool ok = parser.finish();
+ */
+class PushParser
+{
+public:
+    PushParser (IJsonVisitor & visitor);
+    /**
+     * Start parsing a new document.
+     */
+    void restart ();
+    /**
+     * Parse the next chunk of the document.
+     * @param  chunk  temporary pointer to chunk.
+     * @param  length size of chunk.
+     * @return        false if the document is broken.
+     */
+    bool feed (uint8_t const * chunk, size_t length);
+    /**
+     * Signal that the whole document has been fed.
+     * @return true if the document was complete.
+     */
+    bool finish ();
+    /**
+     * @return true if the whole document has been parsed.
+     */
+    bool isDone () const;
+private:
+    JSONParser parser;
+    JsonWalker walker;
+    uint8_t tokenBuffer[MAX_PUSH_TOKENSIZE];
+    size_t tokenLength;
+    int tokenType;
+    unsigned int tokenFlags;
+    bool pending;
+    void append (JSONToken const & token);
+    JSONToken reassembled (unsigned int flags);
+};
+
+} // json
+
+#endif // __com_openmono_pushparser_h
@@ -0,0 +1,283 @@
+// This software is part of OpenMono, see http://developer.openmono.com
+// Released under the MIT license, see LICENSE.txt
+#if !defined(__com_openmono_schemadecoder_h)
+#define __com_openmono_schemadecoder_h
+#include "arena.hpp"
+#include "jsonvisitor.hpp"
+#include "SmallJSONParser.h"
+#include <stddef.h>
+#include <stdint.h>
+
+#define MAX_SCHEMA_KEYS 4
+#define MAX_SCHEMA_FIELDS 32
+#define SCHEMA_DECODER_DEPTH 8
+#define SCHEMA_FIELDS(table) table, sizeof(table)/sizeof((table)[0])
+
+namespace json {
+
+/**
+ * Where a value in a JSON document is stored in a record.
+ */
+template <class Record>
+struct SchemaField
+{
+    /**
+     * Keys leading to the value, ending at the first 0.  Within an array,
+     * a key of decimal digits matches the element with that index.
+     */
+    char const * keys[MAX_SCHEMA_KEYS];
+    /**
+     * Member to store the value in as a string.
+     */
+    uint8_t const * Record::* member;
+};
+
+/**
+ * Which values of a JSON document go into which records: one record per
+ * element of an array, and one for values outside it that belong to the
+ * whole document.
+ *
+ * Examples:
+ *
+ *      SchemaField<EntryText> const elementFields[] =
+ *      {
+ *          { { "dt" }, &EntryText::timeUnix },
+ *          { { "main", "temp" }, &EntryText::temperatureK },
+ *      };
+ *      SchemaField<EntryText> const documentFields[] =
+ *      {
+ *          { { "city", "name" }, &EntryText::city },
+ *      };
+ *      Schema<EntryText> const schema =
+ *      {
+ *          { "list" }, SCHEMA_FIELDS(elementFields), SCHEMA_FIELDS(documentFields)
+ *      };
+ */
+template <class Record>
+struct Schema
+{
+    /**
+     * Keys leading from the root to the array of records, ending at the first 0.
+     */
+    char const * array[MAX_SCHEMA_KEYS];
+    /**
+     * Fields relative to each array element.
+     */
+    SchemaField<Record> const * elementFields;
+    size_t elementFieldCount;
+    /**
+     * Fields relative to the root.
+     */
+    SchemaField<Record> const * documentFields;
+    size_t documentFieldCount;
+};
+
+/**
+ * SchemaDecoder fills records from the parts of a JSON document as it is
+ * visited, in one pass and without looking up any paths.  Each field of
+ * the schema is a bit, and the bits of the fields that the keys so far
+ * can still lead to are kept for each level of the document, so a key is
+ * only compared with the fields that are still possible.
+ *
+ * Values are unescaped into the results arena.  Derived classes decide
+ * which records to decode and receive them when their element ends.  At
+ * most MAX_SCHEMA_FIELDS fields are decoded, and nothing nested deeper than
+ * SCHEMA_DECODER_DEPTH.
+ */
+template <class Record>
+class SchemaDecoder
+:
+    public IJsonVisitor
+{
+public:
+    /**
+     * @param schema  which values go where, expected to live as long as the decoder.
+     * @param results arena to store the values in.
+     */
+    SchemaDecoder (Schema<Record> const & schema_, Arena & results_)
+    :
+        schema(schema_),
+        results(results_),
+        arraySteps(0)
+    {
+        while (arraySteps < MAX_SCHEMA_KEYS && schema.array[arraySteps] != 0) ++arraySteps;
+        elementFieldCount = schema.elementFieldCount;
+        if (elementFieldCount > MAX_SCHEMA_FIELDS) elementFieldCount = MAX_SCHEMA_FIELDS;
+        documentFieldCount = schema.documentFieldCount;
+        if (elementFieldCount + documentFieldCount > MAX_SCHEMA_FIELDS)
+            documentFieldCount = MAX_SCHEMA_FIELDS - elementFieldCount;
+        size_t fields = elementFieldCount + documentFieldCount;
+        allFields = (fields == 32) ? 0xffffffff : (1u << fields) - 1;
+        restart();
+    }
+    /**
+     * Start decoding a new document, without freeing the values already
+     * stored in the results arena.
+     */
+    void restart ()
+    {
+        for (size_t i = 0; i < SCHEMA_DECODER_DEPTH; ++i) candidates[i] = 0;
+        inRecord = false;
+        documentRecord = Record();
+    }
+    /**
+     * @return the values found outside the array so far.
+     */
+    Record const & document () const
+    {
+        return documentRecord;
+    }
+    virtual void startObject (JsonContext const & context)
+    {
+        start(context);
+    }
+    virtual void endObject (JsonContext const & context)
+    {
+        end(context);
+    }
+    virtual void startArray (JsonContext const & context)
+    {
+        start(context);
+    }
+    virtual void endArray (JsonContext const & context)
+    {
+        end(context);
+    }
+    virtual void key (JSONToken const & key, size_t depth)
+    {
+        if (depth >= SCHEMA_DECODER_DEPTH) return;
+        candidates[depth] = narrow(candidates[depth-1],depth,&key,0);
+    }
+    virtual void value (JSONToken const & value, JsonContext const & context)
+    {
+        uint32_t fields = locate(context);
+        for (size_t i = 0; fields != 0; ++i, fields >>= 1)
+        {
+            if ((fields & 1) == 0 || steps(i) != context.depth) continue;
+            if (i < elementFieldCount)
+            {
+                if (inRecord) record.*(schema.elementFields[i].member) = store(value);
+            }
+            else documentRecord.*(schema.documentFields[i-elementFieldCount].member) = store(value);
+        }
+    }
+protected:
+    /**
+     * Called with the index of an element of the array when it starts.
+     * @return true to decode the element into a record.
+     */
+    virtual bool startRecord (size_t) { return true; }
+    /**
+     * Called when an element that is being decoded ends.
+     * @param index  index of the element.
+     * @param record the values found in the element, others are 0.
+     */
+    virtual void endRecord (size_t index, Record const & record) = 0;
+private:
+    Schema<Record> const & schema;
+    Arena & results;
+    size_t arraySteps;
+    size_t elementFieldCount;
+    size_t documentFieldCount;
+    uint32_t allFields;
+    uint32_t candidates[SCHEMA_DECODER_DEPTH];
+    bool inRecord;
+    Record record;
+    Record documentRecord;
+    /**
+     * @return number of keys from the root to a field.
+     */
+    size_t steps (size_t field) const
+    {
+        char const * const * keys = (field < elementFieldCount)
+            ? schema.elementFields[field].keys
+            : schema.documentFields[field-elementFieldCount].keys;
+        size_t count = 0;
+        while (count < MAX_SCHEMA_KEYS && keys[count] != 0) ++count;
+        return (field < elementFieldCount) ? arraySteps + 1 + count : count;
+    }
+    /**
+     * @return key of a field at a depth, "" for any array element, or 0 past the end.
+     */
+    char const * step (size_t field, size_t depth) const
+    {
+        if (field >= elementFieldCount)
+        {
+            if (depth > MAX_SCHEMA_KEYS) return 0;
+            return schema.documentFields[field-elementFieldCount].keys[depth-1];
+        }
+        if (depth <= arraySteps) return schema.array[depth-1];
+        if (depth == arraySteps + 1) return "";
+        if (depth - arraySteps - 1 > MAX_SCHEMA_KEYS) return 0;
+        return schema.elementFields[field].keys[depth-arraySteps-2];
+    }
+    static bool isIndex (char const * step, size_t index)
+    {
+        if (*step == 0) return true;
+        size_t value = 0;
+        for (; *step != 0; ++step)
+        {
+            if (*step < '0' || *step > '9') return false;
+            value = value * 10 + (*step - '0');
+        }
+        return value == index;
+    }
+    /**
+     * Find the fields that can still be reached one level further down.
+     * @param fields fields possible at the parent.
+     * @param depth  depth of the value.
+     * @param key    key of the value in an object, or 0 for an array element.
+     * @param index  index of the value in an array.
+     */
+    uint32_t narrow (uint32_t fields, size_t depth, JSONToken const * key, size_t index) const
+    {
+        uint32_t result = 0;
+        for (size_t i = 0; (fields >> i) != 0; ++i)
+        {
+            if ((fields & (1u << i)) == 0) continue;
+            char const * expected = step(i,depth);
+            if (expected == 0) continue;
+            bool matches = (key != 0) ? (*expected != 0 && FastIsJSONStringEqual(*key,expected)) : isIndex(expected,index);
+            if (matches) result |= (1u << i);
+        }
+        return result;
+    }
+    uint32_t locate (JsonContext const & context)
+    {
+        if (context.depth == 0) return allFields;
+        if (context.depth >= SCHEMA_DECODER_DEPTH) return 0;
+        if (context.inArray) candidates[context.depth] = narrow(candidates[context.depth-1],context.depth,0,context.index);
+        return candidates[context.depth];
+    }
+    bool isElement (JsonContext const & context) const
+    {
+        uint32_t elementFields = (elementFieldCount == 32) ? 0xffffffff : (1u << elementFieldCount) - 1;
+        return context.depth == arraySteps + 1 && context.inArray &&
+            context.depth < SCHEMA_DECODER_DEPTH && (candidates[context.depth] & elementFields) != 0;
+    }
+    void start (JsonContext const & context)
+    {
+        uint32_t fields = locate(context);
+        if (context.depth < SCHEMA_DECODER_DEPTH) candidates[context.depth] = fields;
+        if (! isElement(context)) return;
+        inRecord = startRecord(context.index);
+        record = Record();
+    }
+    void end (JsonContext const & context)
+    {
+        if (! inRecord || ! isElement(context)) return;
+        inRecord = false;
+        endRecord(context.index,record);
+    }
+    uint8_t const * store (JSONToken const & token)
+    {
+        uint8_t * value = results.allocate(SizeOfUnescapingBufferForJSONStringToken(token));
+        if (0 == value) return 0;
+        UnescapeJSONStringToken(token,value,0);
+        return value;
+    }
+};
+
+} // json
+
+#endif // __com_openmono_schemadecoder_h
@@ -0,0 +1,165 @@
+// This software is part of OpenMono, see http://developer.openmono.com
+// Released under the MIT license, see LICENSE.txt
+#include "snapshot.hpp"
+#include <string.h>
+
+namespace {
+
+uint8_t const magic[4] = { 'M', 'W', 'F', 'S' };
+
+void put16 (uint8_t * & out, uint16_t value)
+{
+    *out++ = uint8_t(value);
+    *out++ = uint8_t(value >> 8);
+}
+
+void put32 (uint8_t * & out, uint32_t value)
+{
+    put16(out,uint16_t(value));
+    put16(out,uint16_t(value >> 16));
+}
+
+uint16_t get16 (uint8_t const * & in)
+{
+    uint16_t value = uint16_t(in[0] | (in[1] << 8));
+    in += 2;
+    return value;
+}
+
+uint32_t get32 (uint8_t const * & in)
+{
+    uint32_t low = get16(in);
+    return low | (uint32_t(get16(in)) << 16);
+}
+
+/**
+ * Fletcher's checksum with 16 bit sums of single bytes, rather than of 16 bit
+ * words as in Fletcher-32.
+ */
+uint32_t fletcher (uint8_t const * bytes, size_t length)
+{
+    uint32_t sum1 = 0xffff;
+    uint32_t sum2 = 0xffff;
+    while (length > 0)
+    {
+        // Sums of up to 359 bytes cannot overflow before they are reduced.
+        size_t block = length < 359 ? length : 359;
+        length -= block;
+        for (; block > 0; --block)
+        {
+            sum1 += *bytes++;
+            sum2 += sum1;
+        }
+        sum1 = (sum1 & 0xffff) + (sum1 >> 16);
+        sum2 = (sum2 & 0xffff) + (sum2 >> 16);
+    }
+    sum1 = (sum1 & 0xffff) + (sum1 >> 16);
+    sum2 = (sum2 & 0xffff) + (sum2 >> 16);
+    return (sum2 << 16) | sum1;
+}
+
+} // namespace {
+
+namespace weather {
+
+Snapshot::Snapshot ()
+:
+    sourceBytes(0)
+{
+    city[0] = 0;
+}
+
+void Snapshot::setCity (uint8_t const * name)
+{
+    size_t length = 0;
+    if (name != 0)
+        while (length < SNAPSHOT_MAX_CITY && name[length] != 0) ++length;
+    memcpy(city,name,length);
+    city[length] = 0;
+}
+
+size_t Snapshot::bytes () const
+{
+    return SNAPSHOT_HEADER_BYTES + strlen((char const *)city) +
+        entries.size() * SNAPSHOT_ENTRY_BYTES + SNAPSHOT_CHECKSUM_BYTES;
+}
+
+size_t Snapshot::write (uint8_t * destination, size_t capacity) const
+{
+    size_t length = bytes();
+    if (length > capacity || entries.size() < SNAPSHOT_MIN_ENTRIES || entries.size() > SNAPSHOT_MAX_ENTRIES) return 0;
+    size_t cityLength = strlen((char const *)city);
+    uint8_t * out = destination;
+    memcpy(out,magic,sizeof(magic));
+    out += sizeof(magic);
+    put16(out,SNAPSHOT_VERSION);
+    put16(out,uint16_t(entries.size()));
+    put32(out,sourceBytes);
+    put32(out,uint32_t(cityLength));
+    memcpy(out,city,cityLength);
+    out += cityLength;
+    for (size_t i = 0; i < entries.size(); ++i, out += SNAPSHOT_ENTRY_BYTES)
+        writeEntryRecord(entries[i],out);
+    put32(out,fletcher(destination,out - destination));
+    return length;
+}
+
+bool Snapshot::read (uint8_t const * source, size_t length)
+{
+    if (length < SNAPSHOT_HEADER_BYTES + SNAPSHOT_CHECKSUM_BYTES) return false;
+    if (memcmp(source,magic,sizeof(magic)) != 0) return false;
+    uint8_t const * in = source + sizeof(magic);
+    uint16_t version = get16(in);
+    size_t count = get16(in);
+    uint32_t documentBytes = get32(in);
+    uint32_t cityLength = get32(in);
+    if (version != SNAPSHOT_VERSION || cityLength > SNAPSHOT_MAX_CITY) return false;
+    if (count < SNAPSHOT_MIN_ENTRIES || count > SNAPSHOT_MAX_ENTRIES) return false;
+    size_t expected = SNAPSHOT_HEADER_BYTES + cityLength + count * SNAPSHOT_ENTRY_BYTES + SNAPSHOT_CHECKSUM_BYTES;
+    if (length != expected) return false;
+    uint8_t const * checksum = source + length - SNAPSHOT_CHECKSUM_BYTES;
+    if (get32(checksum) != fletcher(source,length - SNAPSHOT_CHECKSUM_BYTES)) return false;
+    uint8_t const * name = in;
+    in += cityLength;
+    std::vector<Entry> decoded(count);
+    for (size_t i = 0; i < count; ++i, in += SNAPSHOT_ENTRY_BYTES)
+        if (! readEntryRecord(in,&decoded[i])) return false;
+    sourceBytes = documentBytes;
+    memcpy(city,name,cityLength);
+    city[cityLength] = 0;
+    entries.swap(decoded);
+    return true;
+}
+
+void writeEntryRecord (Entry const & entry, uint8_t * record)
+{
+    put32(record,entry.timeUnix);
+    put32(record,entry.city);
+    put16(record,entry.temperatureCentiK);
+    put16(record,entry.pressureDeciHpa);
+    put16(record,entry.windSpeedCentiMs);
+    put16(record,entry.windDirectionDeciDegrees);
+    put16(record,entry.rainCentiMm);
+    *record++ = entry.cloudPercentage;
+    *record++ = entry.humidity;
+    *record++ = entry.condition;
+    *record++ = entry.hasRain ? 1 : 0;
+}
+
+bool readEntryRecord (uint8_t const * record, Entry * entry)
+{
+    entry->timeUnix = get32(record);
+    entry->city = get32(record);
+    entry->temperatureCentiK = get16(record);
+    entry->pressureDeciHpa = get16(record);
+    entry->windSpeedCentiMs = get16(record);
+    entry->windDirectionDeciDegrees = get16(record);
+    entry->rainCentiMm = get16(record);
+    entry->cloudPercentage = *record++;
+    entry->humidity = *record++;
+    entry->condition = *record++;
+    entry->hasRain = (*record++ != 0);
+    return entry->condition <= Unknown;
+}
+
+} // weather
@@ -0,0 +1,104 @@
+// This software is part of OpenMono, see http://developer.openmono.com
+// Released under the MIT license, see LICENSE.txt
+#if !defined(__com_openmono_snapshot_h)
+#define __com_openmono_snapshot_h
+#include "weather.hpp"
+#include <stddef.h>
+#include <stdint.h>
+#include <vector>
+
+#define SNAPSHOT_VERSION 1
+#define SNAPSHOT_MAX_CITY 63
+#define SNAPSHOT_MIN_ENTRIES 2
+#define SNAPSHOT_MAX_ENTRIES 40
+#define SNAPSHOT_HEADER_BYTES 16
+#define SNAPSHOT_ENTRY_BYTES 22
+#define SNAPSHOT_CHECKSUM_BYTES 4
+
+namespace weather {
+
+/**
+ * Snapshot is a decoded forecast in a small binary file, so that a device
+ * that wakes up can show the forecast after one read, without parsing the
+ * JSON it was decoded from.
+ *
+ * Examples:
+ *
+ *      Snapshot snapshot;
+ *      snapshot.setCity(city);
+ *      snapshot.entries = forecast;
+ *      snapshot.sourceBytes = buffer.bytes();
+ *      size_t length = snapshot.write(bytes,sizeof(bytes));
+ *
+ *      if (snapshot.read(bytes,length) && snapshot.sourceBytes == buffer.bytes()) ...
+ *
+ * The layout is fixed and little endian whatever the platform:
+ *
+ *      0   "MWFS"
+ *      4   uint16 version
+ *      6   uint16 number of entries
+ *      8   uint32 size of the document the forecast was decoded from
+ *      12  uint32 length of the city name
+ *      16  city name, without terminator
+ *          entries of 22 bytes each: uint32 time, uint32 city id, uint16
+ *          temperature, pressure, wind speed, wind direction and rain,
+ *          uint8 clouds, humidity, condition and 1 if there is rain
+ *          uint32 Fletcher checksum of everything before it, with two
+ *          16 bit sums of single bytes
+ *
+ * A snapshot of another version, with a wrong checksum, of another size
+ * than its header says, or with fewer than SNAPSHOT_MIN_ENTRIES entries to
+ * show, is not read.  The size of the source document only catches some
+ * snapshots that are older than the document, so whoever rewrites the
+ * document removes the snapshot first.
+ */
+struct Snapshot
+{
+    Snapshot ();
+    /**
+     * Size of the document that the forecast was decoded from.
+     */
+    uint32_t sourceBytes;
+    /**
+     * Name of the city, terminated.
+     */
+    uint8_t city[SNAPSHOT_MAX_CITY+1];
+    std::vector<Entry> entries;
+    /**
+     * @param name name of the city, cut to SNAPSHOT_MAX_CITY bytes.
+     */
+    void setCity (uint8_t const * name);
+    /**
+     * @return number of bytes write needs.
+     */
+    size_t bytes () const;
+    /**
+     * @param  destination where to write the snapshot.
+     * @param  capacity    bytes available at destination.
+     * @return             bytes written, or 0 if they do not fit or there are fewer than SNAPSHOT_MIN_ENTRIES or more than SNAPSHOT_MAX_ENTRIES entries.
+     */
+    size_t write (uint8_t * destination, size_t capacity) const;
+    /**
+     * @param  source the contents of a snapshot file.
+     * @param  length bytes in source.
+     * @return        false if source is not a valid snapshot of this version, and then the snapshot is unchanged.
+     */
+    bool read (uint8_t const * source, size_t length);
+};
+
+/**
+ * Write an entry as a record of SNAPSHOT_ENTRY_BYTES bytes in the layout of
+ * the entries of a snapshot.
+ */
+void writeEntryRecord (Entry const & entry, uint8_t * record);
+
+/**
+ * @param  record SNAPSHOT_ENTRY_BYTES bytes written by writeEntryRecord.
+ * @param  entry  where to store the entry.
+ * @return        false if the record does not hold a valid entry.
+ */
+bool readEntryRecord (uint8_t const * record, Entry * entry);
+
+} // weather
+
+#endif // __com_openmono_snapshot_h
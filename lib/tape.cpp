@@ -0,0 +1,253 @@
+// This software is part of OpenMono, see http://developer.openmono.com
+// Released under the MIT license, see LICENSE.txt
+#include "tape.hpp"
+#include <algorithm>
+#include <string.h>
+
+#define TAPE_MAX_KEYSIZE 64
+#define TAPE_NO_KEY 0xffffffff
+#define TAPE_NOT_FOUND ((size_t)-1)
+
+namespace json {
+
+Tape::Tape (IByteBuffer const & byteBuffer_)
+:
+    byteBuffer(byteBuffer_),
+    built(false)
+{
+}
+
+bool Tape::isBuilt () const
+{
+    return built;
+}
+
+size_t Tape::entries () const
+{
+    return entryStore.size();
+}
+
+void Tape::clear ()
+{
+    entryStore.clear();
+    levels.clear();
+    chunkOffsets.clear();
+    keyStore.clear();
+    keyStarts.clear();
+    keyHashes.clear();
+    built = false;
+}
+
+bool Tape::build ()
+{
+    clear();
+    JSONParser parser;
+    InitialiseJSONParser(&parser);
+    // A token split over several chunks is collected here.
+    bool pending = false;
+    size_t pendingStart = 0;
+    char key[TAPE_MAX_KEYSIZE];
+    size_t keyLength = 0;
+    size_t chunkStart = 0;
+    size_t chunks = byteBuffer.chunks();
+    for (size_t i = 0; i < chunks; ++i)
+    {
+        uint8_t const * chunk = byteBuffer.chunk(i);
+        size_t chunkBytes = byteBuffer.chunkBytes(i);
+        if (0 == chunk) return false;
+        chunkOffsets.push_back(chunkStart);
+        ProvideJSONInput(&parser,chunk,chunkBytes);
+        for (;;)
+        {
+            JSONToken token = NextJSONToken(&parser);
+            int type = JSONTokenType(token);
+            if (type == OutOfDataJSONToken) break;
+            if (type == ParseErrorJSONToken) return false;
+            if (! pending)
+            {
+                pendingStart = chunkStart + (token.start - chunk);
+                keyLength = 0;
+            }
+            size_t fragment = token.end - token.start;
+            if (keyLength + fragment >= sizeof(key)) fragment = sizeof(key) - 1 - keyLength;
+            memcpy(key+keyLength,token.start,fragment);
+            keyLength += fragment;
+            key[keyLength] = '\0';
+            size_t end = chunkStart + (token.end - chunk);
+            pending = IsJSONTokenPartial(token);
+            if (pending) break;
+            if (! add(type,pendingStart,end,key)) return false;
+        }
+        chunkStart += chunkBytes;
+    }
+    // A number can end at the very end of the document.
+    if (pending && ! add(parser.partialtokentype,pendingStart,chunkStart,key)) return false;
+    built = (! entryStore.empty() && levels.empty());
+    return built;
+}
+
+bool Tape::add (int type, size_t start, size_t end, char const * key)
+{
+    Entry entry;
+    entry.type = type;
+    entry.offset = start;
+    entry.link = end - start;
+    uint32_t index = entryStore.size();
+    if (type == EndObjectJSONToken || type == EndArrayJSONToken)
+    {
+        if (levels.empty()) return false;
+        entryStore[levels.back().start].link = index;
+        levels.pop_back();
+    }
+    else if (! levels.empty() && levels.back().object)
+    {
+        Level & level = levels.back();
+        if (level.expectKey)
+        {
+            if (type != StringJSONToken) return false;
+            entry.link = internKey(key);
+        }
+        level.expectKey = ! level.expectKey;
+    }
+    if (type == StartObjectJSONToken || type == StartArrayJSONToken)
+    {
+        Level level;
+        level.start = index;
+        level.object = (type == StartObjectJSONToken);
+        level.expectKey = true;
+        levels.push_back(level);
+    }
+    entryStore.push_back(entry);
+    return true;
+}
+
+uint32_t Tape::internKey (char const * key)
+{
+    size_t length = strlen(key);
+    if (length >= TAPE_MAX_KEYSIZE - 1) return TAPE_NO_KEY;
+    uint32_t hash = JsonPath::hash(key,length);
+    uint32_t id = findKey(key,length,hash);
+    if (id != TAPE_NO_KEY) return id;
+    keyHashes.push_back(hash);
+    keyStarts.push_back(keyStore.size());
+    keyStore.insert(keyStore.end(),key,key+length+1);
+    return keyStarts.size() - 1;
+}
+
+uint32_t Tape::findKey (char const * key, size_t length, uint32_t hash) const
+{
+    for (size_t i = 0; i < keyStarts.size(); ++i)
+    {
+        if (keyHashes[i] != hash) continue;
+        char const * candidate = &keyStore[keyStarts[i]];
+        if (strncmp(candidate,key,length) == 0 && candidate[length] == '\0') return i;
+    }
+    return TAPE_NO_KEY;
+}
+
+size_t Tape::skip (size_t index) const
+{
+    int type = entryStore[index].type;
+    if (type == StartObjectJSONToken || type == StartArrayJSONToken) return entryStore[index].link + 1;
+    return index + 1;
+}
+
+size_t Tape::find (JsonPath const & path, size_t placeholderIndex) const
+{
+    if (! built || ! path.isValid() || path.hasWildcard()) return TAPE_NOT_FOUND;
+    size_t index = 0;
+    for (size_t i = 0; i < path.segments(); ++i)
+    {
+        JsonPath::Segment const & segment = path.segment(i);
+        Entry const & parent = entryStore[index];
+        size_t end = (parent.type == StartObjectJSONToken || parent.type == StartArrayJSONToken) ? parent.link : index;
+        if (parent.type == StartObjectJSONToken)
+        {
+            uint32_t id = findKey(path.segmentText(i),segment.length,segment.hash);
+            if (id == TAPE_NO_KEY) return TAPE_NOT_FOUND;
+            // Keys are followed by their values.
+            index = index + 1;
+            while (index < end && entryStore[index].link != id) index = skip(index + 1);
+            if (index >= end) return TAPE_NOT_FOUND;
+            ++index;
+        }
+        else if (parent.type == StartArrayJSONToken)
+        {
+            size_t element = segment.isPlaceholder ? placeholderIndex : segment.index;
+            index = index + 1;
+            for (; index < end && element > 0; --element) index = skip(index);
+            if (index >= end) return TAPE_NOT_FOUND;
+        }
+        else return TAPE_NOT_FOUND;
+    }
+    return index;
+}
+
+uint8_t const * Tape::lookup (JsonPath const & path, size_t placeholderIndex, Arena & results) const
+{
+    size_t index = find(path,placeholderIndex);
+    if (index == TAPE_NOT_FOUND) return 0;
+    Entry const & entry = entryStore[index];
+    switch (entry.type)
+    {
+        case StringJSONToken: case NumberJSONToken:
+        case TrueJSONToken: case FalseJSONToken: case NullJSONToken:
+            return copyValue(entry,results);
+        default:
+            return 0;
+    }
+}
+
+size_t Tape::lookupArraySize (JsonPath const & path, size_t placeholderIndex) const
+{
+    size_t index = find(path,placeholderIndex);
+    if (index == TAPE_NOT_FOUND) return 0;
+    if (entryStore[index].type != StartArrayJSONToken) return 0;
+    size_t end = entryStore[index].link;
+    size_t length = 0;
+    for (index = index + 1; index < end; index = skip(index)) ++length;
+    return length;
+}
+
+bool Tape::lookupNumber (JsonPath const & path, size_t placeholderIndex, uint8_t * buffer, size_t size, JSONToken & token) const
+{
+    size_t index = find(path,placeholderIndex);
+    if (index == TAPE_NOT_FOUND) return false;
+    Entry const & entry = entryStore[index];
+    if (entry.type != NumberJSONToken || entry.link >= size) return false;
+    token.typeandflags = entry.type;
+    token.start = buffer;
+    token.end = buffer + copyBytes(entry,buffer);
+    return true;
+}
+
+uint8_t const * Tape::copyValue (Entry const & entry, Arena & results) const
+{
+    uint8_t * value = results.allocate(entry.link + 1);
+    if (0 == value) return 0;
+    JSONToken token;
+    token.typeandflags = entry.type;
+    token.start = value;
+    token.end = value + copyBytes(entry,value);
+    UnescapeJSONStringTokenInPlace(&token);
+    return value;
+}
+
+size_t Tape::copyBytes (Entry const & entry, uint8_t * destination) const
+{
+    size_t chunk = std::upper_bound(chunkOffsets.begin(),chunkOffsets.end(),(size_t)entry.offset) - chunkOffsets.begin() - 1;
+    size_t inChunk = entry.offset - chunkOffsets[chunk];
+    size_t copied = 0;
+    while (copied < entry.link && chunk < chunkOffsets.size())
+    {
+        size_t available = byteBuffer.chunkBytes(chunk) - inChunk;
+        size_t bytes = std::min(available,entry.link - copied);
+        memcpy(destination+copied,byteBuffer.chunk(chunk)+inChunk,bytes);
+        copied += bytes;
+        inChunk = 0;
+        ++chunk;
+    }
+    return copied;
+}
+
+} // json
@@ -0,0 +1,93 @@
+// This software is part of OpenMono, see http://developer.openmono.com
+// Released under the MIT license, see LICENSE.txt
+#if !defined(__com_openmono_tape_h)
+#define __com_openmono_tape_h
+#include "arena.hpp"
+#include "ibytebuffer.hpp"
+#include "jsonpath.hpp"
+#include "SmallJSONParser.h"
+#include <vector>
+
+namespace json {
+
+/**
+ * Tape is a structural index of a JSON document: one entry per token with
+ * its type and byte offset in the document.  Objects and arrays link to the
+ * entry that ends them, so that whole values can be skipped in one step,
+ * and object keys are stored as ids into a table of distinct keys.
+ *
+ * Building the tape parses the document once.  Lookups then only read the
+ * document to copy out the value found.
+ */
+class Tape
+{
+public:
+    Tape (IByteBuffer const & byteBuffer);
+    /**
+     * Parse the document and build the index.
+     * @return false if the document could not be parsed.
+     */
+    bool build ();
+    /**
+     * @return true if build has succeeded.
+     */
+    bool isBuilt () const;
+    /**
+     * @see Json::lookup
+     */
+    uint8_t const * lookup (JsonPath const & path, size_t index, Arena & results) const;
+    /**
+     * Find a number and copy it out of the document.
+     * @param  path   rooted path to the JSON element.
+     * @param  index  array index for a placeholder in the path.
+     * @param  buffer where to copy the number to.
+     * @param  size   bytes available in buffer.
+     * @param  token  set to the number in buffer.
+     * @return        false if not found, not a number, or too long for buffer.
+     */
+    bool lookupNumber (JsonPath const & path, size_t index, uint8_t * buffer, size_t size, JSONToken & token) const;
+    /**
+     * @see Json::lookupArraySize
+     */
+    size_t lookupArraySize (JsonPath const & path, size_t index) const;
+    /**
+     * @return number of tokens in the index.
+     */
+    size_t entries () const;
+private:
+    struct Entry
+    {
+        uint8_t type;
+        // Offset of the value in the document, unused for keys.
+        uint32_t offset;
+        // Index of the ending entry for objects and arrays, key id for
+        // keys, and length of the value for everything else.
+        uint32_t link;
+    };
+    struct Level
+    {
+        uint32_t start;
+        bool object;
+        bool expectKey;
+    };
+    IByteBuffer const & byteBuffer;
+    std::vector<Entry> entryStore;
+    std::vector<Level> levels;
+    std::vector<size_t> chunkOffsets;
+    std::vector<char> keyStore;
+    std::vector<uint32_t> keyStarts;
+    std::vector<uint32_t> keyHashes;
+    bool built;
+    void clear ();
+    bool add (int type, size_t start, size_t end, char const * key);
+    uint32_t internKey (char const * key);
+    uint32_t findKey (char const * key, size_t length, uint32_t hash) const;
+    size_t skip (size_t index) const;
+    size_t find (JsonPath const & path, size_t index) const;
+    uint8_t const * copyValue (Entry const & entry, Arena & results) const;
+    size_t copyBytes (Entry const & entry, uint8_t * destination) const;
+};
+
+} // json
+
+#endif // __com_openmono_tape_h
@@ -2,7 +2,7 @@
 // Released under the MIT license, see LICENSE.txt
 #if !defined(__com_openmono_weather_h)
 #define __com_openmono_weather_h
-#include <string.h>
+#include <stdint.h>
 
 namespace weather {
 
@@ -29,32 +29,62 @@ enum Condition
     Unknown
 };
 
+/**
+ * @return id of a city name, the same for the same name wherever it was
+ *         parsed, or 0 for no name.
+ */
+inline uint32_t cityId (uint8_t const * name)
+{
+    if (0 == name || 0 == *name) return 0;
+    // FNV-1a
+    uint32_t hash = 2166136261u;
+    for (; *name != 0; ++name) hash = (hash ^ *name) * 16777619u;
+    return hash != 0 ? hash : 1;
+}
+
+/**
+ * One weather report in fixed point, converted when it is parsed so that
+ * nothing needs to parse numbers again and entries compare a word at a
+ * time.  Values that are missing or out of range are 0.
+ */
 struct Entry
 {
-    uint8_t const * city;
-    uint8_t const * temperatureK;
-    uint8_t const * cloudPercentage;
-    uint8_t const * windSpeedMs;
-    uint8_t const * windDirection;
-    uint8_t const * humidity;
-    uint8_t const * pressureHpa;
-    uint8_t const * timeUnix;
-    uint8_t const * rain;
-    Condition condition;
+    uint32_t timeUnix;
+    /**
+     * cityId of the name of the city.
+     */
+    uint32_t city;
+    uint16_t temperatureCentiK;
+    uint16_t pressureDeciHpa;
+    uint16_t windSpeedCentiMs;
+    uint16_t windDirectionDeciDegrees;
+    /**
+     * Rain in the last 3 hours.
+     */
+    uint16_t rainCentiMm;
+    uint8_t cloudPercentage;
+    uint8_t humidity;
+    /**
+     * A Condition.
+     */
+    uint8_t condition;
+    /**
+     * False if the report has no rain at all, rather than 0 mm.
+     */
+    bool hasRain;
     bool operator == (Entry const & rhs) const
     {
-#       define different(x,y) (strcmp((char const *)x,(char const *)y)!=0)
-        if (different(city,rhs.city)) return false;
-        if (different(temperatureK,rhs.temperatureK)) return false;
-        if (different(cloudPercentage,rhs.cloudPercentage)) return false;
-        if (different(windSpeedMs,rhs.windSpeedMs)) return false;
-        if (different(windDirection,rhs.windDirection)) return false;
-        if (different(humidity,rhs.humidity)) return false;
-        if (different(pressureHpa,rhs.pressureHpa)) return false;
-        if (different(timeUnix,rhs.timeUnix)) return false;
-        if (condition != rhs.condition) return false;
-        if (rain != rhs.rain) return false;
-        return true;
+        return timeUnix == rhs.timeUnix &&
+            city == rhs.city &&
+            temperatureCentiK == rhs.temperatureCentiK &&
+            pressureDeciHpa == rhs.pressureDeciHpa &&
+            windSpeedCentiMs == rhs.windSpeedCentiMs &&
+            windDirectionDeciDegrees == rhs.windDirectionDeciDegrees &&
+            rainCentiMm == rhs.rainCentiMm &&
+            cloudPercentage == rhs.cloudPercentage &&
+            humidity == rhs.humidity &&
+            condition == rhs.condition &&
+            hasRain == rhs.hasRain;
     }
     bool operator != (Entry const & rhs) const
     {
@@ -9,7 +9,8 @@
 SdCardByteBuffer::SdCardByteBuffer ()
 :
     _status(SdBuffer_NotInitialised),
-    bytesTotal(0)
+    bytesTotal(0),
+    generationCount(0)
 {
 }
 
@@ -36,6 +37,7 @@ void SdCardByteBuffer::attach (mono::String const & fileName)
     bytesTotal = ftell(file);
     printf("Bytes in file: %d\r\n",bytesTotal);
     fclose(file);
+    ++generationCount;
     _status = SdBuffer_OK;
 }
 
@@ -52,6 +54,7 @@ void SdCardByteBuffer::add (uint8_t const * data, size_t length)
         _status = SdBuffer_FileNotWritable;
         return;
     }
+    ++generationCount;
     size_t written = fwrite(data,1,length,file);
     if (written != length)
     {
@@ -70,18 +73,15 @@ size_t SdCardByteBuffer::bytes () const
 
 size_t SdCardByteBuffer::chunks () const
 {
-    size_t count = bytes();
-    size_t chunks = count / CHUNK_SIZE;
-    if (chunks * CHUNK_SIZE < count) return chunks + 1;
-    return chunks;
+    return (bytesTotal + CHUNK_SIZE - 1) / CHUNK_SIZE;
 }
 
 size_t SdCardByteBuffer::chunkBytes (size_t index) const
 {
-    size_t count = chunks();
-    if (index < (count-1)) return CHUNK_SIZE;
-    if (index >= count) return 0;
-    return bytes() % CHUNK_SIZE;
+    size_t start = index * CHUNK_SIZE;
+    if (start >= bytesTotal) return 0;
+    size_t remaining = bytesTotal - start;
+    return remaining < CHUNK_SIZE ? remaining : CHUNK_SIZE;
 }
 
 uint8_t SdCardByteBuffer::operator[] (size_t index) const
@@ -103,7 +103,7 @@ uint8_t SdCardByteBuffer::operator[] (size_t index) const
     return buffer;
 }
 
-uint8_t const * const SdCardByteBuffer::chunk (size_t index) const
+uint8_t const * SdCardByteBuffer::chunk (size_t index) const
 {
     static uint8_t buffer[CHUNK_SIZE];
     FILE * file = fopen(path(),"r");
@@ -125,6 +125,7 @@ uint8_t const * const SdCardByteBuffer::chunk (size_t index) const
 void SdCardByteBuffer::clear ()
 {
     bytesTotal = 0;
+    ++generationCount;
     SdCard::Status sdStatus = SdCard::get().mkdirForFullPath(path);
     if (sdStatus != SdCard::SdCard_OK)
     {
@@ -140,3 +141,8 @@ void SdCardByteBuffer::clear ()
     _status = SdBuffer_OK;
     fclose(file);
 }
+
+uint32_t SdCardByteBuffer::generation () const
+{
+    return generationCount;
+}
@@ -38,13 +38,15 @@ public:
     virtual size_t chunks () const;
     virtual size_t chunkBytes (size_t index) const;
     virtual uint8_t operator[] (size_t position) const;
-    virtual uint8_t const * const chunk (size_t index) const;
+    virtual uint8_t const * chunk (size_t index) const;
     virtual void clear ();
+    virtual uint32_t generation () const;
 private:
     void mkdirs ();
     mutable Status _status;
     mono::String path;
     size_t bytesTotal;
+    uint32_t generationCount;
 };
 
 #endif // __com_openmono_sdcardbytebuffer_h
@@ -0,0 +1,75 @@
+// This software is part of OpenMono, see http://developer.openmono.com
+// Released under the MIT license, see LICENSE.txt
+#include "catch.hpp"
+#include "util.hpp"
+#include "arena.hpp"
+
+TEST_CASE("arena","")
+{
+    SECTION("growable arena hands out consecutive memory")
+    {
+        // Arrange
+        Arena sut(16);
+        // Act
+        uint8_t * first = sut.allocate(4);
+        uint8_t * second = sut.allocate(4);
+        // Assert
+        REQUIRE( first != 0 );
+        REQUIRE( second == first + 4 );
+        REQUIRE( sut.used() == 8 );
+    }
+    SECTION("growable arena takes more blocks when needed")
+    {
+        // Arrange
+        Arena sut(16);
+        // Act
+        uint8_t * first = sut.allocate(12);
+        uint8_t * second = sut.allocate(12);
+        uint8_t * big = sut.allocate(100);
+        // Assert
+        REQUIRE( first != 0 );
+        REQUIRE( second != 0 );
+        REQUIRE( big != 0 );
+        REQUIRE( second != first + 12 );
+        REQUIRE( sut.used() == 124 );
+    }
+    SECTION("reset reuses memory")
+    {
+        // Arrange
+        Arena sut(16);
+        uint8_t * first = sut.allocate(12);
+        sut.allocate(12);
+        // Act
+        sut.reset();
+        // Assert
+        REQUIRE( sut.used() == 0 );
+        REQUIRE( sut.allocate(12) == first );
+    }
+    SECTION("fixed arena never grows")
+    {
+        // Arrange
+        uint8_t memory[10];
+        Arena sut(memory,sizeof(memory));
+        // Act & Assert
+        REQUIRE( sut.allocate(6) == memory );
+        REQUIRE( sut.allocate(6) == 0 );
+        REQUIRE( sut.allocate(4) == memory + 6 );
+        REQUIRE( sut.allocate(1) == 0 );
+    }
+    SECTION("scope frees what was allocated inside it")
+    {
+        // Arrange
+        uint8_t memory[10];
+        Arena sut(memory,sizeof(memory));
+        sut.allocate(2);
+        // Act
+        {
+            Arena::Scope scope(sut);
+            sut.allocate(8);
+            REQUIRE( sut.used() == 10 );
+        }
+        // Assert
+        REQUIRE( sut.used() == 2 );
+        REQUIRE( sut.allocate(8) == memory + 2 );
+    }
+}
@@ -78,4 +78,22 @@ TEST_CASE("heapbytebuffer","")
             REQUIRE( sut.chunkBytes(i) == (i+1) );
         }
     }
+    SECTION("adding and clearing change the generation")
+    {
+        // Arrange
+        HeapByteBuffer sut;
+        uint32_t empty = sut.generation();
+        // Act
+        sut.add(castToBytes("ABC"),3);
+        uint32_t added = sut.generation();
+        uint8_t byte = sut[1];
+        uint32_t read = sut.generation();
+        sut.clear();
+        uint32_t cleared = sut.generation();
+        // Assert
+        REQUIRE( added != empty );
+        REQUIRE( byte == 'B' );
+        REQUIRE( read == added );
+        REQUIRE( cleared != added );
+    }
 }
@@ -0,0 +1,141 @@
+// This software is part of OpenMono, see http://developer.openmono.com
+// Released under the MIT license, see LICENSE.txt
+#include "catch.hpp"
+#include "util.hpp"
+#include "cbor.hpp"
+#include "heapbytebuffer.hpp"
+#include "jsonparser.hpp"
+
+#define STREQUAL(x,y) std::string((char*)x) == std::string((char*)y)
+
+namespace {
+
+void addBytes (HeapByteBuffer & buffer, uint8_t const * bytes, size_t length)
+{
+    buffer.add(copyBytes(std::string((char const *)bytes,length)),length);
+}
+
+class Recorder
+:
+    public json::IJsonVisitor
+{
+public:
+    std::string calls;
+    virtual void startObject (json::JsonContext const & context) { calls += "{"; }
+    virtual void endObject (json::JsonContext const & context) { calls += "}"; }
+    virtual void startArray (json::JsonContext const & context) { calls += "["; }
+    virtual void endArray (json::JsonContext const & context) { calls += "]"; }
+    virtual void key (JSONToken const & key, size_t depth)
+    {
+        calls += std::string((char const *)key.start,key.end-key.start) + ":";
+    }
+    virtual void value (JSONToken const & value, json::JsonContext const & context)
+    {
+        calls += std::string((char const *)value.start,value.end-value.start) + ",";
+    }
+};
+
+} // namespace {
+
+TEST_CASE("cbor","")
+{
+    using namespace cbor;
+
+    SECTION("look up the same values as in JSON")
+    {
+        // Arrange
+        std::string forecastJson = readFile(FIXTUREDIR "/forecast.json");
+        std::string forecastCbor = readFile(FIXTUREDIR "/forecast.cbor");
+        HeapByteBuffer jsonBuffer, cborBuffer;
+        jsonBuffer.add(copyBytes(forecastJson),forecastJson.size());
+        // Split the document where items and their heads straddle chunks.
+        for (size_t position = 0; position < forecastCbor.size(); position += 37)
+        {
+            size_t length = std::min<size_t>(37,forecastCbor.size()-position);
+            addBytes(cborBuffer,castToBytes(forecastCbor)+position,length);
+        }
+        json::Json json(jsonBuffer);
+        char const * paths[] =
+        {
+            "/city/name", "/city/coord/lat", "/cnt", "/list/0/dt", "/list/12/rain/3h",
+            "/list/36/main/temp", "/list/3/weather/0/icon", "/list/36/wind/speed",
+        };
+        // Act
+        Cbor sut(cborBuffer);
+        // Assert
+        REQUIRE( Cbor::isCbor(cborBuffer) );
+        REQUIRE_FALSE( Cbor::isCbor(jsonBuffer) );
+        for (size_t i = 0; i < sizeof(paths)/sizeof(paths[0]); ++i)
+        {
+            INFO(paths[i]);
+            REQUIRE(STREQUAL( sut.lookup(paths[i]), json.lookup(paths[i]) ));
+        }
+        REQUIRE( sut.lookup("/city/missing") == 0 );
+        REQUIRE( sut.lookup("/list/37/dt") == 0 );
+        REQUIRE( sut.lookup("/city") == 0 );
+        REQUIRE(STREQUAL( sut.lookup(json::JsonPath("/list/#/dt"),36), json.lookup("/list/36/dt") ));
+        REQUIRE( sut.lookupArraySize("/list") == 37 );
+        REQUIRE( sut.lookupArraySize("/list/0/weather") == 1 );
+        REQUIRE( sut.lookupArraySize("/city") == 0 );
+    }
+
+    SECTION("convert values to JSON text")
+    {
+        // Arrange
+        uint8_t const document[] =
+        {
+            0xa8,                                       // map of 8 pairs
+            0x61, 'h', 0xf9, 0x3e, 0x00,                // "h": 1.5 as half
+            0x61, 'f', 0xfa, 0x3f, 0x8c, 0xcc, 0xcd,    // "f": 1.1 as single
+            0x61, 'n', 0x38, 0x63,                      // "n": -100
+            0x61, 'b', 0x3b, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff,
+            0x61, 's', 0x7f, 0x62, 'a', '"', 0x61, 0x0a, 0xff,  // "s": indefinite "a\"\n"
+            0x61, 't', 0xc1, 0x1a, 0x59, 0x00, 0x00, 0x00,      // "t": tagged time
+            0x61, 'i', 0xfa, 0x7f, 0x80, 0x00, 0x00,    // "i": infinity
+            0x61, 'a', 0x9f, 0xf5, 0xf4, 0xf6, 0xff,    // "a": [true,false,null]
+        };
+        HeapByteBuffer buffer;
+        addBytes(buffer,document,sizeof(document));
+        Recorder recorder;
+        // Act
+        Cbor sut(buffer);
+        bool visited = sut.visit(recorder);
+        // Assert
+        REQUIRE(STREQUAL( sut.lookup("/h"), "1.5" ));
+        REQUIRE(STREQUAL( sut.lookup("/f"), "1.1" ));
+        REQUIRE(STREQUAL( sut.lookup("/n"), "-100" ));
+        REQUIRE(STREQUAL( sut.lookup("/b"), "-18446744073709551616" ));
+        REQUIRE(STREQUAL( sut.lookup("/s"), "a\"\n" ));
+        REQUIRE(STREQUAL( sut.lookup("/t"), "1493172224" ));
+        REQUIRE(STREQUAL( sut.lookup("/i"), "null" ));
+        REQUIRE(STREQUAL( sut.lookup("/a/0"), "true" ));
+        REQUIRE(STREQUAL( sut.lookup("/a/2"), "null" ));
+        REQUIRE( sut.lookup("/a/3") == 0 );
+        REQUIRE( sut.lookupArraySize("/a") == 3 );
+        REQUIRE( visited );
+        REQUIRE( recorder.calls ==
+            "{h:1.5,f:1.1,n:-100,b:-18446744073709551616,s:a\\\"\\u000a,"
+            "t:1493172224,i:null,a:[true,false,null,]}" );
+    }
+
+    SECTION("reject broken documents")
+    {
+        // Arrange
+        uint8_t const truncated[] = { 0x82, 0x01 };
+        uint8_t const reserved[] = { 0x81, 0x1c };
+        uint8_t const huge[] = { 0x81, 0x5b, 0x7f, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff };
+        HeapByteBuffer truncatedBuffer, reservedBuffer, hugeBuffer;
+        addBytes(truncatedBuffer,truncated,sizeof(truncated));
+        addBytes(reservedBuffer,reserved,sizeof(reserved));
+        addBytes(hugeBuffer,huge,sizeof(huge));
+        Recorder recorder;
+        // Act
+        Cbor sut(truncatedBuffer);
+        // Assert
+        REQUIRE_FALSE( sut.visit(recorder) );
+        REQUIRE( sut.lookup("/1") == 0 );
+        REQUIRE( Cbor(reservedBuffer).lookup("/0") == 0 );
+        REQUIRE( Cbor(hugeBuffer).lookup("/0") == 0 );
+        REQUIRE_FALSE( Cbor(hugeBuffer).visit(recorder) );
+    }
+}
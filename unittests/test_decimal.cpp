@@ -0,0 +1,209 @@
+// This software is part of OpenMono, see http://developer.openmono.com
+// Released under the MIT license, see LICENSE.txt
+#include "catch.hpp"
+#include "util.hpp"
+#include "decimal.hpp"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <vector>
+
+namespace
+{
+    bool fixed (char const * text, unsigned decimals, int32_t expected)
+    {
+        int32_t result = 0;
+        return Decimal::toFixed((uint8_t const *)text,decimals,&result) && result == expected;
+    }
+
+    bool fixedFails (char const * text, unsigned decimals)
+    {
+        int32_t result = 0;
+        return ! Decimal::toFixed((uint8_t const *)text,decimals,&result);
+    }
+
+    bool unsignedFixed (char const * text, unsigned decimals, uint32_t expected)
+    {
+        uint32_t result = 1;
+        return Decimal::toFixed((uint8_t const *)text,decimals,&result) && result == expected;
+    }
+
+    bool unsignedFixedFails (char const * text, unsigned decimals)
+    {
+        uint32_t result = 0;
+        return ! Decimal::toFixed((uint8_t const *)text,decimals,&result);
+    }
+
+    /**
+     * @return true if toDouble gives exactly what strtod gives.
+     */
+    bool sameAsLibrary (char const * text)
+    {
+        double result = 0;
+        if (! Decimal::toDouble((uint8_t const *)text,strlen(text),&result)) return false;
+        double expected = strtod(text,0);
+        return memcmp(&result,&expected,sizeof(double)) == 0;
+    }
+
+    uint64_t nextRandom (uint64_t & state)
+    {
+        state ^= state << 13;
+        state ^= state >> 7;
+        state ^= state << 17;
+        return state;
+    }
+} // namespace
+
+TEST_CASE("decimal","")
+{
+    SECTION("fixed point")
+    {
+        REQUIRE( fixed("288.78",2,28878) );
+        REQUIRE( fixed("288.78",0,289) );
+        REQUIRE( fixed("288.78",1,2888) );
+        REQUIRE( fixed("3.1",3,3100) );
+        REQUIRE( fixed("0",2,0) );
+        REQUIRE( fixed("-0.5",0,-1) );
+        REQUIRE( fixed("-0.49",0,0) );
+        REQUIRE( fixed("0.005",2,1) );
+        REQUIRE( fixed("0.0049999",2,0) );
+        REQUIRE( fixed("5e-4",3,1) );
+        REQUIRE( fixed("5e-4",2,0) );
+        REQUIRE( fixed("1.5E2",0,150) );
+        REQUIRE( fixed("12e+1",1,1200) );
+        REQUIRE( fixed("1483228800",0,1483228800) );
+        REQUIRE( fixed("2147483647",0,2147483647) );
+        REQUIRE( fixed("-2147483647",0,-2147483647) );
+        REQUIRE( fixed("0e100000000",2,0) );
+        REQUIRE( fixed("1e-100000000",2,0) );
+    }
+    SECTION("fixed point that does not fit")
+    {
+        REQUIRE( fixedFails("2147483648",0) );
+        REQUIRE( fixedFails("2147483647.5",0) );
+        REQUIRE( fixedFails("21474837",2) );
+        REQUIRE( fixedFails("1e10",0) );
+    }
+    SECTION("unsigned fixed point")
+    {
+        REQUIRE( unsignedFixed("2200000000",0,2200000000u) );
+        REQUIRE( unsignedFixed("4294967295",0,4294967295u) );
+        REQUIRE( unsignedFixed("42949672.95",2,4294967295u) );
+        REQUIRE( unsignedFixed("-0",0,0) );
+        REQUIRE( unsignedFixedFails("4294967296",0) );
+        REQUIRE( unsignedFixedFails("4294967295.5",0) );
+        REQUIRE( unsignedFixedFails("-1",0) );
+        REQUIRE( unsignedFixedFails("-0.5",0) );
+    }
+    SECTION("not numbers")
+    {
+        REQUIRE( fixedFails("",0) );
+        REQUIRE( fixedFails("-",0) );
+        REQUIRE( fixedFails("+1",0) );
+        REQUIRE( fixedFails("01",0) );
+        REQUIRE( fixedFails("1.",0) );
+        REQUIRE( fixedFails(".5",0) );
+        REQUIRE( fixedFails("1e",0) );
+        REQUIRE( fixedFails("1e+",0) );
+        REQUIRE( fixedFails("12a",0) );
+        REQUIRE( fixedFails("rain",0) );
+        double result;
+        REQUIRE( ! Decimal::toDouble((uint8_t const *)"1.2.3",5,&result) );
+    }
+    SECTION("from tokens")
+    {
+        // Arrange
+        std::string document = "[-12.25]";
+        JSONParser parser;
+        InitialiseJSONParser(&parser);
+        ProvideJSONInput(&parser,castToBytes(document),document.size());
+        NextJSONToken(&parser);
+        JSONToken token = NextJSONToken(&parser);
+        int32_t fixedResult = 0;
+        double doubleResult = 0;
+        // Act
+        bool fixedOk = Decimal::toFixed(token,1,&fixedResult);
+        bool doubleOk = Decimal::toDouble(token,&doubleResult);
+        // Assert
+        REQUIRE( fixedOk );
+        REQUIRE( fixedResult == -123 );
+        REQUIRE( doubleOk );
+        REQUIRE( doubleResult == -12.25 );
+    }
+    SECTION("doubles are rounded like strtod")
+    {
+        char const * numbers[] =
+        {
+            "0", "-0", "288.78", "0.1", "0.3", "1e23", "8.98846567431158e307",
+            "1.7976931348623157e308", "4.9406564584124654e-324", "2.2250738585072014e-308",
+            "9007199254740993", "9007199254740992.5", "123456789012345678901234567890",
+            "0.000000000000000000000000000000000000000000000000000000000000000000001",
+            "1e-64", "1e64", "7.2057594037927933e16", "3.0517578125e-5", "1e400", "-1e-400"
+        };
+        for (size_t i = 0; i < sizeof(numbers)/sizeof(numbers[0]); ++i)
+        {
+            INFO( numbers[i] );
+            REQUIRE( sameAsLibrary(numbers[i]) );
+        }
+    }
+    SECTION("random doubles are rounded like strtod")
+    {
+        uint64_t state = 88172645463325252ULL;
+        for (size_t i = 0; i < 200000; ++i)
+        {
+            char text[64];
+            uint64_t significand = nextRandom(state) >> (nextRandom(state) % 64);
+            int exponent = int(nextRandom(state) % 160) - 80;
+            sprintf(text,"%llue%d",(unsigned long long)significand,exponent);
+            INFO( text );
+            REQUIRE( sameAsLibrary(text) );
+            double value;
+            memcpy(&value,&significand,sizeof(value));
+            if (value != value || value - value != 0) continue;
+            sprintf(text,"%.17g",value);
+            INFO( text );
+            REQUIRE( sameAsLibrary(text) );
+        }
+    }
+}
+
+TEST_CASE("decimal throughput","[.][benchmark]")
+{
+    std::vector<std::string> numbers;
+    char text[32];
+    for (int i = 0; i < 1000; ++i)
+    {
+        sprintf(text,"%d.%02d",200 + i % 120,i % 100);
+        numbers.push_back(text);
+    }
+    size_t const rounds = 2000;
+    double sums[3] = { 0, 0, 0 };
+    clock_t start = clock();
+    for (size_t round = 0; round < rounds; ++round)
+        for (size_t i = 0; i < numbers.size(); ++i) sums[0] += atof(numbers[i].c_str());
+    clock_t library = clock();
+    for (size_t round = 0; round < rounds; ++round)
+        for (size_t i = 0; i < numbers.size(); ++i)
+        {
+            double value;
+            Decimal::toDouble(castToBytes(numbers[i]),numbers[i].size(),&value);
+            sums[1] += value;
+        }
+    clock_t fast = clock();
+    for (size_t round = 0; round < rounds; ++round)
+        for (size_t i = 0; i < numbers.size(); ++i)
+        {
+            int32_t value;
+            Decimal::toFixed(castToBytes(numbers[i]),numbers[i].size(),2,&value);
+            sums[2] += value / 100.0;
+        }
+    clock_t fixedEnd = clock();
+    double count = double(rounds) * numbers.size() / 1e6;
+    printf("atof %.1f, toDouble %.1f, toFixed %.1f million numbers/s\n",
+        count / (double(library - start) / CLOCKS_PER_SEC),
+        count / (double(fast - library) / CLOCKS_PER_SEC),
+        count / (double(fixedEnd - fast) / CLOCKS_PER_SEC));
+    REQUIRE( sums[0] == sums[1] );
+    REQUIRE( sums[2] > 0 );
+}
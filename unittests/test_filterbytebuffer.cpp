@@ -0,0 +1,196 @@
+// This software is part of OpenMono, see http://developer.openmono.com
+// Released under the MIT license, see LICENSE.txt
+#include "catch.hpp"
+#include "util.hpp"
+#include "filterbytebuffer.hpp"
+#include "heapbytebuffer.hpp"
+#include "jsonparser.hpp"
+#include <stdio.h>
+
+#define STREQUAL(x,y) std::string((char*)x) == std::string((char*)y)
+
+namespace
+{
+    std::string contents (IByteBuffer const & buffer)
+    {
+        std::string result;
+        for (size_t i = 0; i < buffer.chunks(); ++i)
+            result.append((char const *)buffer.chunk(i),buffer.chunkBytes(i));
+        return result;
+    }
+} // namespace
+
+TEST_CASE("filterbytebuffer","")
+{
+    SECTION("keep only values on paths as minified JSON")
+    {
+        // Arrange
+        std::string document =
+            "{ \"city\": { \"id\": 1, \"name\": \"London\" },\n"
+            "  \"list\": [ { \"dt\": 10, \"sys\": { \"pod\": \"d\" }, \"wind\": { \"speed\": 2.9, \"deg\": 307 } },\n"
+            "            { \"dt\": 20, \"dt_txt\": \"2016-05-16\", \"rain\": {} } ],\n"
+            "  \"cod\": \"200\" }";
+        HeapByteBuffer sink;
+        FilterByteBuffer sut(sink);
+        sut.keep("/city/name");
+        sut.keep("/list/*/dt");
+        sut.keep("/list/*/wind");
+        sut.keep("/list/1/rain");
+        // Act
+        for (size_t i = 0; i < document.size(); i += 5)
+            sut.add(castToBytes(document)+i,std::min<size_t>(5,document.size()-i));
+        // Assert
+        REQUIRE( sut.isDone() );
+        REQUIRE( contents(sut) ==
+            "{\"city\":{\"name\":\"London\"},"
+            "\"list\":[{\"dt\":10,\"wind\":{\"speed\":2.9,\"deg\":307}},{\"dt\":20,\"rain\":{}}]}" );
+    }
+    SECTION("nothing kept gives an empty document")
+    {
+        // Arrange
+        std::string document = "{\"a\":[1,2],\"b\":{\"c\":true}}";
+        HeapByteBuffer sink;
+        FilterByteBuffer sut(sink);
+        sut.keep("/d");
+        // Act
+        sut.add(castToBytes(document),document.size());
+        // Assert
+        REQUIRE( sut.isDone() );
+        REQUIRE( sut.bytes() == 0 );
+    }
+    SECTION("clear starts a new document")
+    {
+        // Arrange
+        std::string first = "[1,2,3]";
+        std::string second = "[4,5,6]";
+        HeapByteBuffer sink;
+        FilterByteBuffer sut(sink);
+        sut.keep("/1");
+        sut.add(castToBytes(first),first.size());
+        // Act
+        sut.clear();
+        sut.add(castToBytes(second),second.size());
+        // Assert
+        REQUIRE( contents(sut) == "[null,5]" );
+    }
+    SECTION("dropped elements before kept ones keep their index")
+    {
+        // Arrange
+        std::string document = "{\"list\":[{\"a\":1},{\"b\":2},{\"a\":3,\"b\":4},{\"b\":5}]}";
+        HeapByteBuffer sink;
+        FilterByteBuffer sut(sink);
+        sut.keep("/list/*/a");
+        json::Json filtered(sut);
+        // Act
+        sut.add(castToBytes(document),document.size());
+        bool ok = sut.finish();
+        // Assert
+        REQUIRE( ok );
+        REQUIRE( contents(sut) == "{\"list\":[{\"a\":1},null,{\"a\":3}]}" );
+        REQUIRE(STREQUAL( filtered.lookup("/list/2/a"), "3" ));
+    }
+    SECTION("a cut off document is not kept")
+    {
+        // Arrange
+        std::string document = "{\"city\":{\"name\":\"London\"},\"list\":[{\"dt\":10},{\"dt\":";
+        HeapByteBuffer sink;
+        FilterByteBuffer sut(sink);
+        sut.keep("/city/name");
+        sut.keep("/list/*/dt");
+        sut.add(castToBytes(document),document.size());
+        // Act
+        bool ok = sut.finish();
+        // Assert
+        REQUIRE_FALSE( ok );
+        REQUIRE( sut.isBroken() );
+        REQUIRE( sut.bytes() == 0 );
+    }
+    SECTION("a broken document is not kept")
+    {
+        // Arrange
+        std::string document = "{\"city\":{\"name\":\"London\"},\"list\":[}";
+        HeapByteBuffer sink;
+        FilterByteBuffer sut(sink);
+        sut.keep("/city/name");
+        // Act
+        sut.add(castToBytes(document),document.size());
+        // Assert
+        REQUIRE( sut.isBroken() );
+        REQUIRE_FALSE( sut.finish() );
+        REQUIRE( sut.bytes() == 0 );
+    }
+    SECTION("a kept string too long to hold is not truncated")
+    {
+        // Arrange
+        std::string name(MAX_PUSH_TOKENSIZE - 8,'x');
+        name += "\\u00e6\\u00f8\\u00e5";
+        std::string document = "{\"city\":{\"name\":\"" + name + "\"}}";
+        HeapByteBuffer sink;
+        FilterByteBuffer sut(sink);
+        sut.keep("/city/name");
+        // Act
+        for (size_t i = 0; i < document.size(); i += 5)
+            sut.add(castToBytes(document)+i,std::min<size_t>(5,document.size()-i));
+        bool ok = sut.finish();
+        // Assert
+        REQUIRE_FALSE( ok );
+        REQUIRE( sut.bytes() == 0 );
+    }
+    SECTION("a long string that is not kept does no harm")
+    {
+        // Arrange
+        std::string document = "{\"city\":{\"name\":\"London\",\"note\":\"" + std::string(200,'x') + "\\n\"}}";
+        HeapByteBuffer sink;
+        FilterByteBuffer sut(sink);
+        sut.keep("/city/name");
+        // Act
+        for (size_t i = 0; i < document.size(); i += 5)
+            sut.add(castToBytes(document)+i,std::min<size_t>(5,document.size()-i));
+        bool ok = sut.finish();
+        // Assert
+        REQUIRE( ok );
+        REQUIRE( contents(sut) == "{\"city\":{\"name\":\"London\"}}" );
+    }
+    SECTION("filtered forecast parses the same and is much smaller")
+    {
+        // Arrange
+        std::string forecast = readFile(FIXTUREDIR "/forecast.json");
+        HeapByteBuffer original;
+        original.add(copyBytes(forecast),forecast.size());
+        HeapByteBuffer sink;
+        FilterByteBuffer sut(sink);
+        sut.keep("/city/name");
+        sut.keep("/list/*/dt");
+        sut.keep("/list/*/main/temp");
+        sut.keep("/list/*/main/humidity");
+        sut.keep("/list/*/main/pressure");
+        sut.keep("/list/*/clouds/all");
+        sut.keep("/list/*/wind");
+        sut.keep("/list/*/weather/0/icon");
+        sut.keep("/list/*/rain");
+        json::Json expected(original);
+        json::Json filtered(sut);
+        char const * fields[] = { "dt", "main/temp", "main/humidity", "clouds/all", "wind/deg", "weather/0/icon", "rain/3h" };
+        // Act
+        for (size_t i = 0; i < forecast.size(); i += 256)
+            sut.add(castToBytes(forecast)+i,std::min<size_t>(256,forecast.size()-i));
+        // Assert
+        REQUIRE( sut.finish() );
+        REQUIRE( sut.isDone() );
+        REQUIRE( sut.bytes() * 3 < forecast.size() );
+        REQUIRE(STREQUAL( filtered.lookup("/city/name"), "London" ));
+        REQUIRE( filtered.lookupArraySize("/list") == 37 );
+        REQUIRE( filtered.lookup("/list/0/sys/pod") == 0 );
+        for (size_t i = 0; i < 37; ++i)
+        {
+            for (size_t field = 0; field < sizeof(fields)/sizeof(fields[0]); ++field)
+            {
+                char path[48];
+                sprintf(path,"/list/%u/%s",(unsigned)i,fields[field]);
+                uint8_t const * value = expected.lookup(path);
+                if (0 == value) REQUIRE( filtered.lookup(path) == 0 );
+                else REQUIRE(STREQUAL( filtered.lookup(path), value ));
+            }
+        }
+    }
+}
@@ -0,0 +1,133 @@
+// This software is part of OpenMono, see http://developer.openmono.com
+// Released under the MIT license, see LICENSE.txt
+#include "catch.hpp"
+#include "util.hpp"
+#include "forecastseries.hpp"
+#include <stdio.h>
+#include <time.h>
+
+TEST_CASE("forecastseries","")
+{
+    using namespace weather;
+
+    SECTION("keep entries in columns")
+    {
+        // Arrange
+        ForecastSeries sut;
+        Entry first = makeEntry(1463400000,28878,292,0);
+        Entry second = makeEntry(1463410800,28512,515,5);
+        // Act
+        sut.add(first);
+        sut.add(second);
+        // Assert
+        REQUIRE( sut.size() == 2 );
+        REQUIRE( sut.entry(0) == first );
+        REQUIRE( sut.entry(1) == second );
+        REQUIRE( sut.city() == first.city );
+        REQUIRE( sut.timesUnix()[1] == 1463410800 );
+        REQUIRE( sut.temperaturesCentiK()[0] == 28878 );
+        REQUIRE( sut.rainsCentiMm()[1] == 5 );
+        REQUIRE( sut.conditions()[0] == Day_Rain );
+        REQUIRE( sut.rainFlags()[0] == 0 );
+        REQUIRE( sut.rainFlags()[1] == 1 );
+    }
+
+    SECTION("compute over the whole series")
+    {
+        // Arrange
+        ForecastSeries sut;
+        uint16_t const temperatures[] = { 28878, 27315, 29010, 28000 };
+        uint16_t const winds[] = { 292, 1210, 515, 0 };
+        uint16_t const rains[] = { 0, 5, 120, 7 };
+        for (size_t i = 0; i < 4; ++i) sut.add(makeEntry(1463400000 + i * 10800,temperatures[i],winds[i],rains[i]));
+        uint16_t lowest = 0, highest = 0;
+        // Act
+        bool ok = sut.temperatureRange(&lowest,&highest);
+        // Assert
+        REQUIRE( ok );
+        REQUIRE( lowest == 27315 );
+        REQUIRE( highest == 29010 );
+        REQUIRE( sut.totalRainCentiMm() == 132 );
+        REQUIRE( sut.highestWindSpeedCentiMs() == 1210 );
+    }
+
+    SECTION("leave out missing temperatures")
+    {
+        // Arrange
+        ForecastSeries sut;
+        uint16_t const temperatures[] = { 28878, 0, 29010, 0, 28000 };
+        for (size_t i = 0; i < 5; ++i) sut.add(makeEntry(1463400000 + i * 10800,temperatures[i]));
+        for (size_t i = 0; i < 40; ++i) sut.add(makeEntry(1463454000 + i * 10800,0));
+        ForecastSeries missing;
+        missing.add(makeEntry(1463400000,0));
+        uint16_t lowest = 0, highest = 0;
+        // Act
+        bool ok = sut.temperatureRange(&lowest,&highest);
+        bool none = missing.temperatureRange(&lowest,&highest);
+        // Assert
+        REQUIRE( ok );
+        REQUIRE( lowest == 28000 );
+        REQUIRE( highest == 29010 );
+        REQUIRE_FALSE( none );
+    }
+
+    SECTION("empty series")
+    {
+        // Arrange
+        ForecastSeries sut;
+        sut.add(makeEntry(1463400000,28878,292,0));
+        uint16_t lowest = 1, highest = 1;
+        // Act
+        sut.clear();
+        // Assert
+        REQUIRE( sut.size() == 0 );
+        REQUIRE( sut.city() == 0 );
+        REQUIRE( sut.temperaturesCentiK() == 0 );
+        REQUIRE_FALSE( sut.temperatureRange(&lowest,&highest) );
+        REQUIRE( sut.totalRainCentiMm() == 0 );
+        REQUIRE( sut.highestWindSpeedCentiMs() == 0 );
+    }
+}
+
+TEST_CASE("forecastseries throughput","[.][benchmark]")
+{
+    using namespace weather;
+    size_t const entries = 100000;
+    size_t const rounds = 200;
+    std::vector<Entry> rows;
+    ForecastSeries series;
+    series.reserve(entries);
+    for (size_t i = 0; i < entries; ++i)
+    {
+        Entry entry = makeEntry(1463400000 + i * 10800,27315 + (i * 7919) % 3000,(i * 104729) % 2000,i % 13);
+        rows.push_back(entry);
+        series.add(entry);
+    }
+    uint32_t checkRows = 0, checkSeries = 0;
+    clock_t start = clock();
+    for (size_t round = 0; round < rounds; ++round)
+    {
+        uint16_t low = rows[0].temperatureCentiK, high = low;
+        uint32_t rain = 0;
+        for (size_t i = 0; i < rows.size(); ++i)
+        {
+            low = rows[i].temperatureCentiK < low ? rows[i].temperatureCentiK : low;
+            high = rows[i].temperatureCentiK > high ? rows[i].temperatureCentiK : high;
+            rain += rows[i].rainCentiMm;
+        }
+        checkRows += low + high + rain;
+    }
+    clock_t rowsEnd = clock();
+    for (size_t round = 0; round < rounds; ++round)
+    {
+        uint16_t low = 0, high = 0;
+        series.temperatureRange(&low,&high);
+        checkSeries += low + high + series.totalRainCentiMm();
+    }
+    clock_t seriesEnd = clock();
+    printf("temperature range and rain of %u entries: rows %.1f M/s, series %.1f M/s\n",
+        (unsigned)entries,
+        rounds * entries / (double(rowsEnd - start) / CLOCKS_PER_SEC) / 1e6,
+        rounds * entries / (double(seriesEnd - rowsEnd) / CLOCKS_PER_SEC) / 1e6);
+    REQUIRE( checkRows == checkSeries );
+}
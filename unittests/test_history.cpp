@@ -0,0 +1,325 @@
+// This software is part of OpenMono, see http://developer.openmono.com
+// Released under the MIT license, see LICENSE.txt
+#include "catch.hpp"
+#include "util.hpp"
+#include "history.hpp"
+#include "filesegmentstore.hpp"
+#include <map>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+namespace {
+
+/**
+ * Segments in memory that count the reads.
+ */
+struct MemorySegmentStore
+:
+    public ISegmentStore
+{
+    MemorySegmentStore () : reads(0) {}
+    virtual void segments (std::vector<uint32_t> & numbers)
+    {
+        numbers.clear();
+        for (std::map<uint32_t,std::vector<uint8_t> >::iterator i = files.begin(); i != files.end(); ++i)
+            numbers.push_back(i->first);
+    }
+    virtual size_t bytes (uint32_t segment)
+    {
+        return files.count(segment) ? files[segment].size() : 0;
+    }
+    virtual bool read (uint32_t segment, size_t offset, uint8_t * destination, size_t length)
+    {
+        ++reads;
+        if (files.count(segment) == 0 || offset + length > files[segment].size()) return false;
+        memcpy(destination,&files[segment][offset],length);
+        return true;
+    }
+    virtual bool append (uint32_t segment, uint8_t const * source, size_t length)
+    {
+        files[segment].insert(files[segment].end(),source,source + length);
+        return true;
+    }
+    virtual bool remove (uint32_t segment)
+    {
+        return files.erase(segment) == 1;
+    }
+    virtual bool rename (uint32_t from, uint32_t to)
+    {
+        if (files.count(from) == 0 || files.count(to) != 0) return false;
+        files[to].swap(files[from]);
+        files.erase(from);
+        return true;
+    }
+    std::map<uint32_t,std::vector<uint8_t> > files;
+    size_t reads;
+};
+
+} // namespace {
+
+TEST_CASE("history","")
+{
+    using namespace weather;
+    uint32_t const start = 1463400000;
+    uint32_t const step = 10800;
+
+    SECTION("find entries in a time range")
+    {
+        // Arrange
+        MemorySegmentStore store;
+        History sut(store);
+        sut.open();
+        for (uint32_t i = 0; i < 1000; ++i) sut.append(makeEntry(start + i * step,27315 + i));
+        std::vector<Entry> entries;
+        // Act
+        bool ok = sut.query(start + 500 * step,start + 510 * step,entries);
+        // Assert
+        REQUIRE( ok );
+        REQUIRE( sut.size() == 1000 );
+        REQUIRE( sut.segments() == 4 );
+        REQUIRE( sut.lastTime() == start + 999 * step );
+        REQUIRE( entries.size() == 10 );
+        REQUIRE( entries[0] == makeEntry(start + 500 * step,27815) );
+        REQUIRE( entries[9] == makeEntry(start + 509 * step,27824) );
+    }
+
+    SECTION("read a few blocks for a query")
+    {
+        // Arrange
+        MemorySegmentStore store;
+        History sut(store);
+        sut.open();
+        for (uint32_t i = 0; i < 5000; ++i) sut.append(makeEntry(start + i * step,27315));
+        std::vector<Entry> few, many, none;
+        // Act
+        store.reads = 0;
+        sut.query(start + 3000 * step,start + 3005 * step,few);
+        size_t fewReads = store.reads;
+        store.reads = 0;
+        sut.query(start + 1000 * step,start + 1160 * step,many);
+        size_t manyReads = store.reads;
+        store.reads = 0;
+        sut.query(start + 9000 * step,start + 9100 * step,none);
+        size_t noReads = store.reads;
+        // Assert
+        REQUIRE( few.size() == 5 );
+        REQUIRE( fewReads <= 2 );
+        REQUIRE( many.size() == 160 );
+        REQUIRE( manyReads <= 160 / HISTORY_BLOCK_RECORDS + 2 );
+        REQUIRE( none.empty() );
+        REQUIRE( noReads <= 1 );
+    }
+
+    SECTION("keep the order of time")
+    {
+        // Arrange
+        MemorySegmentStore store;
+        History sut(store);
+        sut.open();
+        sut.append(makeEntry(start + step,27315));
+        // Act
+        bool older = sut.append(makeEntry(start,27315));
+        bool same = sut.append(makeEntry(start + step,27415));
+        // Assert
+        REQUIRE_FALSE( older );
+        REQUIRE( same );
+        REQUIRE( sut.size() == 2 );
+    }
+
+    SECTION("start a run no earlier than the run before")
+    {
+        // Arrange
+        MemorySegmentStore store;
+        History sut(store);
+        sut.open();
+        for (uint32_t i = 0; i < 10; ++i) sut.append(makeEntry(start + (2 + i) * step,27315));
+        // Act
+        bool rewind = sut.append(makeEntry(start + 3 * step,27415));
+        bool next = sut.append(makeEntry(start + 4 * step,27415));
+        bool beforeRun = sut.append(makeEntry(start + 2 * step,27415));
+        // Assert
+        REQUIRE( rewind );
+        REQUIRE( next );
+        REQUIRE_FALSE( beforeRun );
+        REQUIRE( sut.runTime() == start + 3 * step );
+        REQUIRE( sut.lastTime() == start + 4 * step );
+    }
+
+    SECTION("find and compact the entries of overlapping refreshes")
+    {
+        // Arrange
+        MemorySegmentStore store;
+        History sut(store);
+        sut.open();
+        // Refresh r forecasts the times r to r + 39.
+        for (uint32_t r = 0; r < 21; ++r)
+            for (uint32_t i = 0; i < 40; ++i)
+                REQUIRE( sut.append(makeEntry(start + (r + i) * step,27315 + r)) );
+        std::vector<Entry> all, compacted;
+        // Act
+        sut.query(start,start + 10 * step,all);
+        bool ok = sut.compact(start);
+        sut.query(start,start + 10 * step,compacted);
+        History reopened(store);
+        reopened.open();
+        // Assert
+        REQUIRE( all.size() == 55 );
+        REQUIRE( ok );
+        REQUIRE( sut.size() < 21 * 40 );
+        REQUIRE( reopened.size() == sut.size() );
+        REQUIRE( reopened.runTime() == start + 20 * step );
+        REQUIRE( compacted.size() == 10 );
+        // The latest refresh for a time supersedes the others.
+        for (uint32_t i = 0; i < compacted.size(); ++i)
+            REQUIRE( compacted[i] == makeEntry(start + i * step,27315 + i) );
+    }
+
+    SECTION("open what was written before")
+    {
+        // Arrange
+        MemorySegmentStore store;
+        History first(store);
+        first.open();
+        for (uint32_t i = 0; i < 300; ++i) first.append(makeEntry(start + i * step,27315 + i));
+        History sut(store);
+        std::vector<Entry> entries;
+        // Act
+        bool ok = sut.open();
+        sut.append(makeEntry(start + 300 * step,27615));
+        sut.query(start + 290 * step,start + 400 * step,entries);
+        // Assert
+        REQUIRE( ok );
+        REQUIRE( sut.size() == 301 );
+        REQUIRE( sut.segments() == 2 );
+        REQUIRE( sut.lastTime() == start + 300 * step );
+        REQUIRE( entries.size() == 11 );
+        REQUIRE( entries[10] == makeEntry(start + 300 * step,27615) );
+    }
+
+    SECTION("leave a partly written record behind")
+    {
+        // Arrange
+        MemorySegmentStore store;
+        History first(store);
+        first.open();
+        for (uint32_t i = 0; i < 10; ++i) first.append(makeEntry(start + i * step,27315));
+        store.files[0].push_back(0x42);
+        History sut(store);
+        std::vector<Entry> entries;
+        // Act
+        sut.open();
+        sut.append(makeEntry(start + 10 * step,27315));
+        sut.query(start,start + 20 * step,entries);
+        // Assert
+        REQUIRE( sut.segments() == 2 );
+        REQUIRE( store.files[1].size() == HISTORY_RECORD_BYTES );
+        REQUIRE( entries.size() == 11 );
+    }
+
+    SECTION("compact old and superseded entries")
+    {
+        // Arrange
+        MemorySegmentStore store;
+        History sut(store);
+        sut.open();
+        for (uint32_t i = 0; i < 600; ++i)
+        {
+            // Each refresh forecasts the next time again.
+            sut.append(makeEntry(start + i * step,27315));
+            sut.append(makeEntry(start + (i + 1) * step,27415));
+        }
+        std::vector<Entry> entries;
+        // Act
+        bool ok = sut.compact(start + 300 * step);
+        sut.query(start,start + 1000 * step,entries);
+        // Assert
+        REQUIRE( ok );
+        REQUIRE( sut.segments() == 3 );
+        REQUIRE( store.files.count(0) == 0 );
+        REQUIRE( store.files.count(1) == 0 );
+        REQUIRE( entries.size() == 2 * HISTORY_SEGMENT_RECORDS / 2 + 1200 - 4 * HISTORY_SEGMENT_RECORDS );
+        REQUIRE( entries.front().timeUnix == start + 256 * step );
+        REQUIRE( entries.back().timeUnix == start + 600 * step );
+        // The last segment is left alone, the others keep one entry per time.
+        for (size_t i = 1; i < HISTORY_SEGMENT_RECORDS; ++i)
+        {
+            REQUIRE( entries[i].timeUnix == entries[i-1].timeUnix + step );
+            REQUIRE( entries[i].temperatureCentiK == 27315 );
+        }
+    }
+
+    SECTION("finish an interrupted compaction")
+    {
+        // Arrange
+        MemorySegmentStore store;
+        History first(store);
+        first.open();
+        for (uint32_t i = 0; i < 300; ++i) first.append(makeEntry(start + i * step,27315));
+        store.files[0 | HISTORY_SCRATCH_SEGMENT] = store.files[0];
+        store.files.erase(0);
+        store.files[1 | HISTORY_SCRATCH_SEGMENT].push_back(0x42);
+        History sut(store);
+        // Act
+        sut.open();
+        // Assert
+        REQUIRE( store.files.size() == 2 );
+        REQUIRE( sut.size() == 300 );
+        REQUIRE( sut.segments() == 2 );
+    }
+
+    SECTION("keep segments in files")
+    {
+        // Arrange
+        char directory[] = "/tmp/historyXXXXXX";
+        REQUIRE( mkdtemp(directory) != 0 );
+        FileSegmentStore store(directory);
+        History first(store);
+        first.open();
+        for (uint32_t i = 0; i < 300; ++i) first.append(makeEntry(start + i * step,27315 + i));
+        History sut(store);
+        std::vector<Entry> entries;
+        std::vector<uint32_t> numbers;
+        // Act
+        sut.open();
+        sut.query(start + 250 * step,start + 260 * step,entries);
+        store.segments(numbers);
+        // Assert
+        REQUIRE( sut.size() == 300 );
+        REQUIRE( entries.size() == 10 );
+        REQUIRE( entries[0] == makeEntry(start + 250 * step,27565) );
+        REQUIRE( numbers.size() == 2 );
+        REQUIRE( store.bytes(1) == 44 * HISTORY_RECORD_BYTES );
+        REQUIRE( store.rename(1,7) );
+        REQUIRE( store.bytes(1) == 0 );
+        for (size_t i = 0; i < numbers.size(); ++i) store.remove(i == 1 ? 7 : numbers[i]);
+        REQUIRE( rmdir(directory) == 0 );
+    }
+
+    SECTION("find segments with names in upper case")
+    {
+        // Arrange
+        char directory[] = "/tmp/historyXXXXXX";
+        REQUIRE( mkdtemp(directory) != 0 );
+        char const * names[] = { "0000002A.SEG", "0000002b.Seg", "0000002G.SEG", "+000002C.SEG", "0000002C.SEX" };
+        size_t const count = sizeof(names) / sizeof(names[0]);
+        for (size_t i = 0; i < count; ++i)
+        {
+            std::string path = std::string(directory) + "/" + names[i];
+            FILE * file = fopen(path.c_str(),"wb");
+            REQUIRE( file != 0 );
+            fclose(file);
+        }
+        FileSegmentStore sut(directory);
+        std::vector<uint32_t> numbers;
+        // Act
+        sut.segments(numbers);
+        // Assert
+        REQUIRE( numbers.size() == 2 );
+        REQUIRE( numbers[0] == 0x2a );
+        REQUIRE( numbers[1] == 0x2b );
+        for (size_t i = 0; i < count; ++i) remove((std::string(directory) + "/" + names[i]).c_str());
+        REQUIRE( rmdir(directory) == 0 );
+    }
+}
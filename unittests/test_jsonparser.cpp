@@ -4,6 +4,7 @@
 #include "util.hpp"
 #include "jsonparser.hpp"
 #include "heapbytebuffer.hpp"
+#include <time.h>
 
 #define STREQUAL(x,y) std::string((char*)x) == std::string((char*)y)
 
@@ -51,4 +52,614 @@ TEST_CASE("json","")
         REQUIRE( json.lookupArraySize("/list") == 37 );
         REQUIRE(STREQUAL( json.lookup("/list/1/main/humidity"), "59" ));
     }
+    SECTION("extract several values in one pass")
+    {
+        // Arrange
+        std::string part1 = readFile(FIXTUREDIR "/current-part1.json");
+        std::string part2 = readFile(FIXTUREDIR "/current-part2.json");
+        std::string part3 = readFile(FIXTUREDIR "/current-part3.json");
+        HeapByteBuffer buffer;
+        buffer.add(copyBytes(part1),part1.size());
+        buffer.add(copyBytes(part2),part2.size());
+        buffer.add(copyBytes(part3),part3.size());
+        using namespace json;
+        Json sut (buffer);
+        uint8_t const * name;
+        uint8_t const * temp;
+        uint8_t const * icon;
+        uint8_t const * rain;
+        uint8_t const * missing;
+        Extraction extraction;
+        extraction.add("/name",&name);
+        extraction.add("/main/temp",&temp);
+        extraction.add("/weather/0/icon",&icon);
+        extraction.add("/rain/3h",&rain);
+        extraction.add("/notexist",&missing);
+        // Act
+        bool ok = sut.extract(extraction);
+        // Assert
+        REQUIRE( ok );
+        REQUIRE(STREQUAL( name, "Copenhagen" ));
+        REQUIRE(STREQUAL( temp, "285.086" ));
+        REQUIRE(STREQUAL( icon, "04d" ));
+        REQUIRE(STREQUAL( rain, "0.05" ));
+        REQUIRE( missing == 0 );
+    }
+    SECTION("extract values from array elements in one pass")
+    {
+        // Arrange
+        std::string forecast = readFile(FIXTUREDIR "/forecast.json");
+        HeapByteBuffer buffer;
+        buffer.add(copyBytes(forecast),forecast.size());
+        using namespace json;
+        struct Humidities
+        :
+            public IElementVisitor
+        {
+            std::vector<std::string> values;
+            uint8_t const * humidity;
+            virtual void element (size_t index)
+            {
+                REQUIRE( index == values.size() );
+                values.push_back((char const *)humidity);
+            }
+        } visitor;
+        uint8_t const * city;
+        Extraction extraction;
+        extraction.add("/city/name",&city);
+        extraction.forEachElement("/list",3,visitor);
+        extraction.addElementPath("/main/humidity",&visitor.humidity);
+        Json sut (buffer);
+        // Act
+        bool ok = sut.extract(extraction);
+        // Assert
+        REQUIRE( ok );
+        REQUIRE(STREQUAL( city, "London" ));
+        REQUIRE( visitor.values.size() == 3 );
+        REQUIRE( visitor.values[0] == "76" );
+        REQUIRE( visitor.values[1] == "59" );
+    }
+    SECTION("extraction stops when the results arena is full")
+    {
+        // Arrange
+        std::string current = readFile(FIXTUREDIR "/current.json");
+        HeapByteBuffer buffer;
+        buffer.add(castToBytes(current),current.size());
+        uint8_t memory[16];
+        Arena results(memory,sizeof(memory));
+        using namespace json;
+        Json sut (buffer,results);
+        uint8_t const * temp = 0;
+        uint8_t const * name = 0;
+        Extraction extraction;
+        extraction.add("/main/temp",&temp);
+        extraction.add("/name",&name);
+        // Act
+        bool ok = sut.extract(extraction);
+        // Assert
+        REQUIRE( ! ok );
+        REQUIRE(STREQUAL( temp, "285.086" ));
+        REQUIRE( name == 0 );
+    }
+    SECTION("lookups resume from checkpoints")
+    {
+        // Arrange
+        std::string forecast = readFile(FIXTUREDIR "/forecast.json");
+        HeapByteBuffer buffer;
+        for (size_t i = 0; i < forecast.size(); i += 100)
+        {
+            std::string chunk = forecast.substr(i,100);
+            buffer.add(castToBytes(chunk),chunk.size());
+        }
+        using namespace json;
+        Json reference (buffer,0);
+        Json sut (buffer,4);
+        char const * paths[] =
+        {
+            "/list/30/main/temp", "/list/20/dt", "/list/31/weather/0/icon",
+            "/list/36/wind/speed", "/list/0/main/humidity", "/list/7/clouds/all",
+            "/list/30/main/temp", "/city/name", 0
+        };
+        // Act & Assert
+        REQUIRE( sut.lookupArraySize("/list") == 37 );
+        for (size_t i = 0; paths[i] != 0; ++i)
+        {
+            REQUIRE(STREQUAL( sut.lookup(paths[i]), reference.lookup(paths[i]) ));
+        }
+        REQUIRE( sut.lookup("/list/37/dt") == 0 );
+    }
+    SECTION("typed buffers are read without the interface")
+    {
+        // Arrange
+        std::string forecast = readFile(FIXTUREDIR "/forecast.json");
+        HeapByteBuffer buffer;
+        for (size_t i = 0; i < forecast.size(); i += 100)
+        {
+            std::string chunk = forecast.substr(i,100);
+            buffer.add(castToBytes(chunk),chunk.size());
+        }
+        using namespace json;
+        Json reference (buffer,0);
+        Arena results;
+        BufferJson<HeapByteBuffer> sut (buffer,results,4);
+        char const * paths[] = { "/list/30/main/temp", "/list/20/dt", "/list/31/weather/0/icon", "/city/name", 0 };
+        // Act & Assert
+        REQUIRE( sut.lookupArraySize("/list") == 37 );
+        for (size_t i = 0; paths[i] != 0; ++i)
+        {
+            REQUIRE(STREQUAL( sut.lookup(paths[i]), reference.lookup(paths[i]) ));
+        }
+        REQUIRE( sut.lookup("/list/37/dt") == 0 );
+        REQUIRE( results.used() > 0 );
+    }
+    SECTION("lookups walk the index when built")
+    {
+        // Arrange
+        std::string forecast = readFile(FIXTUREDIR "/forecast.json");
+        HeapByteBuffer buffer;
+        for (size_t i = 0; i < forecast.size(); i += 7)
+        {
+            std::string chunk = forecast.substr(i,7);
+            buffer.add(castToBytes(chunk),chunk.size());
+        }
+        using namespace json;
+        Json reference (buffer);
+        Json sut (buffer);
+        char const * paths[] =
+        {
+            "/city/name", "/city/coord/lon", "/cnt", "/list/0/dt", "/list/1/main/humidity",
+            "/list/12/rain/3h", "/list/36/dt_txt", "/list/36/weather/0/description",
+            "/list/5/sys/pod", 0
+        };
+        // Act
+        bool ok = sut.buildIndex();
+        // Assert
+        REQUIRE( ok );
+        REQUIRE( sut.lookupArraySize("/list") == 37 );
+        REQUIRE( sut.lookupArraySize("/list/3/weather") == 1 );
+        REQUIRE( sut.lookupArraySize("/city") == 0 );
+        for (size_t i = 0; paths[i] != 0; ++i)
+        {
+            REQUIRE(STREQUAL( sut.lookup(paths[i]), reference.lookup(paths[i]) ));
+        }
+        REQUIRE(STREQUAL( sut.lookup("/list/36/dt_txt"), "2016-05-21 00:00:00" ));
+        REQUIRE( sut.lookup("/list/37/dt") == 0 );
+        REQUIRE( sut.lookup("/list/0/notexist") == 0 );
+        REQUIRE( sut.lookup("/list/0/main") == 0 );
+    }
+    SECTION("index building fails on broken documents")
+    {
+        // Arrange
+        HeapByteBuffer buffer;
+        buffer.add(castToBytes("{\"a\":[1,2"),9);
+        using namespace json;
+        Json sut (buffer);
+        // Act & Assert
+        REQUIRE( ! sut.buildIndex() );
+    }
+    SECTION("values are stored in the results arena")
+    {
+        // Arrange
+        std::string current = readFile(FIXTUREDIR "/current.json");
+        HeapByteBuffer buffer;
+        buffer.add(castToBytes(current),current.size());
+        uint8_t memory[16];
+        Arena results(memory,sizeof(memory));
+        using namespace json;
+        Json sut (buffer,results);
+        // Act
+        uint8_t const * name = sut.lookup("/name");
+        uint8_t const * temp = sut.lookup("/main/temp");
+        // Assert
+        REQUIRE(STREQUAL( name, "Copenhagen" ));
+        REQUIRE( name == memory );
+        REQUIRE( temp == 0 );
+        REQUIRE( &sut.results() == &results );
+    }
+    SECTION("numbers can be looked up without strings")
+    {
+        // Arrange
+        std::string current = readFile(FIXTUREDIR "/current.json");
+        HeapByteBuffer buffer;
+        buffer.add(castToBytes(current),current.size());
+        using namespace json;
+        Json sut (buffer);
+        int integer = 0;
+        int32_t fixed = 0;
+        double real = 0;
+        // Act & Assert
+        REQUIRE( sut.lookupInt("/main/humidity",integer) );
+        REQUIRE( integer == 72 );
+        REQUIRE( sut.lookupInt("/dt",integer) );
+        REQUIRE( integer == 1463393862 );
+        REQUIRE( ! sut.lookupInt("/main/temp",integer) );
+        REQUIRE( ! sut.lookupInt("/name",integer) );
+        REQUIRE( ! sut.lookupInt("/notexist",integer) );
+        REQUIRE( sut.lookupFixedPoint("/main/temp",2,fixed) );
+        REQUIRE( fixed == 28509 );
+        REQUIRE( sut.lookupFixedPoint("/wind/speed",1,fixed) );
+        REQUIRE( fixed == 99 );
+        REQUIRE( sut.lookupFixedPoint("/coord/lat",3,fixed) );
+        REQUIRE( fixed == 55680 );
+        REQUIRE( sut.lookupFixedPoint("/clouds/all",0,fixed) );
+        REQUIRE( fixed == 68 );
+        REQUIRE( ! sut.lookupFixedPoint("/dt",1,fixed) );
+        REQUIRE( sut.lookupDouble("/main/pressure",real) );
+        REQUIRE( real == 1019.66 );
+        REQUIRE( sut.buildIndex() );
+        REQUIRE( sut.lookupFixedPoint("/sys/message",4,fixed) );
+        REQUIRE( fixed == 35 );
+        REQUIRE( sut.lookupDouble("/wind/deg",real) );
+        REQUIRE( real == 317.502 );
+    }
+    SECTION("fixed-point numbers round half away from zero")
+    {
+        // Arrange
+        HeapByteBuffer buffer;
+        char const * document = "[-0.5,0.05,-12.345,2.5e1,1e-3,-]";
+        buffer.add(castToBytes(document),strlen(document));
+        using namespace json;
+        Json sut (buffer);
+        int32_t fixed = 0;
+        // Act & Assert
+        REQUIRE( sut.lookupFixedPoint("/0",0,fixed) );
+        REQUIRE( fixed == -1 );
+        REQUIRE( sut.lookupFixedPoint("/1",1,fixed) );
+        REQUIRE( fixed == 1 );
+        REQUIRE( sut.lookupFixedPoint("/2",2,fixed) );
+        REQUIRE( fixed == -1235 );
+        REQUIRE( sut.lookupFixedPoint("/3",1,fixed) );
+        REQUIRE( fixed == 250 );
+        REQUIRE( sut.lookupFixedPoint("/4",4,fixed) );
+        REQUIRE( fixed == 10 );
+        REQUIRE( ! sut.lookupFixedPoint("/5",0,fixed) );
+    }
+    SECTION("lookups with compiled paths and placeholders")
+    {
+        // Arrange
+        std::string forecast = readFile(FIXTUREDIR "/forecast.json");
+        HeapByteBuffer buffer;
+        buffer.add(castToBytes(forecast),forecast.size());
+        using namespace json;
+        Json sut (buffer);
+        JsonPath const list = JSON_PATH("/list");
+        JsonPath const humidity = JSON_PATH("/list/#/main/humidity");
+        JsonPath const icon = JSON_PATH("/list/#/weather/0/icon");
+        int value = 0;
+        // Act & Assert
+        REQUIRE( sut.lookupArraySize(list) == 37 );
+        REQUIRE(STREQUAL( sut.lookup(humidity,1), "59" ));
+        REQUIRE(STREQUAL( sut.lookup(icon,3), "03n" ));
+        REQUIRE(STREQUAL( sut.lookup(icon,12), sut.lookup("/list/12/weather/0/icon") ));
+        REQUIRE( sut.lookupInt(humidity,value,0) );
+        REQUIRE( value == 76 );
+        REQUIRE( sut.lookup(humidity,37) == 0 );
+        REQUIRE( sut.buildIndex() );
+        REQUIRE(STREQUAL( sut.lookup(icon,3), "03n" ));
+        REQUIRE( sut.lookupInt(humidity,value,1) );
+        REQUIRE( value == 59 );
+    }
+    SECTION("project a column of values in one pass")
+    {
+        // Arrange
+        std::string part1 = readFile(FIXTUREDIR "/forecast-part1.json");
+        std::string part2 = readFile(FIXTUREDIR "/forecast-part2.json");
+        std::string part3 = readFile(FIXTUREDIR "/forecast-part3.json");
+        HeapByteBuffer buffer;
+        buffer.add(copyBytes(part1),part1.size());
+        buffer.add(copyBytes(part2),part2.size());
+        buffer.add(copyBytes(part3),part3.size());
+        using namespace json;
+        Json sut (buffer);
+        uint8_t const * temperatures[40];
+        uint8_t const * rain[40];
+        // Act
+        size_t rows = sut.project(JSON_PATH("/list/*/main/temp"),temperatures,40);
+        size_t rainRows = sut.project(JSON_PATH("/list/*/rain/3h"),rain,40);
+        // Assert
+        REQUIRE( rows == 37 );
+        for (size_t i = 0; i < rows; ++i)
+        {
+            char path[32];
+            sprintf(path,"/list/%u/main/temp",(unsigned)i);
+            REQUIRE(STREQUAL( temperatures[i], sut.lookup(path) ));
+        }
+        REQUIRE( temperatures[37] == 0 );
+        REQUIRE( rainRows > 12 );
+        REQUIRE( rain[0] == 0 );
+        REQUIRE(STREQUAL( rain[12], "0.05" ));
+    }
+    SECTION("project values to a visitor")
+    {
+        // Arrange
+        HeapByteBuffer buffer;
+        char const * document = "{\"a\":[{\"b\":[1,2]},{\"c\":3},{\"b\":[4]}],\"b\":5}";
+        buffer.add(castToBytes(document),strlen(document));
+        using namespace json;
+        struct Collector
+        :
+            public IProjectionVisitor
+        {
+            std::vector<std::string> values;
+            virtual void value (size_t index, JSONToken const & token)
+            {
+                values.push_back(std::string((char const *)token.start,token.end-token.start));
+            }
+        } visitor;
+        Json sut (buffer);
+        // Act
+        bool ok = sut.project(JSON_PATH("/a/*/b/*"),visitor);
+        // Assert
+        REQUIRE( ok );
+        REQUIRE( visitor.values.size() == 3 );
+        REQUIRE( visitor.values[0] == "1" );
+        REQUIRE( visitor.values[1] == "2" );
+        REQUIRE( visitor.values[2] == "4" );
+        REQUIRE( sut.lookup("/a/*/b/0") == 0 );
+    }
+    SECTION("visit every part of the document")
+    {
+        // Arrange
+        HeapByteBuffer buffer;
+        char const * document = "{\"a\":[1,{\"b\":true}],\"c\":null}";
+        buffer.add(castToBytes(document),strlen(document));
+        using namespace json;
+        struct Recorder
+        :
+            public IJsonVisitor
+        {
+            std::string events;
+            void record (char const * event, JsonContext const & context)
+            {
+                char text[32];
+                sprintf(text,"%s%u%s%u ",event,(unsigned)context.depth,context.inArray ? "@" : "-",(unsigned)context.index);
+                events += text;
+            }
+            virtual void startObject (JsonContext const & context) { record("{",context); }
+            virtual void endObject (JsonContext const & context) { record("}",context); }
+            virtual void startArray (JsonContext const & context) { record("[",context); }
+            virtual void endArray (JsonContext const & context) { record("]",context); }
+            virtual void key (JSONToken const & key, size_t depth)
+            {
+                char text[32];
+                sprintf(text,"%.*s:%u ",(int)(key.end-key.start),(char const *)key.start,(unsigned)depth);
+                events += text;
+            }
+            virtual void value (JSONToken const & value, JsonContext const & context)
+            {
+                events += std::string((char const *)value.start,value.end-value.start);
+                record("=",context);
+            }
+        } visitor;
+        Json sut (buffer);
+        // Act
+        bool ok = sut.visit(visitor);
+        // Assert
+        REQUIRE( ok );
+        REQUIRE( visitor.events ==
+            "{0-0 a:1 [1-0 1=2@0 {2@1 b:3 true=3-0 }2@1 ]1-0 c:1 null=1-0 }0-0 " );
+    }
+    SECTION("visit a chunked document in constant memory")
+    {
+        // Arrange
+        std::string part1 = readFile(FIXTUREDIR "/forecast-part1.json");
+        std::string part2 = readFile(FIXTUREDIR "/forecast-part2.json");
+        std::string part3 = readFile(FIXTUREDIR "/forecast-part3.json");
+        HeapByteBuffer buffer;
+        buffer.add(copyBytes(part1),part1.size());
+        buffer.add(copyBytes(part2),part2.size());
+        buffer.add(copyBytes(part3),part3.size());
+        using namespace json;
+        struct Temperatures
+        :
+            public IJsonVisitor
+        {
+            bool isTemp;
+            size_t count;
+            Temperatures () : isTemp(false), count(0) {}
+            virtual void key (JSONToken const & key, size_t depth)
+            {
+                isTemp = (depth == 4 && FastIsJSONStringEqual(key,"temp"));
+            }
+            virtual void value (JSONToken const & value, JsonContext const & context)
+            {
+                if (isTemp) ++count;
+                isTemp = false;
+            }
+        } visitor;
+        HeapByteBuffer deepBuffer;
+        std::string deep(MAX_VISIT_DEPTH+1,'[');
+        deep += std::string(MAX_VISIT_DEPTH+1,']');
+        deepBuffer.add(copyBytes(deep),deep.size());
+        IJsonVisitor ignore;
+        Json sut (buffer);
+        Json deepSut (deepBuffer);
+        // Act
+        bool ok = sut.visit(visitor);
+        bool deepOk = deepSut.visit(ignore);
+        // Assert
+        REQUIRE( ok );
+        REQUIRE( visitor.count == 37 );
+        REQUIRE( ! deepOk );
+    }
+    SECTION("long values split between chunks are reassembled whole")
+    {
+        // Arrange
+        std::string description(300,'d');
+        std::string huge(MAX_REASSEMBLYSIZE+100,'h');
+        std::string document = "{\"a\":\"" + description + "\",\"b\":\"" + huge + "\",\"c\":1}";
+        HeapByteBuffer buffer;
+        for (size_t i = 0; i < document.size(); i += 256)
+            buffer.add(castToBytes(document)+i,std::min<size_t>(256,document.size()-i));
+        using namespace json;
+        Json sut (buffer);
+        // Act
+        uint8_t const * a = sut.lookup("/a");
+        size_t afterA = sut.reassembledBytes();
+        uint8_t const * b = sut.lookup("/b");
+        uint8_t const * c = sut.lookup("/c");
+        // Assert
+        REQUIRE(STREQUAL( a, description.c_str() ));
+        REQUIRE( afterA == description.size() );
+        REQUIRE(STREQUAL( b, huge.substr(0,MAX_REASSEMBLYSIZE-1).c_str() ));
+        REQUIRE(STREQUAL( c, "1" ));
+        REQUIRE( sut.reassembledBytes() == afterA + MAX_REASSEMBLYSIZE - 1 );
+    }
+    SECTION("views point into the buffer when nothing needs copying")
+    {
+        // Arrange
+        std::string part1 = "{\"city\":\"London\",\"escaped\":\"a\\\"b\",\"split\":\"Cop";
+        std::string part2 = "enhagen\",\"temp\":288.78}";
+        HeapByteBuffer buffer;
+        buffer.add(castToBytes(part1),part1.size());
+        buffer.add(castToBytes(part2),part2.size());
+        using namespace json;
+        Arena results;
+        Json sut (buffer,results);
+        // Act
+        ByteView city = sut.lookupView("/city");
+        ByteView temp = sut.lookupView("/temp");
+        size_t copiedBeforeEscaped = results.used();
+        ByteView escaped = sut.lookupView("/escaped");
+        ByteView split = sut.lookupView("/split");
+        ByteView missing = sut.lookupView("/missing");
+        // Assert
+        REQUIRE( city == "London" );
+        REQUIRE( city.bytes >= buffer.chunk(0) );
+        REQUIRE( city.bytes < buffer.chunk(0) + buffer.chunkBytes(0) );
+        REQUIRE( temp == "288.78" );
+        REQUIRE( temp.bytes >= buffer.chunk(1) );
+        REQUIRE( copiedBeforeEscaped == 0 );
+        REQUIRE( escaped == "a\"b" );
+        REQUIRE( split == "Copenhagen" );
+        REQUIRE( results.used() > 0 );
+        REQUIRE( missing.isNull() );
+    }
+    SECTION("views are copies when chunks do not stay valid")
+    {
+        // Arrange
+        struct UnstableByteBuffer
+        :
+            public HeapByteBuffer
+        {
+            virtual bool hasStableChunks () const { return false; }
+        } buffer;
+        std::string document = "{\"city\":\"London\"}";
+        buffer.add(castToBytes(document),document.size());
+        using namespace json;
+        Arena results;
+        Json sut (buffer,results);
+        // Act
+        ByteView city = sut.lookupView("/city");
+        // Assert
+        REQUIRE( city == "London" );
+        REQUIRE( results.used() > 0 );
+    }
+    SECTION("cached lookups do not parse until the buffer changes")
+    {
+        // Arrange
+        struct CountingByteBuffer
+        :
+            public HeapByteBuffer
+        {
+            mutable size_t reads;
+            CountingByteBuffer () : reads(0) {}
+            virtual uint8_t const * chunk (size_t index) const
+            {
+                ++reads;
+                return HeapByteBuffer::chunk(index);
+            }
+        } buffer;
+        std::string document = "{\"list\":[{\"temp\":281.5},{\"temp\":283.25}],\"city\":{\"name\":\"London\"}}";
+        buffer.add(castToBytes(document),document.size());
+        using namespace json;
+        static JsonPath const temperature = JSON_PATH("/list/#/temp");
+        Arena results;
+        Json sut (buffer,results);
+        sut.enableCache();
+        uint8_t const * city = sut.lookup("/city/name");
+        int32_t first = 0;
+        sut.lookupFixedPoint(temperature,2,first,1);
+        sut.lookup("/missing");
+        size_t reads = buffer.reads;
+        // Act
+        uint8_t const * cachedCity = sut.lookup("/city/name");
+        ByteView cachedView = sut.lookupView("/city/name");
+        int32_t second = 0;
+        bool found = sut.lookupFixedPoint(temperature,2,second,1);
+        uint8_t const * missing = sut.lookup("/missing");
+        size_t readsWhenCached = buffer.reads;
+        std::string cityBeforeChange = (char const *)city;
+        bool viewOfCachedCity = (cachedView.bytes == city && cachedView == "London");
+        std::string changed = "{\"city\":{\"name\":\"Paris\"}}";
+        buffer.clear();
+        buffer.add(castToBytes(changed),changed.size());
+        uint8_t const * changedCity = sut.lookup("/city/name");
+        // Assert
+        REQUIRE( cityBeforeChange == "London" );
+        REQUIRE( cachedCity == city );
+        REQUIRE( viewOfCachedCity );
+        REQUIRE( first == 28325 );
+        REQUIRE( found );
+        REQUIRE( second == 28325 );
+        REQUIRE( missing == 0 );
+        REQUIRE( readsWhenCached == reads );
+        REQUIRE( results.used() == 0 );
+        REQUIRE(STREQUAL( changedCity, "Paris" ));
+    }
+    SECTION("paths that evict each other from the cache keep being found")
+    {
+        // Arrange
+        HeapByteBuffer buffer;
+        std::string document = "{\"list\":[{\"temp\":281.5},{\"temp\":283.25}],\"city\":{\"name\":\"London\"}}";
+        buffer.add(castToBytes(document),document.size());
+        using namespace json;
+        Json sut (buffer);
+        sut.enableCache(1,64);
+        bool allFound = true;
+        // Act
+        for (size_t i = 0; i < 1000 && allFound; ++i)
+        {
+            uint8_t const * city = sut.lookup("/city/name");
+            allFound = (city != 0 && STREQUAL( city, "London" ));
+            uint8_t const * temperature = sut.lookup("/list/1/temp");
+            allFound = allFound && (temperature != 0 && STREQUAL( temperature, "283.25" ));
+        }
+        // Assert
+        REQUIRE( allFound );
+    }
+}
+
+TEST_CASE("json lookup throughput","[.][benchmark]")
+{
+    std::string forecast = readFile(FIXTUREDIR "/forecast.json");
+    size_t const chunkSizes[] = { 256, 16 };
+    for (size_t size = 0; size < sizeof(chunkSizes)/sizeof(chunkSizes[0]); ++size)
+    {
+        HeapByteBuffer buffer;
+        for (size_t i = 0; i < forecast.size(); i += chunkSizes[size])
+            buffer.add(castToBytes(forecast)+i,std::min<size_t>(chunkSizes[size],forecast.size()-i));
+        json::Json sut (buffer,0);
+        json::BufferJson<HeapByteBuffer> typed (buffer,0);
+        size_t const rounds = 2000;
+        size_t found = 0;
+        clock_t start = clock();
+        for (size_t round = 0; round < rounds; ++round)
+        {
+            sut.results().reset();
+            if (sut.lookup("/list/36/dt") != 0) ++found;
+        }
+        clock_t virtualEnd = clock();
+        for (size_t round = 0; round < rounds; ++round)
+        {
+            typed.results().reset();
+            if (typed.lookup("/list/36/dt") != 0) ++found;
+        }
+        clock_t typedEnd = clock();
+        printf("looked up the last forecast in %u byte chunks at %.1f MB/s, typed %.1f MB/s\n",
+            (unsigned)chunkSizes[size],
+            rounds * forecast.size() / (double(virtualEnd - start) / CLOCKS_PER_SEC) / 1e6,
+            rounds * forecast.size() / (double(typedEnd - virtualEnd) / CLOCKS_PER_SEC) / 1e6);
+        REQUIRE( found == 2 * rounds );
+    }
 }
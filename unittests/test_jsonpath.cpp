@@ -0,0 +1,49 @@
+// This software is part of OpenMono, see http://developer.openmono.com
+// Released under the MIT license, see LICENSE.txt
+#include "catch.hpp"
+#include "util.hpp"
+#include "jsonpath.hpp"
+
+TEST_CASE("jsonpath","")
+{
+    using namespace json;
+    SECTION("root path has no segments")
+    {
+        // Act
+        JsonPath sut("");
+        // Assert
+        REQUIRE( sut.isValid() );
+        REQUIRE( sut.segments() == 0 );
+    }
+    SECTION("paths are split into segments")
+    {
+        // Act
+        JsonPath sut = JSON_PATH("/list/12/main/temp");
+        // Assert
+        REQUIRE( sut.isValid() );
+        REQUIRE( sut.segments() == 4 );
+        REQUIRE( std::string(sut.segmentText(0),sut.segment(0).length) == "list" );
+        REQUIRE( ! sut.segment(0).isIndex );
+        REQUIRE( sut.segment(1).isIndex );
+        REQUIRE( sut.segment(1).index == 12 );
+        REQUIRE( std::string(sut.segmentText(3),sut.segment(3).length) == "temp" );
+        REQUIRE( sut.segment(3).hash == JsonPath::hash("temp",4) );
+        REQUIRE( sut.prefixLength(1) == 5 );
+        REQUIRE( sut.prefixLength(4) == sut.length() );
+    }
+    SECTION("placeholders")
+    {
+        // Act
+        JsonPath sut("/list/#/weather/0/icon");
+        // Assert
+        REQUIRE( sut.segment(1).isPlaceholder );
+        REQUIRE( ! sut.segment(1).isIndex );
+        REQUIRE( ! sut.hasPlaceholderBefore(1) );
+        REQUIRE( sut.hasPlaceholderBefore(3) );
+    }
+    SECTION("invalid paths")
+    {
+        REQUIRE( ! JsonPath("list").isValid() );
+        REQUIRE( ! JsonPath("/1/2/3/4/5/6/7/8/9/10/11/12/13").isValid() );
+    }
+}
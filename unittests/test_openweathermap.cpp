@@ -5,8 +5,9 @@
 #include "weather.hpp"
 #include "openweathermap.hpp"
 #include "heapbytebuffer.hpp"
-
-#define STREQUAL(x,y) std::string((char*)x) == std::string((char*)y)
+#include "pushparser.hpp"
+#include <stdio.h>
+#include <sys/time.h>
 
 TEST_CASE("openweathermap","")
 {
@@ -22,19 +23,21 @@ TEST_CASE("openweathermap","")
         buffer.add(copyBytes(part3),part3.size());
         using namespace openweathermap;
         using namespace weather;
+        Arena results;
         // Act
-        Entry sut = parseCurrent(buffer);
+        Entry sut = parseCurrent(buffer,results);
         // Assert
-        REQUIRE(STREQUAL( sut.city, "Copenhagen" ));
-        REQUIRE(STREQUAL( sut.temperatureK, "285.086" ));
-        REQUIRE(STREQUAL( sut.cloudPercentage, "68" ));
-        REQUIRE(STREQUAL( sut.humidity, "72" ));
-        REQUIRE(STREQUAL( sut.pressureHpa, "1019.66" ));
-        REQUIRE(STREQUAL( sut.windSpeedMs, "9.85" ));
-        REQUIRE(STREQUAL( sut.windDirection, "317.502" ));
-        REQUIRE(STREQUAL( sut.timeUnix, "1463393862" ));
+        REQUIRE( sut.city == cityId((uint8_t const *)"Copenhagen") );
+        REQUIRE( sut.temperatureCentiK == 28509 );
+        REQUIRE( sut.cloudPercentage == 68 );
+        REQUIRE( sut.humidity == 72 );
+        REQUIRE( sut.pressureDeciHpa == 10197 );
+        REQUIRE( sut.windSpeedCentiMs == 985 );
+        REQUIRE( sut.windDirectionDeciDegrees == 3175 );
+        REQUIRE( sut.timeUnix == 1463393862 );
         REQUIRE( sut.condition == Day_Overcast );
-        REQUIRE(STREQUAL( sut.rain, "0.05" ));
+        REQUIRE( sut.hasRain );
+        REQUIRE( sut.rainCentiMm == 5 );
     }
     SECTION("parse forecast")
     {
@@ -44,22 +47,25 @@ TEST_CASE("openweathermap","")
         buffer.add(copyBytes(forecast),forecast.size());
         using namespace openweathermap;
         using namespace weather;
+        Arena results;
         // Act
-        std::vector<Entry> forecasts = parseForecast(buffer,37);
+        std::vector<Entry> forecasts = parseForecast(buffer,37,results);
         // Assert
         REQUIRE( forecasts.size() == 37 );
+        REQUIRE( sizeof(Entry) == 24 );
         {
             Entry const & entry = forecasts[0];
-            REQUIRE(STREQUAL( entry.city, "London" ));
-            REQUIRE(STREQUAL( entry.timeUnix, "1463400000" ));
-            REQUIRE(STREQUAL( entry.temperatureK, "288.78" ));
-            REQUIRE(STREQUAL( entry.cloudPercentage, "0" ));
-            REQUIRE(STREQUAL( entry.humidity, "76" ));
-            REQUIRE(STREQUAL( entry.pressureHpa, "1023.83" ));
-            REQUIRE(STREQUAL( entry.windSpeedMs, "2.92" ));
-            REQUIRE(STREQUAL( entry.windDirection, "307.51" ));
+            REQUIRE( entry.city == cityId((uint8_t const *)"London") );
+            REQUIRE( entry.timeUnix == 1463400000 );
+            REQUIRE( entry.temperatureCentiK == 28878 );
+            REQUIRE( entry.cloudPercentage == 0 );
+            REQUIRE( entry.humidity == 76 );
+            REQUIRE( entry.pressureDeciHpa == 10238 );
+            REQUIRE( entry.windSpeedCentiMs == 292 );
+            REQUIRE( entry.windDirectionDeciDegrees == 3075 );
             REQUIRE( entry.condition == Day_ClearSky );
-            REQUIRE(STREQUAL( entry.rain, "" ));
+            REQUIRE_FALSE( entry.hasRain );
+            REQUIRE( entry.rainCentiMm == 0 );
         }
         {
             Entry const & entry = forecasts[3];
@@ -76,7 +82,278 @@ TEST_CASE("openweathermap","")
         {
             Entry const & entry = forecasts[12];
             REQUIRE( entry.condition == Night_Rain );
-            REQUIRE(STREQUAL( entry.rain, "0.05" ));
+            REQUIRE( entry.hasRain );
+            REQUIRE( entry.rainCentiMm == 5 );
+        }
+    }
+    SECTION("parse times after 2038")
+    {
+        // Arrange
+        std::string current = "{\"name\":\"Copenhagen\",\"dt\":2200000000,\"main\":{\"temp\":285.09}}";
+        HeapByteBuffer buffer;
+        buffer.add(copyBytes(current),current.size());
+        using namespace openweathermap;
+        using namespace weather;
+        Arena results;
+        // Act
+        Entry sut = parseCurrent(buffer,results);
+        // Assert
+        REQUIRE( sut.timeUnix == 2200000000u );
+        REQUIRE( sut.temperatureCentiK == 28509 );
+    }
+    SECTION("parse nothing from a cut off forecast")
+    {
+        // Arrange
+        std::string forecast = readFile(FIXTUREDIR "/forecast.json");
+        forecast.resize(forecast.size() / 2);
+        HeapByteBuffer buffer;
+        buffer.add(copyBytes(forecast),forecast.size());
+        using namespace openweathermap;
+        Arena results;
+        // Act
+        std::vector<weather::Entry> sut = parseForecast(buffer,37,results);
+        // Assert
+        REQUIRE( sut.empty() );
+    }
+    SECTION("translate icon codes")
+    {
+        // Arrange
+        using namespace openweathermap;
+        using namespace weather;
+        char const * unknown[] = { "", "0", "01", "01x", "18d", "67n", "01dn", "5", "d01" };
+        // Act
+        // Assert
+        for (int condition = Day_ClearSky; condition < Unknown; ++condition)
+        {
+            INFO(conditionIcons[condition]);
+            REQUIRE( translateIcon((uint8_t const *)conditionIcons[condition]) == condition );
+        }
+        REQUIRE( translateIcon((uint8_t const *)"09n") == Night_ShowerRain );
+        REQUIRE( translateIcon((uint8_t const *)"50d") == Day_Mist );
+        for (size_t i = 0; i < sizeof(unknown)/sizeof(unknown[0]); ++i)
+        {
+            INFO(unknown[i]);
+            REQUIRE( translateIcon((uint8_t const *)unknown[i]) == Unknown );
+        }
+        REQUIRE( translateIcon(0) == Unknown );
+    }
+    SECTION("parse forecast into a series")
+    {
+        // Arrange
+        std::string forecast = readFile(FIXTUREDIR "/forecast.json");
+        HeapByteBuffer buffer;
+        buffer.add(copyBytes(forecast),forecast.size());
+        using namespace openweathermap;
+        using namespace weather;
+        Arena results;
+        std::vector<Entry> expected = parseForecast(buffer,37,results);
+        ForecastSeries sut;
+        // Act
+        bool ok = parseForecast(buffer,37,results,sut);
+        // Assert
+        REQUIRE( ok );
+        REQUIRE( sut.size() == 37 );
+        REQUIRE( sut.city() == cityId((uint8_t const *)"London") );
+        for (size_t i = 0; i < sut.size(); ++i) REQUIRE( sut.entry(i) == expected[i] );
+    }
+    SECTION("decode forecast while it arrives")
+    {
+        // Arrange
+        std::string forecast = readFile(FIXTUREDIR "/forecast.json");
+        HeapByteBuffer buffer;
+        buffer.add(copyBytes(forecast),forecast.size());
+        using namespace openweathermap;
+        using namespace weather;
+        struct Handler
+        :
+            public IForecastHandler
+        {
+            std::vector<size_t> indices;
+            virtual void entry (size_t index, Entry const &)
+            {
+                indices.push_back(index);
+            }
+        } handler;
+        Arena results;
+        Arena pushResults;
+        ForecastDecoder decoder(5,pushResults,&handler);
+        PushParser sut(decoder);
+        std::vector<Entry> expected = parseForecast(buffer,5,results);
+        // Act
+        bool ok = true;
+        size_t entriesBeforeLastChunk = 0;
+        for (size_t position = 0; position < forecast.size(); position += 77)
+        {
+            size_t length = std::min<size_t>(77,forecast.size()-position);
+            if (position + length == forecast.size()) entriesBeforeLastChunk = decoder.forecast().size();
+            ok = ok && sut.feed(castToBytes(forecast)+position,length);
+        }
+        bool done = sut.finish();
+        // Assert
+        REQUIRE( ok );
+        REQUIRE( done );
+        REQUIRE( entriesBeforeLastChunk == 5 );
+        REQUIRE( handler.indices.size() == 5 );
+        REQUIRE( handler.indices[4] == 4 );
+        std::vector<Entry> const & entries = decoder.forecast();
+        REQUIRE( entries.size() == 5 );
+        for (size_t i = 0; i < entries.size(); ++i)
+        {
+            REQUIRE( entries[i] == expected[i] );
+        }
+    }
+    SECTION("decode a forecast in an arena with room for one entry")
+    {
+        // Arrange
+        std::string forecast = readFile(FIXTUREDIR "/forecast.json");
+        HeapByteBuffer buffer;
+        buffer.add(copyBytes(forecast),forecast.size());
+        using namespace openweathermap;
+        using namespace weather;
+        Arena results;
+        std::vector<Entry> expected = parseForecast(buffer,37,results);
+        uint8_t memory[128];
+        Arena small(memory,sizeof(memory));
+        ForecastDecoder decoder(37,small);
+        PushParser sut(decoder);
+        // Act
+        bool ok = sut.feed(castToBytes(forecast),forecast.size());
+        bool done = sut.finish();
+        // Assert
+        REQUIRE( ok );
+        REQUIRE( done );
+        REQUIRE( decoder.forecast().size() == 37 );
+        REQUIRE( small.used() == strlen("London") + 1 );
+        for (size_t i = 0; i < 37; ++i) REQUIRE( decoder.forecast()[i] == expected[i] );
+    }
+    SECTION("decode forecast by visiting the whole document")
+    {
+        // Arrange
+        std::string forecast = readFile(FIXTUREDIR "/forecast.json");
+        HeapByteBuffer buffer;
+        buffer.add(copyBytes(forecast),forecast.size());
+        using namespace openweathermap;
+        using namespace weather;
+        Arena results;
+        ForecastDecoder sut(37,results);
+        Json json(buffer,results);
+        // Act
+        bool ok = json.visit(sut);
+        // Assert
+        REQUIRE( ok );
+        REQUIRE( sut.forecast().size() == 37 );
+        REQUIRE( sut.forecast()[0].city == cityId((uint8_t const *)"London") );
+        REQUIRE( sut.forecast()[3].condition == Night_ScatteredClouds );
+        REQUIRE( sut.forecast()[12].rainCentiMm == 5 );
+        REQUIRE( sut.forecast()[36].timeUnix == 1463788800 );
+    }
+
+    SECTION("parse a forecast in CBOR as in JSON")
+    {
+        // Arrange
+        std::string forecastJson = readFile(FIXTUREDIR "/forecast.json");
+        std::string forecastCbor = readFile(FIXTUREDIR "/forecast.cbor");
+        HeapByteBuffer jsonBuffer, cborBuffer;
+        jsonBuffer.add(copyBytes(forecastJson),forecastJson.size());
+        cborBuffer.add(copyBytes(forecastCbor),forecastCbor.size());
+        using namespace openweathermap;
+        using namespace weather;
+        Arena jsonResults, cborResults;
+        std::vector<Entry> expected = parseForecast(jsonBuffer,37,jsonResults);
+        // Act
+        std::vector<Entry> sut = parseForecast(cborBuffer,37,cborResults);
+        // Assert
+        REQUIRE( sut.size() == expected.size() );
+        for (size_t i = 0; i < sut.size(); ++i)
+        {
+            INFO(i);
+            REQUIRE( sut[i] == expected[i] );
         }
     }
 }
+
+namespace {
+
+/**
+ * A forecast with the list of the fixture repeated.
+ */
+std::string repeatForecast (size_t times)
+{
+    std::string forecast = readFile(FIXTUREDIR "/forecast.json");
+    size_t listStart = forecast.find("\"list\":[") + 8;
+    size_t listEnd = forecast.rfind(']');
+    std::string list = forecast.substr(listStart,listEnd-listStart);
+    std::string repeated = forecast.substr(0,listStart) + list;
+    for (size_t i = 1; i < times; ++i) repeated += "," + list;
+    return repeated + forecast.substr(listEnd);
+}
+
+} // namespace {
+
+TEST_CASE("openweathermap in parallel","")
+{
+    using namespace openweathermap;
+    using namespace weather;
+
+    SECTION("parse a long forecast on several threads")
+    {
+        // Arrange
+        std::string forecast = repeatForecast(40);
+        HeapByteBuffer buffer;
+        buffer.add(castToBytes(forecast),forecast.size());
+        Arena results;
+        std::vector<Entry> expected = parseForecast(buffer,~size_t(0),results);
+        size_t const threadCounts[] = { 1, 3, 8 };
+        for (size_t t = 0; t < sizeof(threadCounts)/sizeof(threadCounts[0]); ++t)
+        {
+            INFO(threadCounts[t]);
+            ParallelForecast sut (threadCounts[t]);
+            std::vector<Entry> entries;
+            // Act
+            bool ok = sut.parse(castToBytes(forecast),forecast.size(),entries);
+            // Assert
+            REQUIRE( ok );
+            REQUIRE( entries.size() == 40 * 37 );
+            REQUIRE( entries.size() == expected.size() );
+            for (size_t i = 0; i < entries.size(); ++i)
+            {
+                REQUIRE( entries[i].city == cityId((uint8_t const *)"London") );
+                REQUIRE( entries[i] == expected[i] );
+            }
+        }
+    }
+
+    SECTION("fail on a broken element")
+    {
+        // Arrange
+        std::string forecast = repeatForecast(4);
+        forecast.replace(forecast.find("\"dt\":1463400000"),15,"\"dt\":1463400000}");
+        ParallelForecast sut (2);
+        std::vector<Entry> entries;
+        // Act
+        bool ok = sut.parse(castToBytes(forecast),forecast.size(),entries);
+        // Assert
+        REQUIRE_FALSE( ok );
+    }
+}
+
+TEST_CASE("openweathermap parallel throughput","[.][benchmark]")
+{
+    using namespace openweathermap;
+    std::string forecast = repeatForecast(3000);
+    size_t const threadCounts[] = { 1, 2, 4, 8 };
+    for (size_t t = 0; t < sizeof(threadCounts)/sizeof(threadCounts[0]); ++t)
+    {
+        ParallelForecast sut (threadCounts[t]);
+        std::vector<Entry> entries;
+        timeval start, end;
+        gettimeofday(&start,0);
+        bool ok = sut.parse(castToBytes(forecast),forecast.size(),entries);
+        gettimeofday(&end,0);
+        double seconds = (end.tv_sec - start.tv_sec) + (end.tv_usec - start.tv_usec) / 1e6;
+        printf("parsed %u entries on %u threads at %.1f MB/s\n",
+            (unsigned)entries.size(),(unsigned)threadCounts[t],forecast.size() / seconds / 1e6);
+        REQUIRE( ok );
+        REQUIRE( entries.size() == 3000 * 37 );
+    }
+}
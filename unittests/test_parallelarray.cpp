@@ -0,0 +1,145 @@
+// This software is part of OpenMono, see http://developer.openmono.com
+// Released under the MIT license, see LICENSE.txt
+#include "catch.hpp"
+#include "util.hpp"
+#include "heapbytebuffer.hpp"
+#include "parallelarray.hpp"
+#include "jsonparser.hpp"
+#include <stdio.h>
+
+namespace {
+
+struct PartCollector
+:
+    public json::IArrayPartHandler
+{
+    std::vector<size_t> firstElements;
+    std::vector<std::string> documents;
+    PartCollector (size_t parts)
+    :
+        firstElements(parts),
+        documents(parts)
+    {
+    }
+    virtual void part (size_t part, size_t firstElement, IByteBuffer const & document)
+    {
+        firstElements[part] = firstElement;
+        for (size_t i = 0; i < document.chunks(); ++i)
+            documents[part].append((char const *)document.chunk(i),document.chunkBytes(i));
+    }
+};
+
+size_t lookupSize (std::string const & document, char const * path)
+{
+    HeapByteBuffer buffer;
+    buffer.add(castToBytes(document),document.size());
+    return json::Json(buffer).lookupArraySize(path);
+}
+
+std::string lookupString (std::string const & document, char const * path)
+{
+    HeapByteBuffer buffer;
+    buffer.add(castToBytes(document),document.size());
+    json::Json json (buffer);
+    uint8_t const * value = json.lookup(path);
+    return value != 0 ? std::string((char const *)value) : std::string();
+}
+
+} // namespace {
+
+TEST_CASE("parallelarray","")
+{
+    using namespace json;
+
+    SECTION("split the list of a forecast")
+    {
+        // Arrange
+        std::string forecast = readFile(FIXTUREDIR "/forecast.json");
+        for (size_t threads = 1; threads <= 8; ++threads)
+        {
+            INFO(threads);
+            ParallelArray sut (castToBytes(forecast),forecast.size(),threads);
+            // Act
+            bool ok = sut.split("/list");
+            PartCollector collector (sut.parts());
+            sut.run(collector);
+            // Assert
+            REQUIRE( ok );
+            REQUIRE( sut.elements() == 37 );
+            REQUIRE( sut.parts() == threads );
+            size_t elements = 0;
+            for (size_t part = 0; part < sut.parts(); ++part)
+            {
+                std::string const & document = collector.documents[part];
+                REQUIRE( collector.firstElements[part] == elements );
+                REQUIRE( lookupString(document,"/city/name") == "London" );
+                REQUIRE( lookupString(document,"/list/0/dt") ==
+                    lookupString(forecast,(std::string("/list/") + char('0' + elements / 10) + char('0' + elements % 10) + "/dt").c_str()) );
+                elements += lookupSize(document,"/list");
+            }
+            REQUIRE( elements == 37 );
+        }
+    }
+
+    SECTION("split where strings and nesting span segments")
+    {
+        // Arrange
+        size_t const count = 5000;
+        std::string document = "{\"a\":[\"[\",{\"list\":1}],\"list\" : [ ";
+        for (size_t i = 0; i < count; ++i)
+        {
+            char element[100];
+            sprintf(element,"%s{\"s\":\"],[{\\\"\\\\\\\\\",\"n\":[%u,[%u]]}",i == 0 ? "" : " , ",(unsigned)i,(unsigned)i);
+            document += element;
+        }
+        document += "],\"b\":\"]\"}";
+        REQUIRE( document.size() > 8 * PARALLEL_MIN_SEGMENT );
+        ParallelArray sut (castToBytes(document),document.size(),8);
+        // Act
+        bool ok = sut.split("/list");
+        PartCollector collector (sut.parts());
+        sut.run(collector);
+        // Assert
+        REQUIRE( ok );
+        REQUIRE( sut.elements() == count );
+        REQUIRE( sut.parts() == 8 );
+        size_t elements = 0;
+        for (size_t part = 0; part < sut.parts(); ++part)
+        {
+            std::string const & text = collector.documents[part];
+            char expected[20];
+            sprintf(expected,"%u",(unsigned)elements);
+            REQUIRE( collector.firstElements[part] == elements );
+            REQUIRE( lookupString(text,"/list/0/n/1/0") == expected );
+            REQUIRE( lookupString(text,"/list/0/s") == "],[{\"\\\\" );
+            REQUIRE( lookupString(text,"/b") == "]" );
+            elements += lookupSize(text,"/list");
+        }
+        REQUIRE( elements == count );
+    }
+
+    SECTION("split nothing when there is no array")
+    {
+        // Arrange
+        std::string forecast = readFile(FIXTUREDIR "/forecast.json");
+        std::string truncated = forecast.substr(0,forecast.size()-10);
+        std::string empty = "{\"list\":[ \n]}";
+        ParallelArray sut (castToBytes(forecast),forecast.size(),4);
+        ParallelArray unfinished (castToBytes(truncated),truncated.size(),4);
+        ParallelArray nothing (castToBytes(empty),empty.size(),4);
+        // Act
+        bool missing = sut.split("/missing");
+        bool object = sut.split("/city");
+        bool nested = sut.split("/city/coord");
+        bool broken = unfinished.split("/list");
+        bool none = nothing.split("/list");
+        // Assert
+        REQUIRE_FALSE( missing );
+        REQUIRE_FALSE( object );
+        REQUIRE_FALSE( nested );
+        REQUIRE_FALSE( broken );
+        REQUIRE( none );
+        REQUIRE( nothing.elements() == 0 );
+        REQUIRE( nothing.parts() == 0 );
+    }
+}
@@ -0,0 +1,97 @@
+// This software is part of OpenMono, see http://developer.openmono.com
+// Released under the MIT license, see LICENSE.txt
+#include "catch.hpp"
+#include "util.hpp"
+#include "pushparser.hpp"
+#include <stdio.h>
+
+namespace
+{
+    struct Recorder
+    :
+        public json::IJsonVisitor
+    {
+        std::string events;
+        virtual void startObject (json::JsonContext const &) { events += "{ "; }
+        virtual void endObject (json::JsonContext const &) { events += "} "; }
+        virtual void startArray (json::JsonContext const &) { events += "[ "; }
+        virtual void endArray (json::JsonContext const &) { events += "] "; }
+        virtual void key (JSONToken const & key, size_t)
+        {
+            events += std::string((char const *)key.start,key.end-key.start) + ": ";
+        }
+        virtual void value (JSONToken const & value, json::JsonContext const & context)
+        {
+            char index[16];
+            sprintf(index,"@%u ",(unsigned)context.index);
+            events += std::string((char const *)value.start,value.end-value.start) + index;
+        }
+    };
+} // namespace
+
+TEST_CASE("pushparser","")
+{
+    SECTION("tokens split between chunks are reassembled")
+    {
+        // Arrange
+        std::string document = "{\"temp\":[288.78,\"mist\",true],\"cnt\":37}";
+        Recorder recorder;
+        json::PushParser sut(recorder);
+        // Act
+        bool ok = true;
+        for (size_t i = 0; i < document.size(); ++i)
+            ok = ok && sut.feed(castToBytes(document)+i,1);
+        bool done = sut.finish();
+        // Assert
+        REQUIRE( ok );
+        REQUIRE( done );
+        REQUIRE( recorder.events == "{ temp: [ 288.78@0 mist@1 true@2 ] cnt: 37@0 } " );
+    }
+    SECTION("a number ending the document ends with the input")
+    {
+        // Arrange
+        std::string document = "12";
+        Recorder recorder;
+        json::PushParser sut(recorder);
+        // Act
+        sut.feed(castToBytes(document),1);
+        sut.feed(castToBytes(document)+1,1);
+        bool doneBeforeFinish = sut.isDone();
+        bool done = sut.finish();
+        // Assert
+        REQUIRE( ! doneBeforeFinish );
+        REQUIRE( done );
+        REQUIRE( recorder.events == "12@0 " );
+    }
+    SECTION("broken and incomplete documents are reported")
+    {
+        // Arrange
+        std::string broken = "{\"a\":1]";
+        std::string incomplete = "{\"a\":[1,";
+        Recorder recorder;
+        json::PushParser sut(recorder);
+        // Act
+        bool brokenOk = sut.feed(castToBytes(broken),broken.size());
+        sut.restart();
+        bool incompleteOk = sut.feed(castToBytes(incomplete),incomplete.size());
+        bool incompleteDone = sut.finish();
+        // Assert
+        REQUIRE( ! brokenOk );
+        REQUIRE( incompleteOk );
+        REQUIRE( ! incompleteDone );
+    }
+    SECTION("long strings are truncated")
+    {
+        // Arrange
+        std::string document = "[\"" + std::string(100,'x') + "\"]";
+        Recorder recorder;
+        json::PushParser sut(recorder);
+        // Act
+        sut.feed(castToBytes(document),10);
+        sut.feed(castToBytes(document)+10,document.size()-10);
+        bool done = sut.finish();
+        // Assert
+        REQUIRE( done );
+        REQUIRE( recorder.events == "[ " + std::string(MAX_PUSH_TOKENSIZE-1,'x') + "@0 ] " );
+    }
+}
@@ -0,0 +1,124 @@
+// This software is part of OpenMono, see http://developer.openmono.com
+// Released under the MIT license, see LICENSE.txt
+#include "catch.hpp"
+#include "util.hpp"
+#include "heapbytebuffer.hpp"
+#include "jsonparser.hpp"
+#include "schemadecoder.hpp"
+#include <vector>
+
+#define STREQUAL(x,y) std::string((char*)x) == std::string((char*)y)
+
+namespace
+{
+    using namespace json;
+
+    struct Reading
+    {
+        uint8_t const * station;
+        uint8_t const * time;
+        uint8_t const * value;
+        uint8_t const * unit;
+    };
+
+    SchemaField<Reading> const readingFields[] =
+    {
+        { { "t" }, &Reading::time },
+        { { "values", "1" }, &Reading::value },
+        { { "meta", "0" }, &Reading::unit },
+    };
+
+    SchemaField<Reading> const stationFields[] =
+    {
+        { { "station", "id" }, &Reading::station },
+    };
+
+    Schema<Reading> const readingSchema =
+    {
+        { "data", "readings" }, SCHEMA_FIELDS(readingFields), SCHEMA_FIELDS(stationFields)
+    };
+
+    struct Collector
+    :
+        public SchemaDecoder<Reading>
+    {
+        std::vector<std::string> records;
+        size_t maxRecords;
+        Collector (Arena & results, size_t maxRecords_)
+        :
+            SchemaDecoder<Reading>(readingSchema,results),
+            maxRecords(maxRecords_)
+        {
+        }
+        virtual bool startRecord (size_t index)
+        {
+            return index < maxRecords;
+        }
+        virtual void endRecord (size_t index, Reading const & record)
+        {
+            records.push_back(text(record.time) + " " + text(record.value) + " " + text(record.unit));
+        }
+        static std::string text (uint8_t const * value)
+        {
+            return value == 0 ? "-" : (char const *)value;
+        }
+    };
+
+    std::vector<std::string> decode (std::string const & document, Collector & collector)
+    {
+        HeapByteBuffer buffer;
+        buffer.add(castToBytes(document),document.size());
+        Json json (buffer);
+        REQUIRE( json.visit(collector) );
+        return collector.records;
+    }
+} // namespace
+
+TEST_CASE("schemadecoder","")
+{
+    SECTION("records are filled from every array element in one pass")
+    {
+        // Arrange
+        std::string document =
+            "{\"data\":{\"readings\":["
+            "{\"t\":1,\"values\":[5,6,7],\"meta\":{\"0\":\"C\"},\"other\":{\"t\":9}},"
+            "{\"values\":[[1],\"x\"],\"t\":\"2\"},"
+            "{\"t\":3,\"values\":[]}"
+            "],\"t\":4},\"readings\":[{\"t\":5}],\"station\":{\"id\":\"A\\\"1\"}}";
+        Arena results;
+        Collector sut (results,10);
+        // Act
+        std::vector<std::string> records = decode(document,sut);
+        // Assert
+        REQUIRE( records.size() == 3 );
+        REQUIRE( records[0] == "1 6 C" );
+        REQUIRE( records[1] == "2 x -" );
+        REQUIRE( records[2] == "3 - -" );
+        REQUIRE(STREQUAL( sut.document().station, "A\"1" ));
+        REQUIRE( sut.document().time == 0 );
+    }
+    SECTION("elements can be left out")
+    {
+        // Arrange
+        std::string document = "{\"data\":{\"readings\":[{\"t\":1},{\"t\":2},{\"t\":3}]}}";
+        Arena results;
+        Collector sut (results,2);
+        // Act
+        std::vector<std::string> records = decode(document,sut);
+        // Assert
+        REQUIRE( records.size() == 2 );
+        REQUIRE( records[1] == "2 - -" );
+        REQUIRE( sut.document().station == 0 );
+    }
+    SECTION("restarting forgets the document")
+    {
+        // Arrange
+        Arena results;
+        Collector sut (results,10);
+        decode("{\"station\":{\"id\":\"B\"}}",sut);
+        // Act
+        sut.restart();
+        // Assert
+        REQUIRE( sut.document().station == 0 );
+    }
+}
@@ -0,0 +1,215 @@
+// This software is part of OpenMono, see http://developer.openmono.com
+// Released under the MIT license, see LICENSE.txt
+#include "catch.hpp"
+#include "util.hpp"
+#include "SmallJSONParser.h"
+#include <stdio.h>
+#include <string.h>
+#include <time.h>
+
+namespace
+{
+    /**
+     * @return types and values of all tokens, with the input split at a position.
+     */
+    std::string tokenize (std::string const & document, size_t split)
+    {
+        std::string result;
+        JSONParser parser;
+        InitialiseJSONParser(&parser);
+        ProvideJSONInput(&parser,castToBytes(document),split);
+        bool secondPart = false;
+        bool continuing = false;
+        for (;;)
+        {
+            JSONToken token = NextJSONToken(&parser);
+            int type = JSONTokenType(token);
+            if (type == OutOfDataJSONToken)
+            {
+                if (secondPart) break;
+                ProvideJSONInput(&parser,castToBytes(document)+split,document.size()-split);
+                secondPart = true;
+                continue;
+            }
+            char typeText[8];
+            sprintf(typeText,"%d:",type);
+            // The rest of a partial token comes as a token of the same type.
+            if (! continuing) result += typeText;
+            result += std::string((char const *)token.start,token.end-token.start);
+            if (type == ParseErrorJSONToken) break;
+            continuing = IsJSONTokenPartial(token);
+            if (! continuing) result += " ";
+            else if (! secondPart)
+            {
+                ProvideJSONInput(&parser,castToBytes(document)+split,document.size()-split);
+                secondPart = true;
+            }
+        }
+        return result;
+    }
+    struct Chunks
+    {
+        std::string document;
+        size_t size;
+        size_t position;
+    };
+
+    extern "C" bool provideChunk (JSONParser * parser, void * context)
+    {
+        Chunks * chunks = (Chunks *)context;
+        if (chunks->position >= chunks->document.size()) return false;
+        size_t length = std::min(chunks->size,chunks->document.size()-chunks->position);
+        ProvideJSONInput(parser,castToBytes(chunks->document)+chunks->position,length);
+        chunks->position += length;
+        return true;
+    }
+} // namespace
+
+TEST_CASE("smalljsonparser","")
+{
+    SECTION("strings of any length and alignment")
+    {
+        for (size_t length = 0; length < 80; ++length)
+        {
+            // Arrange
+            std::string body(length,'a');
+            for (size_t i = 0; i < length; i += 7) body[i] = 'A' + i % 26;
+            std::string document = "[\"" + body + "\",\"x\\\"y\"]";
+            std::string expected = "5:[ 1:" + body + " 1:x\\\"y 6:] ";
+            for (size_t split = 0; split <= document.size(); ++split)
+            {
+                // Act
+                std::string tokens = tokenize(document,split);
+                // Assert
+                REQUIRE( tokens == expected );
+            }
+        }
+    }
+    SECTION("special bytes are found anywhere in a string")
+    {
+        char const specials[] = { '\\', 0x01, 0x1f, 0x7f, (char)0x80, (char)0xbf };
+        for (size_t special = 0; special < sizeof(specials); ++special)
+        {
+            for (size_t position = 0; position < 40; ++position)
+            {
+                // Arrange
+                std::string body(41,'b');
+                body[position] = specials[special];
+                std::string document = "\"" + body + "\"";
+                // Act
+                std::string tokens = tokenize(document,document.size());
+                // Assert
+                if (specials[special] == '\\')
+                    REQUIRE( tokens == "1:" + body + " " );
+                else
+                    REQUIRE( tokens == "11:" + body.substr(0,position+1) );
+            }
+        }
+    }
+    SECTION("runs of white space of any length")
+    {
+        for (size_t length = 0; length < 80; ++length)
+        {
+            // Arrange
+            std::string document = "{" + std::string(length,' ') + "\"a\":\n" + std::string(length,' ') + "1" + std::string(length,' ') + "}";
+            for (size_t split = 0; split <= document.size(); split += 3)
+            {
+                // Act
+                std::string tokens = tokenize(document,split);
+                // Assert
+                REQUIRE( tokens == "3:{ 1:a 2:1 4:} " );
+            }
+        }
+    }
+}
+
+TEST_CASE("smalljsonparser skipping","")
+{
+    SECTION("skip values split between any chunks without copying")
+    {
+        for (size_t size = 1; size < 12; ++size)
+        {
+            // Arrange
+            Chunks chunks;
+            chunks.document = "[{\"a\":\"x]\\\"}\",\"b\":[1,{\"c\":null}]},true,\"s\" , -1.5e3,{},[[]]]";
+            chunks.size = size;
+            chunks.position = 0;
+            JSONParser parser;
+            JSONProvider provider;
+            uint8_t buffer[8];
+            memset(buffer,0xaa,sizeof(buffer));
+            InitialiseJSONParser(&parser);
+            InitialiseJSONProvider(&provider,provideChunk,&chunks,buffer,sizeof(buffer));
+            JSONToken first;
+            bool start = ExpectJSONTokenOfTypeWithProvider(&parser,&provider,StartArrayJSONToken,&first);
+            // Act
+            bool skipped = true;
+            for (size_t i = 0; i < 6; ++i)
+                skipped = skipped && SkipJSONValueWithProvider(&parser,&provider);
+            uint8_t untouched = 0xaa;
+            for (size_t i = 0; i < sizeof(buffer); ++i) untouched &= buffer[i];
+            JSONToken end = NextJSONTokenWithProvider(&parser,&provider);
+            // Assert
+            REQUIRE( start );
+            REQUIRE( skipped );
+            REQUIRE( untouched == 0xaa );
+            REQUIRE( JSONTokenType(end) == EndArrayJSONToken );
+        }
+    }
+    SECTION("skip the rest of an object")
+    {
+        // Arrange
+        std::string document = "{\"a\":{\"b\":\"}\"},\"c\":[1,2]} 7";
+        JSONParser parser;
+        InitialiseJSONParser(&parser);
+        ProvideJSONInput(&parser,castToBytes(document),document.size());
+        NextJSONToken(&parser);
+        NextJSONToken(&parser);
+        // Act
+        bool skipped = SkipUntilEndOfJSONObject(&parser);
+        JSONToken next = NextJSONToken(&parser);
+        // Assert
+        REQUIRE( skipped );
+        REQUIRE( JSONTokenType(next) == NumberJSONToken );
+    }
+    SECTION("broken values are not skipped")
+    {
+        // Arrange
+        std::string unbalanced = "[1,2";
+        std::string control = "\"a\x01\"";
+        std::string closing = "}";
+        JSONParser parser;
+        // Act
+        InitialiseJSONParser(&parser);
+        ProvideJSONInput(&parser,castToBytes(unbalanced),unbalanced.size());
+        bool unbalancedSkipped = SkipJSONValue(&parser);
+        InitialiseJSONParser(&parser);
+        ProvideJSONInput(&parser,castToBytes(control),control.size());
+        bool controlSkipped = SkipJSONValue(&parser);
+        InitialiseJSONParser(&parser);
+        ProvideJSONInput(&parser,castToBytes(closing),closing.size());
+        bool closingSkipped = SkipJSONValue(&parser);
+        // Assert
+        REQUIRE( ! unbalancedSkipped );
+        REQUIRE( ! controlSkipped );
+        REQUIRE( ! closingSkipped );
+    }
+}
+
+TEST_CASE("smalljsonparser throughput","[.][benchmark]")
+{
+    std::string forecast = readFile(FIXTUREDIR "/forecast.json");
+    size_t const rounds = 2000;
+    size_t tokens = 0;
+    clock_t start = clock();
+    for (size_t round = 0; round < rounds; ++round)
+    {
+        JSONParser parser;
+        InitialiseJSONParser(&parser);
+        ProvideJSONInput(&parser,castToBytes(forecast),forecast.size());
+        while (JSONTokenType(NextJSONToken(&parser)) != OutOfDataJSONToken) ++tokens;
+    }
+    double seconds = double(clock() - start) / CLOCKS_PER_SEC;
+    printf("tokenized %u tokens in %.1f MB/s\n",(unsigned)tokens,rounds * forecast.size() / seconds / 1e6);
+    REQUIRE( tokens > 0 );
+}
@@ -0,0 +1,162 @@
+// This software is part of OpenMono, see http://developer.openmono.com
+// Released under the MIT license, see LICENSE.txt
+#include "catch.hpp"
+#include "util.hpp"
+#include "snapshot.hpp"
+#include <string.h>
+
+#define STREQUAL(a,b) (0 == strcmp((char const *)(a),(char const *)(b)))
+
+namespace {
+
+weather::Snapshot makeSnapshot ()
+{
+    weather::Snapshot snapshot;
+    snapshot.setCity((uint8_t const *)"Copenhagen");
+    snapshot.sourceBytes = 13841;
+    snapshot.entries.push_back(makeEntry(1463400000,28509));
+    snapshot.entries.push_back(makeEntry(1463410800,28312,515,25));
+    return snapshot;
+}
+
+/**
+ * Write the checksum of a snapshot again after its bytes were changed, as
+ * the layout describes it.
+ */
+void reseal (uint8_t * bytes, size_t length)
+{
+    uint32_t sum1 = 0xffff;
+    uint32_t sum2 = 0xffff;
+    size_t end = length - SNAPSHOT_CHECKSUM_BYTES;
+    for (size_t i = 0; i < end; ++i)
+    {
+        sum1 += bytes[i];
+        sum1 = (sum1 & 0xffff) + (sum1 >> 16);
+        sum2 += sum1;
+        sum2 = (sum2 & 0xffff) + (sum2 >> 16);
+    }
+    uint32_t checksum = (sum2 << 16) | sum1;
+    for (size_t i = 0; i < SNAPSHOT_CHECKSUM_BYTES; ++i) bytes[end + i] = uint8_t(checksum >> (8 * i));
+}
+
+} // namespace {
+
+TEST_CASE("snapshot","")
+{
+    using namespace weather;
+
+    SECTION("read what was written")
+    {
+        // Arrange
+        Snapshot original = makeSnapshot();
+        uint8_t bytes[256];
+        Snapshot sut;
+        // Act
+        size_t length = original.write(bytes,sizeof(bytes));
+        bool ok = sut.read(bytes,length);
+        // Assert
+        REQUIRE( length == original.bytes() );
+        REQUIRE( length == SNAPSHOT_HEADER_BYTES + 10 + 2 * SNAPSHOT_ENTRY_BYTES + SNAPSHOT_CHECKSUM_BYTES );
+        REQUIRE( ok );
+        REQUIRE( sut.sourceBytes == 13841 );
+        REQUIRE( STREQUAL(sut.city,"Copenhagen") );
+        REQUIRE( sut.entries.size() == 2 );
+        REQUIRE( sut.entries[0] == original.entries[0] );
+        REQUIRE( sut.entries[1] == original.entries[1] );
+    }
+
+    SECTION("fixed layout")
+    {
+        // Arrange
+        Snapshot original = makeSnapshot();
+        uint8_t bytes[256];
+        // Act
+        original.write(bytes,sizeof(bytes));
+        // Assert
+        uint8_t resealed[256];
+        memcpy(resealed,bytes,original.bytes());
+        reseal(resealed,original.bytes());
+        REQUIRE( memcmp(resealed,bytes,original.bytes()) == 0 );
+        REQUIRE( memcmp(bytes,"MWFS",4) == 0 );
+        REQUIRE( bytes[4] == SNAPSHOT_VERSION );
+        REQUIRE( bytes[5] == 0 );
+        REQUIRE( bytes[6] == 2 );
+        REQUIRE( bytes[8] == (13841 & 0xff) );
+        REQUIRE( bytes[9] == (13841 >> 8) );
+        REQUIRE( bytes[12] == 10 );
+        REQUIRE( bytes[13] == 0 );
+        REQUIRE( bytes[14] == 0 );
+        REQUIRE( bytes[15] == 0 );
+        REQUIRE( memcmp(bytes + SNAPSHOT_HEADER_BYTES,"Copenhagen",10) == 0 );
+        uint8_t const * temperature = bytes + SNAPSHOT_HEADER_BYTES + 10 + 8;
+        REQUIRE( temperature[0] == (28509 & 0xff) );
+        REQUIRE( temperature[1] == (28509 >> 8) );
+    }
+
+    SECTION("refuse what does not fit")
+    {
+        // Arrange
+        Snapshot sut = makeSnapshot();
+        uint8_t bytes[256];
+        // Act
+        size_t small = sut.write(bytes,sut.bytes() - 1);
+        sut.entries.resize(SNAPSHOT_MAX_ENTRIES + 1,sut.entries[0]);
+        std::vector<uint8_t> large(sut.bytes());
+        size_t many = sut.write(&large[0],large.size());
+        sut.entries.resize(SNAPSHOT_MIN_ENTRIES - 1);
+        size_t few = sut.write(bytes,sizeof(bytes));
+        // Assert
+        REQUIRE( small == 0 );
+        REQUIRE( many == 0 );
+        REQUIRE( few == 0 );
+    }
+
+    SECTION("cut long city names")
+    {
+        // Arrange
+        Snapshot sut;
+        uint8_t name[SNAPSHOT_MAX_CITY + 10];
+        memset(name,'x',sizeof(name) - 1);
+        name[sizeof(name) - 1] = 0;
+        // Act
+        sut.setCity(name);
+        // Assert
+        REQUIRE( strlen((char const *)sut.city) == SNAPSHOT_MAX_CITY );
+    }
+
+    SECTION("reject damaged snapshots")
+    {
+        // Arrange
+        Snapshot original = makeSnapshot();
+        uint8_t bytes[256];
+        size_t length = original.write(bytes,sizeof(bytes));
+        Snapshot sut;
+        sut.setCity((uint8_t const *)"Aarhus");
+        // Act
+        bool truncated = sut.read(bytes,length - 1);
+        bytes[30] ^= 0x01;
+        bool flipped = sut.read(bytes,length);
+        bytes[30] ^= 0x01;
+        bytes[4] = SNAPSHOT_VERSION + 1;
+        bool version = sut.read(bytes,length);
+        bytes[4] = SNAPSHOT_VERSION;
+        bytes[0] = '{';
+        bool json = sut.read(bytes,length);
+        bool empty = sut.read(bytes,0);
+        bytes[0] = 'M';
+        // One entry is not a forecast to show.
+        bytes[6] = 1;
+        length -= SNAPSHOT_ENTRY_BYTES;
+        reseal(bytes,length);
+        bool one = sut.read(bytes,length);
+        // Assert
+        REQUIRE_FALSE( truncated );
+        REQUIRE_FALSE( flipped );
+        REQUIRE_FALSE( version );
+        REQUIRE_FALSE( json );
+        REQUIRE_FALSE( empty );
+        REQUIRE_FALSE( one );
+        REQUIRE( STREQUAL(sut.city,"Aarhus") );
+        REQUIRE( sut.entries.empty() );
+    }
+}
@@ -25,3 +25,20 @@ uint8_t * castToBytes (std::string const & contents)
 {
 	return (uint8_t *) contents.c_str();
 }
+
+weather::Entry makeEntry (uint32_t time, uint16_t temperature, uint16_t wind, uint16_t rain)
+{
+    weather::Entry entry = weather::Entry();
+    entry.timeUnix = time;
+    entry.city = weather::cityId((uint8_t const *)"London");
+    entry.temperatureCentiK = temperature;
+    entry.pressureDeciHpa = 10132;
+    entry.windSpeedCentiMs = wind;
+    entry.windDirectionDeciDegrees = 1800;
+    entry.rainCentiMm = rain;
+    entry.cloudPercentage = 40;
+    entry.humidity = 80;
+    entry.condition = weather::Day_Rain;
+    entry.hasRain = rain != 0;
+    return entry;
+}
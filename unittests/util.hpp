@@ -2,6 +2,7 @@
 // Released under the MIT license, see LICENSE.txt
 #if !defined(__com_openmono_unittest_util_hpp)
 #define __com_openmono_unittest_util_hpp
+#include "weather.hpp"
 #include <string>
 
 #define FIXTUREDIR "./unittests/fixtures"
@@ -10,4 +11,10 @@ std::string readFile (char const * fileName);
 uint8_t * copyBytes (std::string const & contents);
 uint8_t * castToBytes (std::string const & contents);
 
+/**
+ * @return an entry for London with the given values, and fixed ones for
+ *         the rest.
+ */
+weather::Entry makeEntry (uint32_t time, uint16_t temperature, uint16_t wind = 515, uint16_t rain = 0);
+
 #endif // __com_openmono_unittest_util_hpp
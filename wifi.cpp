@@ -7,6 +7,7 @@ Wifi::Wifi (IConfiguration const & configuration_)
     spi(RP_SPI_MOSI, RP_SPI_MISO, RP_SPI_CLK),
     spiComm(spi, NC, RP_nRESET, RP_INTERRUPT),
     _buffer(0),
+    _parser(0),
     _status(Wifi_NotConnected),
     configuration(configuration_)
 {
@@ -77,8 +78,10 @@ Wifi::Status Wifi::startRequest (uint8_t const * url)
 void Wifi::httpHandleData (HttpClient::HttpResponseData const & data)
 {
     _buffer->add((uint8_t const *)data.bodyChunk(),data.bodyChunk.Length());
+    if (_parser != 0) _parser->feed((uint8_t const *)data.bodyChunk(),data.bodyChunk.Length());
     if (data.Finished)
     {
+        if (_parser != 0) _parser->finish();
         _status = Wifi_Ready;
         statusHandler.call(_status);
         receivedHandler.call(_buffer);
@@ -86,6 +89,11 @@ void Wifi::httpHandleData (HttpClient::HttpResponseData const & data)
     else statusHandler.call(_status);
 }
 
+void Wifi::setParser (json::PushParser * parser)
+{
+    _parser = parser;
+}
+
 Wifi::Status Wifi::status () const
 {
     return _status;
@@ -10,6 +10,7 @@
 #include "lib/bytestring.hpp"
 #include "lib/ibytebuffer.hpp"
 #include "lib/iconfiguration.hpp"
+#include "lib/pushparser.hpp"
 using mono::network::HttpClient;
 using mono::network::INetworkRequest;
 
@@ -87,6 +88,12 @@ public:
         return startRequest(url);
     }
 
+    /**
+     * Also parse documents retrieved by get while they arrive.
+     * @param parser push parser to feed every chunk to, or 0 for none.
+     */
+    void setParser (json::PushParser * parser);
+
     Status status () const;
 
 private:
@@ -102,6 +109,7 @@ private:
     ByteString ssid;
     ByteString password;
     IByteBuffer * _buffer;
+    json::PushParser * _parser;
     Status _status;
     IConfiguration const & configuration;
     void networkErrorHandler (INetworkRequest::ErrorEvent * error);